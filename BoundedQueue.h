@@ -0,0 +1,160 @@
+#ifndef BOUNDEDQUEUE_H_
+#define BOUNDEDQUEUE_H_
+
+/**
+ * @file BoundedQueue.h
+ * @brief this declares and defines the `BoundedQueue` class
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace stt {
+    template <typename T> class BoundedQueue;
+}
+
+/**
+ * @brief a blocking first in first out queue of limited capacity
+ *
+ * producers block in `BoundedQueue::push` while the queue is full and
+ * consumers block in `BoundedQueue::pop` while it is empty. once the queue is
+ * closed no more items are accepted and consumers drain what remains:
+ *
+ * \code
+ *   while (queue.pop(item)) {
+ *     // process item
+ *   }
+ * \endcode
+ *
+ * the queue records its depth and how long producers and consumers spent
+ * waiting, which shows whether the stage feeding the queue or the stage
+ * draining it is the bottleneck.
+ */
+template <typename T>
+class stt::BoundedQueue
+{
+public:
+    /// what happened to the queue so far
+    struct Statistics {
+        uint64_t pushes = 0;        /// the number of items pushed
+        uint64_t depthSum = 0;      /// the sum of the depths seen by each push
+        size_t maxDepth = 0;        /// the greatest depth reached
+        double fullSeconds = 0;     /// the time producers waited for space
+        double emptySeconds = 0;    /// the time consumers waited for items
+
+        /// the mean number of items in the queue when an item is pushed
+        inline double
+        meanDepth() const {
+            return pushes ? (double) depthSum / pushes : 0;
+        }
+    };
+
+    /// create a queue holding up to `capacity` items
+    BoundedQueue(size_t capacity):
+        mCapacity(capacity ? capacity : 1),
+        mClosed(false)
+    {}
+
+    /// add an item, returning `false` if the queue has been closed
+    bool
+    push(T &&item) {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (!mClosed && mItems.size() >= mCapacity) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            mNotFull.wait(lock, [this]() { return mClosed || mItems.size() < mCapacity; });
+            mStatistics.fullSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        if (mClosed)
+            return false;
+
+        mItems.push_back(std::move(item));
+
+        ++mStatistics.pushes;
+        mStatistics.depthSum += mItems.size();
+        if (mItems.size() > mStatistics.maxDepth) {
+            mStatistics.maxDepth = mItems.size();
+        }
+
+        lock.unlock();
+        mNotEmpty.notify_one();
+
+        return true;
+    }
+
+    /// take an item, returning `false` once the queue is closed and empty
+    bool
+    pop(T &item) {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (!mClosed && mItems.empty()) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            mNotEmpty.wait(lock, [this]() { return mClosed || !mItems.empty(); });
+            mStatistics.emptySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        if (mItems.empty())
+            return false;
+
+        item = std::move(mItems.front());
+        mItems.pop_front();
+
+        lock.unlock();
+        mNotFull.notify_one();
+
+        return true;
+    }
+
+    /// stop accepting items, letting consumers drain the queue
+    void
+    close() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosed = true;
+        }
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+    /// close the queue and discard the items in it
+    void
+    abort() {
+        std::deque<T> discarded;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClosed = true;
+            discarded.swap(mItems);
+        }
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+    /// get the maximum number of items in the queue
+    inline size_t
+    capacity() const {
+        return mCapacity;
+    }
+
+    /// get a copy of the statistics
+    Statistics
+    statistics() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStatistics;
+    }
+
+protected:
+    size_t mCapacity;           /// the maximum number of items
+    bool mClosed;               /// whether items are still accepted
+    std::deque<T> mItems;       /// the queued items
+    Statistics mStatistics;     /// what happened so far
+
+    mutable std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+};
+
+#endif /* BOUNDEDQUEUE_H_ */
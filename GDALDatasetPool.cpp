@@ -0,0 +1,75 @@
+/**
+ * @file GDALDatasetPool.cpp
+ * @brief this defines the `GDALDatasetPool` class
+ */
+
+#include "STTException.h"
+#include "GDALDatasetPool.h"
+#include "GDALTiler.h"
+
+using namespace stt;
+
+/// close a pooled handle along with the overviews opened on it
+static void
+closeDataset(GDALDataset *poDataset) {
+    if (poDataset != NULL) {
+        GDALTiler::releaseOverviews(poDataset);
+        GDALClose(poDataset);
+    }
+}
+
+stt::GDALDatasetPool::GDALDatasetPool(const std::string &filename, GIntBig cacheBytes):
+    mFilename(filename)
+{
+    if (cacheBytes > 0) {
+        GDALSetCacheMax64(cacheBytes);
+    }
+}
+
+stt::GDALDatasetPool::~GDALDatasetPool()
+{
+    resize(0);
+}
+
+void
+stt::GDALDatasetPool::resize(unsigned int workers)
+{
+    for (size_t i = workers; i < mDatasets.size(); ++i) {
+        closeDataset(mDatasets[i]);
+    }
+    mDatasets.resize(workers, NULL);
+}
+
+/**
+* @details every worker only touches its own slot, and the slots are not moved
+* while workers run, so the handles are looked up without a lock.
+*/
+GDALDataset *
+stt::GDALDatasetPool::dataset(unsigned int worker)
+{
+    if (worker >= mDatasets.size()) {
+        throw STTException("The dataset pool has no handle for the worker");
+    }
+
+    GDALDataset *&poDataset = mDatasets[worker];
+    if (poDataset == NULL) {
+        poDataset = GDALDataset::FromHandle(GDALOpen(mFilename.c_str(), GA_ReadOnly));
+        if (poDataset == NULL) {
+            throw STTException("Could not open GDAL dataset");
+        }
+    }
+
+    return poDataset;
+}
+
+size_t
+stt::GDALDatasetPool::size() const
+{
+    size_t opened = 0;
+    for (size_t i = 0; i < mDatasets.size(); ++i) {
+        if (mDatasets[i] != NULL) {
+            ++opened;
+        }
+    }
+    return opened;
+}
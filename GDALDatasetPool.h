@@ -0,0 +1,90 @@
+#ifndef GDALDATASETPOOL_H_
+#define GDALDATASETPOOL_H_
+
+/**
+ * @file GDALDatasetPool.h
+ * @brief this declares the `GDALDatasetPool` class
+ */
+
+#include <string>
+#include <vector>
+
+#include "gdal_priv.h"
+
+#include "config.h"
+
+namespace stt {
+    class GDALDatasetPool;
+}
+
+/**
+ * @brief hand out a separate GDAL dataset handle to every worker
+ *
+ * GDAL dataset handles must not be used by more than one thread at a time. a
+ * pool is associated with the name of a raster and holds a handle slot for
+ * each worker, opening the handle of a slot the first time its worker asks for
+ * it with `GDALDatasetPool::dataset`. the slots are keyed by worker index
+ * rather than by thread, so a worker keeps its handle when the threads are
+ * started again, as a scheduler does for every run, and no lock is taken:
+ *
+ * \code
+ *   GDALDatasetPool pool(filename, cacheBytes);
+ *   pool.resize(scheduler.threadCount());
+ *   scheduler.run([&](unsigned int worker, const TileCoordinate &coord) {
+ *     MeshTile *tile = tiler.createMesh(pool.dataset(worker), coord, reader);
+ *   });
+ * \endcode
+ *
+ * the raster blocks read through all the handles are held in the GDAL block
+ * cache, which is shared by the whole process, so a single cache budget
+ * applies to the pool as a whole. all handles are closed when the pool is
+ * destroyed.
+ */
+class STT_DLL stt::GDALDatasetPool
+{
+public:
+    /// create a pool for a raster with a block cache size (`0` keeps the GDAL default)
+    GDALDatasetPool(const std::string &filename, GIntBig cacheBytes = 0);
+
+    /// pools own their handles so they are not copied
+    GDALDatasetPool(const GDALDatasetPool &other) = delete;
+    GDALDatasetPool &operator=(const GDALDatasetPool &other) = delete;
+
+    /// the destructor closes all handles
+    ~GDALDatasetPool();
+
+    /// set the number of workers, closing the handles of the workers dropped.
+    /// this must not be called while any worker uses its handle
+    void
+    resize(unsigned int workers);
+
+    /// get the handle of a worker, opening it if necessary. a worker index is
+    /// only ever used by one thread at a time
+    GDALDataset *
+    dataset(unsigned int worker);
+
+    /// get the number of workers with a handle slot
+    inline unsigned int
+    workers() const {
+        return mDatasets.size();
+    }
+
+    /// get the number of handles opened so far
+    size_t
+    size() const;
+
+    /// get the name of the raster the handles are opened on
+    inline const std::string &
+    filename() const {
+        return mFilename;
+    }
+
+protected:
+    /// the name of the raster
+    std::string mFilename;
+
+    /// the handle of each worker, `NULL` until it is opened
+    std::vector<GDALDataset *> mDatasets;
+};
+
+#endif /* GDALDATASETPOOL_H_ */
@@ -3,6 +3,16 @@
 * @brief this defines the `GDALDatasetReader` class
 */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "gdal_priv.h"
 #include "gdalwarper.h"
 
@@ -22,24 +32,64 @@ stt::GDALDatasetReader::readRasterHeights(const GDALTiler &tiler,
     GDALDataset *dataset, const TileCoordinate &coord,
     stt::i_tile tileSizeX, stt::i_tile tileSizeY)
 {
-    // the raster associated with this tile coordinate
-    GDALTile *rasterTile = createRasterTile(tiler, dataset, coord);
-
     const stt::i_tile TILE_CELL_SIZE = tileSizeX * tileSizeY;
     float *rasterHeights = (float *)CPLCalloc(TILE_CELL_SIZE, sizeof(float));
 
+    try {
+        readRasterHeights(tiler, dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+    } catch (...) {
+        CPLFree(rasterHeights);
+        throw;
+    }
+
+    return rasterHeights;
+}
+
+/// read a region of raster heights into a buffer with a tiler
+void
+stt::GDALDatasetReader::readRasterHeights(const GDALTiler &tiler,
+    GDALDataset *dataset, const TileCoordinate &coord,
+    stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights)
+{
+    // datasets aligned with the grid don't need warping
+    const stt::i_tile tileSize = tiler.grid().tileSize();
+    if (tileSizeX == tileSize && tileSizeY == tileSize &&
+        readAlignedRasterHeights(tiler, dataset, coord, 1, 1, heights)) {
+        return;
+    }
+
+    // the raster associated with this tile coordinate
+    GDALTile *rasterTile = createRasterTile(tiler, dataset, coord);
+
     GDALRasterBand *heightsBand = rasterTile->dataset->GetRasterBand(1);
 
     if (heightsBand->RasterIO(GF_Read, 0, 0, tileSizeX, tileSizeY,
-        (void *) rasterHeights, tileSizeX, tileSizeY, GDT_Float32,
+        (void *) heights, tileSizeX, tileSizeY, GDT_Float32,
         0, 0) != CE_None) {
         delete rasterTile;
-        CPLFree(rasterHeights);
 
         throw STTException("Could not read heights from raster");
     }
 
     delete rasterTile;
+}
+
+/**
+* @details the array is allocated with `CPLMalloc` and filled by the reader.
+*/
+float *
+stt::GDALDatasetReader::readRasterHeights(GDALDataset *dataset,
+    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY)
+{
+    float *rasterHeights = (float *)CPLMalloc((size_t) tileSizeX * tileSizeY * sizeof(float));
+
+    try {
+        readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+    } catch (...) {
+        CPLFree(rasterHeights);
+        throw;
+    }
+
     return rasterHeights;
 }
 
@@ -51,6 +101,58 @@ stt::GDALDatasetReader::createRasterTile(const GDALTiler &tiler,
     return tiler.createRasterTile(dataset, coord);
 }
 
+/// create a raster tile covering a block of tiles
+GDALTile *
+stt::GDALDatasetReader::createRasterTile(const GDALTiler &tiler,
+    GDALDataset *dataset, const TileCoordinate &coord, stt::i_tile columns,
+    stt::i_tile rows)
+{
+    return tiler.createRasterTile(dataset, coord, columns, rows);
+}
+
+/// warp the heights of a block of tiles into a buffer
+void
+stt::GDALDatasetReader::warpRasterHeights(const GDALTiler &tiler,
+    GDALDataset *dataset, const TileCoordinate &coord, stt::i_tile columns,
+    stt::i_tile rows, float *heights)
+{
+    tiler.warpRasterHeights(dataset, coord, columns, rows, heights);
+}
+
+/// warp heights from a geotransform into a buffer
+void
+stt::GDALDatasetReader::warpRasterHeights(const GDALTiler &tiler,
+    GDALDataset *dataset, double (&adfGeoTransform)[6], int width, int height,
+    float *heights, bool overlay)
+{
+    tiler.warpRasterHeights(dataset, adfGeoTransform, width, height, heights, overlay);
+}
+
+/// get the geotransform and size in pixels of a block of tiles
+void
+stt::GDALDatasetReader::rasterGeometry(const GDALTiler &tiler,
+    const TileCoordinate &coord, stt::i_tile columns, stt::i_tile rows,
+    double (&adfGeoTransform)[6], int &width, int &height)
+{
+    tiler.rasterGeometry(coord, columns, rows, adfGeoTransform, width, height);
+}
+
+/**
+* @details `heights` must hold the heights of the whole block, which is a
+* single tile for a block of one column and row.
+*/
+bool
+stt::GDALDatasetReader::readAlignedRasterHeights(const GDALTiler &tiler,
+    GDALDataset *dataset, const TileCoordinate &coord, stt::i_tile columns,
+    stt::i_tile rows, float *heights)
+{
+    double adfGeoTransform[6];
+    int width, height;
+    tiler.rasterGeometry(coord, columns, rows, adfGeoTransform, width, height);
+
+    return tiler.readAlignedRasterHeights(dataset, adfGeoTransform, width, height, heights);
+}
+
 /// create a raster tile from a GDALDataset
 GDALDataset *
 stt::GDALDatasetReader::createOverview(const GDALTiler &tiler,
@@ -68,7 +170,7 @@ stt::GDALDatasetReader::createOverview(const GDALTiler &tiler,
         adfGeoTransform[1] *= nFactorScale;
         adfGeoTransform[5] *= nFactorScale;
 
-        TerrainTiler tempTiler(tiler.dataset(), tiler.grid(), tiler.options);
+        TerrainTiler tempTiler(dataset, tiler.grid(), tiler.options);
         tempTiler.crsWKT = "";
 
         GDALTile *rasterTile = createRasterTile(tempTiler, dataset, coord);
@@ -87,16 +189,21 @@ stt::GDALDatasetReaderWithOverviews::~GDALDatasetReaderWithOverviews()
     reset();
 }
 
-/// read a region of raster heights into an array for the specified
+/// read a region of raster heights into a buffer for the specified
 /// Dataset and Coordinate
-float *
+void
 stt::GDALDatasetReaderWithOverviews::readRasterHeights(GDALDataset *dataset,
-    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY)
+    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY,
+    float *rasterHeights)
 {
     GDALDataset *mainDataset = dataset;
 
-    const stt::i_tile TILE_CELL_SIZE = tileSizeX *tileSizeY;
-    float *rasterHeights = (float *)CPLCalloc(TILE_CELL_SIZE, sizeof(float));
+    // datasets aligned with the grid don't need warping
+    const stt::i_tile tileSize = poTiler.grid().tileSize();
+    if (tileSizeX == tileSize && tileSizeY == tileSize &&
+        readAlignedRasterHeights(poTiler, dataset, coord, 1, 1, rasterHeights)) {
+        return;
+    }
 
     // replace GDAL Dataset by last valid Overview.
     for (int i = mOverviews.size() - 1; i >= 0; --i) {
@@ -125,7 +232,6 @@ stt::GDALDatasetReaderWithOverviews::readRasterHeights(GDALDataset *dataset,
                 dataset = psOverview;
             } else {
                 delete rasterTile;
-                CPLFree(rasterHeights);
                 throw STTException("Could not create an overview of current GDAL dataset");
             }
 
@@ -138,11 +244,8 @@ stt::GDALDatasetReaderWithOverviews::readRasterHeights(GDALDataset *dataset,
 
     // everything ok?
     if (!rasterOk) {
-        CPLFree(rasterHeights);
         throw STTException("Could not read heights from raster");
     }
-
-    return rasterHeights;
 }
 
 /// releases all overviews
@@ -153,7 +256,623 @@ stt::GDALDatasetReaderWithOverviews::reset()
 
     for (int i = mOverviews.size() - 1; i >= 0; --i) {
         GDALDataset *poOverview = mOverviews[i];
+        GDALTiler::releaseOverviews(poOverview);
         GDALClose(poOverview);
     }
     mOverviews.clear();
 }
+
+stt::GDALDatasetReaderWithPyramid::GDALDatasetReaderWithPyramid(
+    const GDALTiler &tiler, HeightFieldStore &store, GDALDatasetReader &reader,
+    i_zoom baseZoom):
+    poTiler(tiler),
+    mStore(store),
+    mReader(reader),
+    mBaseZoom(baseZoom),
+    mNoDataValue(-32768)
+{
+    // use the same no data value as the warper
+    GDALDataset *dataset = tiler.dataset();
+    if (dataset && dataset->GetRasterCount() > 0) {
+        int bGotNoData = FALSE;
+        double noDataValue = dataset->GetRasterBand(1)->GetNoDataValue(&bGotNoData);
+
+        if (bGotNoData) mNoDataValue = noDataValue;
+    }
+}
+
+/// read a region of raster heights into a buffer for the specified
+/// Dataset and Coordinate
+void
+stt::GDALDatasetReaderWithPyramid::readRasterHeights(GDALDataset *dataset,
+    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY,
+    float *rasterHeights)
+{
+    if (tileSizeX != tileSizeY || (size_t) tileSizeX * tileSizeY != mStore.cellCount()) {
+        throw STTException("The tile size does not match the height store");
+    }
+
+    // the tile may have been read already e.g. as the neighbour of another
+    if (mStore.get(coord, rasterHeights))
+        return;
+
+    if (coord.zoom >= mBaseZoom || !readFromChildren(coord, tileSizeX, rasterHeights)) {
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+    }
+
+    mStore.put(coord, rasterHeights);
+}
+
+/**
+* @details the heights of a tile sample cells which are twice the size of
+* those of its children, so every parent height is the average of a 2x2 block
+* of child heights. with `n` being the tile size less the overlapping border,
+* parent height `(i, j)` (`j` counting rows from the north) covers child cells
+* `2i - 1` and `2i` in the west to east direction and `2j + 1` and `2j + 2` in
+* the north to south direction, counted across the children as though they
+* were a single raster of `2n + 1` heights. the blocks along the west and
+* south edges of the tile reach into the children of the neighbouring tiles,
+* which are used if they are stored. otherwise only the heights within the
+* children are averaged.
+*/
+bool
+stt::GDALDatasetReaderWithPyramid::readFromChildren(const TileCoordinate &coord,
+    stt::i_tile tileSize, float *heights)
+{
+    const int n = tileSize - 1;
+    const i_zoom zoom = coord.zoom + 1;
+
+    // load the children in the middle and east columns of rows 0 (north) and
+    // 1 (south) plus their neighbours to the west and south, if stored
+    for (int dy = 0; dy < 3; ++dy) {
+        for (int dx = -1; dx < 2; ++dx) {
+            std::vector<float> &child = mChildHeights[dy][dx + 1];
+            bool required = (dx >= 0 && dy < 2);
+            bool outside = (dx < 0 && coord.x == 0) || (dy == 2 && coord.y == 0);
+
+            child.resize(mStore.cellCount());
+
+            if (outside || !mStore.get(TileCoordinate(zoom, 2 * coord.x + dx, 2 * coord.y + 1 - dy), child.data())) {
+                if (required)
+                    return false;
+
+                child.clear();
+            }
+        }
+    }
+
+    for (int j = 0; j < (int) tileSize; ++j) {
+        for (int i = 0; i < (int) tileSize; ++i) {
+            double sum = 0;
+            int count = 0;
+
+            for (int k = 2 * j + 1; k <= 2 * j + 2; ++k) {
+                int dy = (k - 1) / n;
+                int y = k - (dy * n);
+
+                for (int c = 2 * i - 1; c <= 2 * i; ++c) {
+                    int dx = (c < 0) ? -1 : (c == 0) ? 0 : (c - 1) / n;
+                    int x = c - (dx * n);
+                    const std::vector<float> &child = mChildHeights[dy][dx + 1];
+
+                    if (child.empty() || child[(y * tileSize) + x] == mNoDataValue)
+                        continue;
+
+                    sum += child[(y * tileSize) + x];
+                    ++count;
+                }
+            }
+
+            heights[(j * tileSize) + i] = count ? (float) (sum / count) : (float) mNoDataValue;
+        }
+    }
+
+    return true;
+}
+
+stt::GDALDatasetReaderWithSuperTiles::GDALDatasetReaderWithSuperTiles(
+    const GDALTiler &tiler, GDALDatasetReader &reader, stt::i_tile batchSize,
+    size_t blockCount):
+    poTiler(tiler),
+    mReader(reader),
+    mBatchSize(batchSize ? batchSize : 1),
+    mBlockCount(blockCount ? blockCount : 1)
+{}
+
+/// read a region of raster heights into a buffer for the specified
+/// Dataset and Coordinate
+void
+stt::GDALDatasetReaderWithSuperTiles::readRasterHeights(GDALDataset *dataset,
+    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY,
+    float *rasterHeights)
+{
+    const Block *block = NULL;
+    const stt::i_tile tileSize = poTiler.grid().tileSize();
+
+    if (tileSizeX == tileSize && tileSizeY == tileSize) {
+        block = readBlock(dataset, coord);
+    }
+
+    if (block == NULL) {
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+        return;
+    }
+
+    // the distance between the first pixels of neighbouring tiles, which is
+    // less than the tile size when they share their edges
+    const int stepX = (block->columns > 1) ? (block->width - tileSize) / (block->columns - 1) : 0;
+    const int stepY = (block->rows > 1) ? (block->height - tileSize) / (block->rows - 1) : 0;
+
+    // rows are stored from the north whereas tiles are numbered from the south
+    const int offsetX = (coord.x - block->origin.x) * stepX;
+    const int offsetY = (block->origin.y + block->rows - 1 - coord.y) * stepY;
+
+    const float *source = &block->heights[(size_t) offsetY * block->width + offsetX];
+
+    for (stt::i_tile row = 0; row < tileSize; ++row) {
+        std::copy(source, source + tileSize, rasterHeights + row * tileSize);
+        source += block->width;
+    }
+}
+
+/**
+* @details `NULL` is returned if the tile lies outside the dataset or the
+* block can't be read, in which case the tile should be read on its own.
+*/
+const stt::GDALDatasetReaderWithSuperTiles::Block *
+stt::GDALDatasetReaderWithSuperTiles::readBlock(GDALDataset *dataset,
+    const TileCoordinate &coord)
+{
+    const TileBounds extent = poTiler.tileBoundsForZoom(coord.zoom);
+
+    if (coord.x < extent.getMinX() || coord.x > extent.getMaxX() ||
+        coord.y < extent.getMinY() || coord.y > extent.getMaxY()) {
+        return NULL;
+    }
+
+    const TileCoordinate origin(coord.zoom,
+        extent.getMinX() + (coord.x - extent.getMinX()) / mBatchSize * mBatchSize,
+        extent.getMinY() + (coord.y - extent.getMinY()) / mBatchSize * mBatchSize);
+
+    for (std::list<Block>::iterator it = mBlocks.begin(); it != mBlocks.end(); ++it) {
+        if (it->dataset == dataset && it->origin == origin) {
+            mBlocks.splice(mBlocks.begin(), mBlocks, it);
+            return &mBlocks.front();
+        }
+    }
+
+    // reuse the buffer of the least recently used block
+    if (mBlocks.size() < mBlockCount) {
+        mBlocks.emplace_front();
+    } else {
+        mBlocks.splice(mBlocks.begin(), mBlocks, std::prev(mBlocks.end()));
+    }
+
+    Block &block = mBlocks.front();
+    block.dataset = NULL;
+    block.origin = origin;
+    block.columns = std::min(mBatchSize, extent.getMaxX() - origin.x + 1);
+    block.rows = std::min(mBatchSize, extent.getMaxY() - origin.y + 1);
+
+    double adfGeoTransform[6];
+    rasterGeometry(poTiler, origin, block.columns, block.rows, adfGeoTransform,
+        block.width, block.height);
+    block.heights.resize((size_t) block.width * block.height);
+
+    // datasets aligned with the grid don't need warping
+    CPLErr err = CE_None;
+    if (!readAlignedRasterHeights(poTiler, dataset, origin, block.columns,
+            block.rows, block.heights.data())) {
+        GDALTile *rasterTile = createRasterTile(poTiler, dataset, origin, block.columns, block.rows);
+
+        GDALRasterBand *heightsBand = rasterTile->dataset->GetRasterBand(1);
+        err = heightsBand->RasterIO(GF_Read, 0, 0, block.width, block.height,
+            (void *) block.heights.data(), block.width, block.height, GDT_Float32,
+            0, 0);
+
+        delete rasterTile;
+    }
+
+    if (err != CE_None) {
+        mBlocks.pop_front();
+        return NULL;
+    }
+
+    block.dataset = dataset;
+    return &block;
+}
+
+/// read a region of raster heights into a buffer for the specified
+/// Dataset and Coordinate
+void
+stt::GDALDatasetReaderWithDirectWarp::readRasterHeights(GDALDataset *dataset,
+    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY,
+    float *rasterHeights)
+{
+    const stt::i_tile tileSize = poTiler.grid().tileSize();
+
+    if (tileSizeX != tileSize || tileSizeY != tileSize) {
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+        return;
+    }
+
+    try {
+        warpRasterHeights(poTiler, dataset, coord, 1, 1, rasterHeights);
+    } catch (const STTException &) {
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+    }
+}
+
+stt::GDALDatasetReaderWithMapping::GDALDatasetReaderWithMapping(
+    const GDALTiler &tiler, GDALDatasetReader &reader, TileOrder order):
+    poTiler(tiler),
+    mReader(reader),
+    mOrder(order)
+{
+    mMapping.dataset = NULL;
+    mMapping.memory = NULL;
+}
+
+stt::GDALDatasetReaderWithMapping::~GDALDatasetReaderWithMapping()
+{
+    unmap();
+}
+
+/// get the value of a mapped pixel as a double
+template <typename T>
+static inline double
+mappedValue(const unsigned char *pixel)
+{
+    T value;
+    std::memcpy(&value, pixel, sizeof(T));
+    return (double) value;
+}
+
+/**
+* @brief resample the heights of a geotransform from a mapped raster
+*
+* each height covers a rectangle of source pixels, from `x0` to `x1` and
+* `y0` to `y1` in fractional pixel coordinates. pixels without data are left
+* out, and a height without any source data is set to the no data value.
+*/
+template <typename T>
+static void
+resampleMapped(const GDALDatasetReaderWithMapping::Mapping &mapping,
+    const double (&adfGeoTransform)[6], int width, int height,
+    GDALResampleAlg resampleAlg, double noDataValue, float *heights)
+{
+    const double *src = mapping.adfGeoTransform;
+    const double scaleX = adfGeoTransform[1] / src[1];
+    const double scaleY = adfGeoTransform[5] / src[5];
+
+    auto pixel = [&](int x, int y, double &value) {
+        x = std::min(std::max(x, 0), mapping.width - 1);
+        y = std::min(std::max(y, 0), mapping.height - 1);
+        value = mappedValue<T>(mapping.data + y * mapping.lineSpace + (GIntBig) x * mapping.pixelSpace);
+
+        return !std::isnan(value) && !(mapping.hasNoData && value == mapping.noDataValue);
+    };
+
+    for (int j = 0; j < height; ++j) {
+        const double y0 = (adfGeoTransform[3] + j * adfGeoTransform[5] - src[3]) / src[5];
+        const double y1 = y0 + scaleY;
+
+        for (int i = 0; i < width; ++i) {
+            const double x0 = (adfGeoTransform[0] + i * adfGeoTransform[1] - src[0]) / src[1];
+            const double x1 = x0 + scaleX;
+
+            double sum = 0, weights = 0, value;
+
+            if (resampleAlg == GRA_NearestNeighbour) {
+                if (pixel((int) std::floor((x0 + x1) / 2), (int) std::floor((y0 + y1) / 2), value)) {
+                    sum = value;
+                    weights = 1;
+                }
+            } else if (resampleAlg == GRA_Bilinear) {
+                // interpolate between the centres of the four nearest pixels
+                const double cx = (x0 + x1) / 2 - 0.5, cy = (y0 + y1) / 2 - 0.5;
+                const int px = (int) std::floor(cx), py = (int) std::floor(cy);
+                const double fx = cx - px, fy = cy - py;
+
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        const double weight = (dx ? fx : 1 - fx) * (dy ? fy : 1 - fy);
+
+                        if (weight > 0 && pixel(px + dx, py + dy, value)) {
+                            sum += weight * value;
+                            weights += weight;
+                        }
+                    }
+                }
+            } else {
+                // weight each pixel by the area of it covered by the height
+                for (int y = (int) std::floor(y0); y < y1; ++y) {
+                    const double wy = std::min(y1, y + 1.0) - std::max(y0, (double) y);
+
+                    for (int x = (int) std::floor(x0); x < x1; ++x) {
+                        const double wx = std::min(x1, x + 1.0) - std::max(x0, (double) x);
+
+                        if (wx > 0 && wy > 0 && pixel(x, y, value)) {
+                            sum += wx * wy * value;
+                            weights += wx * wy;
+                        }
+                    }
+                }
+            }
+
+            heights[j * width + i] = (float) ((weights > 0) ? sum / weights : noDataValue);
+        }
+    }
+}
+
+/// read a region of raster heights into a buffer for the specified
+/// Dataset and Coordinate
+void
+stt::GDALDatasetReaderWithMapping::readRasterHeights(GDALDataset *dataset,
+    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY,
+    float *rasterHeights)
+{
+    const TilerOptions &options = tilerOptions(poTiler);
+    const GDALResampleAlg resampleAlg = options.resampleAlg;
+
+    const bool supported = (resampleAlg == GRA_NearestNeighbour ||
+        resampleAlg == GRA_Bilinear || resampleAlg == GRA_Average);
+
+    if (!supported || poTiler.requiresReprojection() || !map(dataset)) {
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+        return;
+    }
+
+    double adfGeoTransform[6];
+    int width, height;
+    rasterGeometry(poTiler, coord, 1, 1, adfGeoTransform, width, height);
+
+    // the source pixels covered by the tile
+    const double *src = mMapping.adfGeoTransform;
+    const double scaleX = adfGeoTransform[1] / src[1];
+    const double scaleY = adfGeoTransform[5] / src[5];
+    const double dfXOff = (adfGeoTransform[0] - src[0]) / src[1];
+    const double dfYOff = (adfGeoTransform[3] - src[3]) / src[5];
+    const double dfXSize = width * scaleX;
+    const double dfYSize = height * scaleY;
+
+    // tiles beyond the raster, at the wrong size or far below the resolution
+    // of the raster are better left to GDAL and its overviews
+    if ((stt::i_tile) width != tileSizeX || (stt::i_tile) height != tileSizeY ||
+        scaleX > maxSampleRatio || scaleY > maxSampleRatio ||
+        dfXOff < 0 || dfYOff < 0 ||
+        dfXOff + dfXSize > mMapping.width || dfYOff + dfYSize > mMapping.height) {
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+        return;
+    }
+
+    const int xOff = (int) std::floor(dfXOff), yOff = (int) std::floor(dfYOff);
+    adviseWindow(xOff, yOff,
+        std::min((int) std::ceil(dfXOff + dfXSize) + 1, mMapping.width) - xOff,
+        std::min((int) std::ceil(dfYOff + dfYSize) + 1, mMapping.height) - yOff);
+
+    // heights without data are set as the warper sets them
+    const double noDataValue = mMapping.hasNoData ? mMapping.noDataValue : -32768;
+
+    switch (mMapping.dataType) {
+    case GDT_Byte:
+        resampleMapped<GByte>(mMapping, adfGeoTransform, width, height, resampleAlg, noDataValue, rasterHeights);
+        break;
+    case GDT_UInt16:
+        resampleMapped<GUInt16>(mMapping, adfGeoTransform, width, height, resampleAlg, noDataValue, rasterHeights);
+        break;
+    case GDT_Int16:
+        resampleMapped<GInt16>(mMapping, adfGeoTransform, width, height, resampleAlg, noDataValue, rasterHeights);
+        break;
+    case GDT_UInt32:
+        resampleMapped<GUInt32>(mMapping, adfGeoTransform, width, height, resampleAlg, noDataValue, rasterHeights);
+        break;
+    case GDT_Int32:
+        resampleMapped<GInt32>(mMapping, adfGeoTransform, width, height, resampleAlg, noDataValue, rasterHeights);
+        break;
+    case GDT_Float32:
+        resampleMapped<float>(mMapping, adfGeoTransform, width, height, resampleAlg, noDataValue, rasterHeights);
+        break;
+    case GDT_Float64:
+        resampleMapped<double>(mMapping, adfGeoTransform, width, height, resampleAlg, noDataValue, rasterHeights);
+        break;
+    default:
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, rasterHeights);
+        break;
+    }
+}
+
+/**
+* @details GDAL only maps a band directly when its pixels are uncompressed,
+* in native byte order and laid out contiguously in the file. a dataset
+* which can't be mapped is remembered so that it isn't tried again.
+*/
+bool
+stt::GDALDatasetReaderWithMapping::map(GDALDataset *dataset)
+{
+    if (dataset == mMapping.dataset) {
+        return mMapping.memory != NULL;
+    }
+
+    unmap();
+    mMapping.dataset = dataset;
+
+    if (dataset == NULL || dataset->GetRasterCount() < 1 ||
+        dataset->GetGeoTransform(mMapping.adfGeoTransform) != CE_None) {
+        return false;
+    }
+
+    // only north up rasters without rotation can be sampled by rows
+    const double *src = mMapping.adfGeoTransform;
+    if (src[2] != 0 || src[4] != 0 || src[1] <= 0 || src[5] >= 0) {
+        return false;
+    }
+
+    GDALRasterBand *band = dataset->GetRasterBand(1);
+    CPLStringList options;
+    options.SetNameValue("USE_DEFAULT_IMPLEMENTATION", "NO");
+
+    mMapping.memory = band->GetVirtualMemAuto(GF_Read, &mMapping.pixelSpace,
+        &mMapping.lineSpace, options.List());
+    if (mMapping.memory == NULL) {
+        return false;
+    }
+
+    int bGotNoData = FALSE;
+    mMapping.data = (const unsigned char *) CPLVirtualMemGetAddr(mMapping.memory);
+    mMapping.dataType = band->GetRasterDataType();
+    mMapping.width = dataset->GetRasterXSize();
+    mMapping.height = dataset->GetRasterYSize();
+    mMapping.noDataValue = band->GetNoDataValue(&bGotNoData);
+    mMapping.hasNoData = bGotNoData;
+
+#if defined(__unix__) || defined(__APPLE__)
+    // rows of tiles read through the raster from one end to the other
+    // whereas other orders jump between lines, making read ahead a waste
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) mMapping.data & ~(uintptr_t) (pageSize - 1);
+    size_t length = CPLVirtualMemGetSize(mMapping.memory) + ((uintptr_t) mMapping.data - start);
+
+    madvise((void *) start, length, (mOrder == TILE_ORDER_ROW) ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+
+    return true;
+}
+
+void
+stt::GDALDatasetReaderWithMapping::unmap()
+{
+    if (mMapping.memory != NULL) {
+        CPLVirtualMemFree(mMapping.memory);
+    }
+
+    mMapping.dataset = NULL;
+    mMapping.memory = NULL;
+}
+
+/**
+* @details without read ahead each page of a tile would be faulted in on its
+* own, so the pages of each line of the window are requested up front where
+* the tiles aren't read in rows.
+*/
+void
+stt::GDALDatasetReaderWithMapping::adviseWindow(int xOff, int yOff,
+    int xSize, int ySize) const
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (mOrder == TILE_ORDER_ROW || mMapping.pixelSpace <= 0 || mMapping.lineSpace <= 0)
+        return;
+
+    const long pageSize = sysconf(_SC_PAGESIZE);
+
+    for (int y = yOff; y < yOff + ySize; ++y) {
+        const unsigned char *first = mMapping.data + y * mMapping.lineSpace + (GIntBig) xOff * mMapping.pixelSpace;
+        uintptr_t start = (uintptr_t) first & ~(uintptr_t) (pageSize - 1);
+        size_t length = (size_t) xSize * mMapping.pixelSpace + ((uintptr_t) first - start);
+
+        madvise((void *) start, length, MADV_WILLNEED);
+    }
+#else
+    (void) xOff; (void) yOff; (void) xSize; (void) ySize;
+#endif
+}
+
+stt::GDALDatasetReaderWithMosaic::~GDALDatasetReaderWithMosaic()
+{
+    for (std::list<OpenSource>::const_iterator it = mOpen.begin(); it != mOpen.end(); ++it) {
+        closeSource(*it);
+    }
+}
+
+void
+stt::GDALDatasetReaderWithMosaic::closeSource(const OpenSource &source)
+{
+    // the tiler holds the last reference, closing the dataset and releasing
+    // its overviews and transformers
+    delete source.tiler;
+}
+
+const stt::GDALDatasetReaderWithMosaic::OpenSource &
+stt::GDALDatasetReaderWithMosaic::openSource(size_t index)
+{
+    for (std::list<OpenSource>::iterator it = mOpen.begin(); it != mOpen.end(); ++it) {
+        if (it->index == index) {
+            mOpen.splice(mOpen.begin(), mOpen, it);
+            return mOpen.front();
+        }
+    }
+
+    while (!mOpen.empty() && mOpen.size() >= mMaxOpen) {
+        closeSource(mOpen.back());
+        mOpen.pop_back();
+    }
+
+    const std::string &filename = mIndex.sources()[index].filename;
+    GDALDataset *dataset = GDALDataset::FromHandle(GDALOpen(filename.c_str(), GA_ReadOnly));
+    if (dataset == NULL) {
+        throw STTException("Could not open a mosaic source");
+    }
+
+    OpenSource source;
+    source.index = index;
+    source.dataset = (GDALDatasetH) dataset;
+
+    try {
+        source.tiler = new TerrainTiler(dataset, poTiler.grid(), tilerOptions(poTiler));
+    } catch (...) {
+        GDALClose(dataset);
+        throw;
+    }
+
+    // hand the dataset over to the tiler
+    dataset->Dereference();
+
+    mOpen.push_front(source);
+    return mOpen.front();
+}
+
+/**
+* @details the sources overlapping the tile by less than a pixel of the
+* tile are included, as resampling near the edge of the tile can read them.
+* the finest sources are warped last so that they take precedence where the
+* sources overlap.
+*/
+void
+stt::GDALDatasetReaderWithMosaic::readRasterHeights(GDALDataset *dataset,
+    const TileCoordinate &coord, stt::i_tile tileSizeX, stt::i_tile tileSizeY,
+    float *rasterHeights)
+{
+    double adfGeoTransform[6];
+    int width, height;
+    rasterGeometry(poTiler, coord, 1, 1, adfGeoTransform, width, height);
+
+    // stretch the pixels over the size requested
+    adfGeoTransform[1] *= (double) width / tileSizeX;
+    adfGeoTransform[5] *= (double) height / tileSizeY;
+    width = tileSizeX;
+    height = tileSizeY;
+
+    const double margin = adfGeoTransform[1];
+    CRSBounds bounds(
+        adfGeoTransform[0] - margin,
+        adfGeoTransform[3] + height * adfGeoTransform[5] - margin,
+        adfGeoTransform[0] + width * adfGeoTransform[1] + margin,
+        adfGeoTransform[3] + margin
+    );
+
+    const std::vector<MosaicIndex::Source> &sources = mIndex.sources();
+    mIndex.query(bounds, mFound);
+    std::sort(mFound.begin(), mFound.end(), [&](size_t a, size_t b) {
+        return sources[a].resolution > sources[b].resolution ||
+            (sources[a].resolution == sources[b].resolution && a < b);
+    });
+
+    std::fill(rasterHeights, rasterHeights + (size_t) width * height, 0.0f);
+
+    for (size_t i = 0; i < mFound.size(); ++i) {
+        const OpenSource &source = openSource(mFound[i]);
+
+        warpRasterHeights(*source.tiler, GDALDataset::FromHandle(source.dataset),
+            adfGeoTransform, width, height, rasterHeights, true);
+    }
+}
@@ -6,17 +6,28 @@
 * @brief this declares the `GDALDatasetReader` class
 */
 
+#include <list>
 #include <string>
 #include <vector>
 #include "gdalwarper.h"
 
+#include "cpl_virtualmem.h"
+
 #include "TileCoordinate.h"
+#include "GridIterator.h"
 #include "GDALTiler.h"
 #include "TerrainTiler.h"
+#include "HeightFieldStore.h"
+#include "MosaicIndex.h"
 
 namespace stt {
     class GDALDatasetReader;
     class GDALDatasetReaderWithOverviews;
+    class GDALDatasetReaderWithPyramid;
+    class GDALDatasetReaderWithSuperTiles;
+    class GDALDatasetReaderWithDirectWarp;
+    class GDALDatasetReaderWithMapping;
+    class GDALDatasetReaderWithMosaic;
 }
 
 /**
@@ -36,11 +47,24 @@ public:
         const TileCoordinate &coord, stt::i_tile tileSizeX,
         stt::i_tile tileSizeY);
 
+    /// read a region of raster heights into a buffer of `tileSizeX` by
+    /// `tileSizeY` heights with a tiler
+    static void
+    readRasterHeights(const GDALTiler &tiler, GDALDataset *dataset,
+        const TileCoordinate &coord, stt::i_tile tileSizeX,
+        stt::i_tile tileSizeY, float *heights);
+
     /// read a region of raster heights into an array for the specified
-    /// Dataset and Coordinate
-    virtual float *
+    /// Dataset and Coordinate, which is released with `CPLFree`
+    float *
     readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
-        stt::i_tile tileSizeX, stt::i_tile tileSizeY) = 0;
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY);
+
+    /// read a region of raster heights into a buffer of `tileSizeX` by
+    /// `tileSizeY` heights for the specified Dataset and Coordinate
+    virtual void
+    readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights) = 0;
 
 protected:
     /// create a raster tile from a tile coordinate
@@ -48,6 +72,43 @@ protected:
     createRasterTile(const GDALTiler &tiler, GDALDataset *dataset,
         const TileCoordinate &coord);
 
+    /// create a raster tile covering a block of tiles north east of `coord`
+    static GDALTile *
+    createRasterTile(const GDALTiler &tiler, GDALDataset *dataset,
+        const TileCoordinate &coord, stt::i_tile columns, stt::i_tile rows);
+
+    /// warp the heights of a block of tiles north east of `coord` into a buffer
+    static void
+    warpRasterHeights(const GDALTiler &tiler, GDALDataset *dataset,
+        const TileCoordinate &coord, stt::i_tile columns, stt::i_tile rows,
+        float *heights);
+
+    /// warp heights of a size in pixels from a geotransform into a buffer,
+    /// optionally over the heights already in it
+    static void
+    warpRasterHeights(const GDALTiler &tiler, GDALDataset *dataset,
+        double (&adfGeoTransform)[6], int width, int height, float *heights,
+        bool overlay);
+
+    /// get the geotransform and size in pixels of a block of tiles
+    static void
+    rasterGeometry(const GDALTiler &tiler, const TileCoordinate &coord,
+        stt::i_tile columns, stt::i_tile rows, double (&adfGeoTransform)[6],
+        int &width, int &height);
+
+    /// read the heights of a block of tiles without warping, if the dataset
+    /// is aligned with the grid
+    static bool
+    readAlignedRasterHeights(const GDALTiler &tiler, GDALDataset *dataset,
+        const TileCoordinate &coord, stt::i_tile columns, stt::i_tile rows,
+        float *heights);
+
+    /// get the options of a tiler
+    static const TilerOptions &
+    tilerOptions(const GDALTiler &tiler) {
+        return tiler.options;
+    }
+
     /// create a VTR raster overview from GDALDataset
     static GDALDataset *
     createOverview(const GDALTiler &tiler, GDALDataset *dataset,
@@ -73,11 +134,13 @@ public:
     /// the descructor
     ~GDALDatasetReaderWithOverviews();
 
-    /// read a region of raster heights into an array for the specified
+    using GDALDatasetReader::readRasterHeights;
+
+    /// read a region of raster heights into a buffer for the specified
     /// Dataset and Coordinate
-    virtual float *
+    virtual void
     readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
-        stt::i_tile tileSizeX, stt::i_tile tileSizeY) override;
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights) override;
 
     /// releases all overviews
     void reset();
@@ -93,4 +156,294 @@ protected:
     int mOverviewIndex;
 };
 
+/**
+* @brief implements a GDALDatasetReader that derives heights from child tiles
+*
+* tiles at the base zoom level are read from the dataset by another reader.
+* the heights of every tile read are kept in a `HeightFieldStore` so that
+* tiles at lower zoom levels can be derived by averaging the heights of their
+* four children instead of warping the dataset again. tiles are therefore
+* expected to be read a zoom level at a time from the base zoom upwards. a
+* tile is read from the dataset when any of its children is not stored.
+*/
+class STT_DLL stt::GDALDatasetReaderWithPyramid: public stt::GDALDatasetReader
+{
+public:
+    /// instantiate a reader deriving tiles above a base zoom level
+    GDALDatasetReaderWithPyramid(const GDALTiler &tiler, HeightFieldStore &store,
+        GDALDatasetReader &reader, i_zoom baseZoom);
+
+    using GDALDatasetReader::readRasterHeights;
+
+    /// read a region of raster heights into a buffer for the specified
+    /// Dataset and Coordinate
+    virtual void
+    readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights) override;
+
+protected:
+    /// average the heights of the children of a tile, if they are all stored
+    bool
+    readFromChildren(const TileCoordinate &coord, stt::i_tile tileSize,
+        float *heights);
+
+    /// the tiler to use
+    const GDALTiler &poTiler;
+
+    /// the heights of the tiles read so far
+    HeightFieldStore &mStore;
+
+    /// the reader used for tiles which can't be derived
+    GDALDatasetReader &mReader;
+
+    /// the zoom level read from the dataset
+    i_zoom mBaseZoom;
+
+    /// the value of heights with no data, which are not averaged
+    double mNoDataValue;
+
+    /// the heights of the children and their neighbours
+    std::vector<float> mChildHeights[3][3];
+};
+
+/**
+* @brief implements a GDALDatasetReader that warps blocks of tiles at once
+*
+* creating the warped VRT and transformers for a tile costs more than warping
+* its few thousand heights. this reader instead warps a square block of up to
+* `batchSize` by `batchSize` tiles (a super-tile) into a single buffer and
+* copies each tile out of it, including the edges it shares with its
+* neighbours. the blocks are aligned to the south west tile of the dataset at
+* each zoom level and the few most recently used ones are kept, so the tiles
+* of a block have to be read close together in Morton or Hilbert order: in
+* column or row order every block would be evicted before the next column or
+* row comes back to it and be warped again for each of them.
+*
+* the heights are those of the tile read on its own, within the error
+* threshold of the approximate transformer if one is used. tiles outside the
+* dataset and blocks which can't be read are passed on to another reader.
+*/
+class STT_DLL stt::GDALDatasetReaderWithSuperTiles: public stt::GDALDatasetReader
+{
+public:
+    /// instantiate a reader warping blocks of `batchSize` tiles square
+    GDALDatasetReaderWithSuperTiles(const GDALTiler &tiler,
+        GDALDatasetReader &reader, stt::i_tile batchSize, size_t blockCount = 4);
+
+    using GDALDatasetReader::readRasterHeights;
+
+    /// read a region of raster heights into a buffer for the specified
+    /// Dataset and Coordinate
+    virtual void
+    readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights) override;
+
+protected:
+    /// the heights of a block of tiles
+    struct Block {
+        GDALDataset *dataset;       /// the dataset the block was read from
+        TileCoordinate origin;      /// the south west tile of the block
+        stt::i_tile columns, rows;  /// the number of tiles in the block
+        int width, height;          /// the number of heights in the block
+        std::vector<float> heights; /// the heights, row by row from the north
+    };
+
+    /// get the block containing a tile, reading it if necessary
+    const Block *
+    readBlock(GDALDataset *dataset, const TileCoordinate &coord);
+
+    /// the tiler to use
+    const GDALTiler &poTiler;
+
+    /// the reader used for tiles which can't be read from a block
+    GDALDatasetReader &mReader;
+
+    /// the number of tiles along each side of a block
+    stt::i_tile mBatchSize;
+
+    /// the number of blocks to keep
+    size_t mBlockCount;
+
+    /// the blocks read, most recently used first
+    std::list<Block> mBlocks;
+};
+
+/**
+* @brief implements a GDALDatasetReader that warps heights into its buffer
+*
+* the heights of a tile are warped by a `GDALWarpOperation` straight into the
+* array returned, rather than through a warped VRT dataset and its bands
+* which are then read with `RasterIO`. tiles which can't be warped, e.g.
+* because of 'Integer overflow' errors, are passed on to another reader.
+*/
+class STT_DLL stt::GDALDatasetReaderWithDirectWarp: public stt::GDALDatasetReader
+{
+public:
+    /// instantiate a reader warping tiles directly
+    GDALDatasetReaderWithDirectWarp(const GDALTiler &tiler, GDALDatasetReader &reader):
+        poTiler(tiler),
+        mReader(reader)
+    {}
+
+    using GDALDatasetReader::readRasterHeights;
+
+    /// read a region of raster heights into a buffer for the specified
+    /// Dataset and Coordinate
+    virtual void
+    readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights) override;
+
+protected:
+    /// the tiler to use
+    const GDALTiler &poTiler;
+
+    /// the reader used for tiles which can't be warped
+    GDALDatasetReader &mReader;
+};
+
+/**
+* @brief implements a GDALDatasetReader that samples memory mapped rasters
+*
+* uncompressed rasters whose pixels are stored contiguously in their file,
+* such as uncompressed GeoTIFFs or ENVI and BIL rasters in native byte order,
+* are mapped into memory with `GDALRasterBand::GetVirtualMemAuto`. when the
+* raster is in the grid SRS with axis aligned pixels, the heights of a tile
+* are resampled straight from the mapped pages, bypassing the GDAL block
+* cache and its lock. nearest neighbour, bilinear and average resampling are
+* supported.
+*
+* the kernel is told how the pages will be used according to the order the
+* tiles are read in: rows of tiles sweep through the raster sequentially,
+* whereas the pages of the tiles in other orders are requested as each tile
+* is read. tiles which can't be sampled, such as those at the edge of the
+* raster or far below its resolution, are passed on to another reader.
+*/
+class STT_DLL stt::GDALDatasetReaderWithMapping: public stt::GDALDatasetReader
+{
+public:
+    /// instantiate a reader for tiles read in a particular order
+    GDALDatasetReaderWithMapping(const GDALTiler &tiler, GDALDatasetReader &reader,
+        TileOrder order = TILE_ORDER_COLUMN);
+
+    /// the destructor unmaps the raster
+    ~GDALDatasetReaderWithMapping();
+
+    using GDALDatasetReader::readRasterHeights;
+
+    /// read a region of raster heights into a buffer for the specified
+    /// Dataset and Coordinate
+    virtual void
+    readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights) override;
+
+    /// the most source pixels along each side of a height that are sampled
+    static const int maxSampleRatio = 4;
+
+    /// the first band of a raster mapped into memory
+    struct Mapping {
+        GDALDataset *dataset;       /// the dataset mapped, or `NULL`
+        CPLVirtualMem *memory;      /// the mapping, or `NULL` if not mappable
+        const unsigned char *data;  /// the first pixel
+        int pixelSpace;             /// the bytes between pixels
+        GIntBig lineSpace;          /// the bytes between lines
+        GDALDataType dataType;      /// the type of the pixels
+        int width, height;          /// the size of the raster
+        double adfGeoTransform[6];  /// the geotransform of the raster
+        bool hasNoData;             /// whether a no data value is set
+        double noDataValue;         /// the value of pixels without data
+    };
+
+protected:
+    /// map the first band of a dataset, returning `false` if it can't be
+    bool
+    map(GDALDataset *dataset);
+
+    /// release the mapping
+    void
+    unmap();
+
+    /// advise the kernel of the source lines and columns about to be read
+    void
+    adviseWindow(int xOff, int yOff, int xSize, int ySize) const;
+
+    /// the tiler to use
+    const GDALTiler &poTiler;
+
+    /// the reader used for tiles which can't be sampled
+    GDALDatasetReader &mReader;
+
+    /// the order tiles are read in
+    TileOrder mOrder;
+
+    /// the current mapping
+    Mapping mMapping;
+};
+
+/**
+* @brief implements a GDALDatasetReader that composites the sources of a mosaic
+*
+* the dataset passed in only describes the extent of the mosaic, e.g. the one
+* written by `MosaicIndex::writeDataset`, and is not read. instead the sources
+* whose footprints intersect a tile are found in a `MosaicIndex` and warped
+* one over the other into the heights of the tile, from the coarsest to the
+* finest, so each tile only looks at the few sources covering it. heights not
+* covered by any source are `0`.
+*
+* the most recently used sources are kept open, along with a tiler for each
+* which keeps its overviews, and the reader's thread keeps their transformers.
+*/
+class STT_DLL stt::GDALDatasetReaderWithMosaic: public stt::GDALDatasetReader
+{
+public:
+    /// instantiate a reader keeping up to `maxOpen` sources open
+    GDALDatasetReaderWithMosaic(const GDALTiler &tiler, const MosaicIndex &index,
+        size_t maxOpen = 64):
+        poTiler(tiler),
+        mIndex(index),
+        mMaxOpen(maxOpen)
+    {}
+
+    /// the destructor closes the sources
+    ~GDALDatasetReaderWithMosaic();
+
+    using GDALDatasetReader::readRasterHeights;
+
+    /// read a region of raster heights into a buffer for the specified
+    /// Dataset and Coordinate
+    virtual void
+    readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        stt::i_tile tileSizeX, stt::i_tile tileSizeY, float *heights) override;
+
+protected:
+    /// an open source of the mosaic
+    struct OpenSource {
+        size_t index;               /// the index of the source in the mosaic
+        GDALDatasetH dataset;       /// the source dataset
+        TerrainTiler *tiler;        /// the tiler warping from the source, which owns it
+    };
+
+    /// get a source, opening it if necessary
+    const OpenSource &
+    openSource(size_t index);
+
+    /// close a source
+    static void
+    closeSource(const OpenSource &source);
+
+    /// the tiler to use
+    const GDALTiler &poTiler;
+
+    /// the index of the sources
+    const MosaicIndex &mIndex;
+
+    /// the number of sources to keep open
+    size_t mMaxOpen;
+
+    /// the open sources, most recently used first
+    std::list<OpenSource> mOpen;
+
+    /// the sources found for the current tile
+    std::vector<size_t> mFound;
+};
+
 #endif /* GDALDATASETREADER_H_ */
@@ -5,16 +5,14 @@
 
 #include "gdalwarper.h"
 #include "GDALTile.h"
+#include "TransformerCache.h"
 
 using namespace stt;
 
 GDALTile::~GDALTile() {
     if (dataset != NULL) {
         GDALClose(dataset);
-
-        if (transformer != NULL) {
-            GDALDestroyGenImgProjTransformer(transformer);
-        }
+        releaseTransformer(false);
     }
 }
 
@@ -24,11 +22,27 @@ GDALDataset *GDALTile::detach() {
         GDALDataset *poDataset = dataset;
         dataset = NULL;
 
-        if (transformer != NULL) {
-            GDALDestroyGenImgProjTransformer(transformer);
-            transformer = NULL;
-        }
+        releaseTransformer(true);
         return poDataset;
     }
     return NULL;
 }
+
+/**
+* @details a cached transformer is handed back to the cache once the VRT using
+* it is closed. a detached VRT outlives the tile, so its transformer is taken
+* out of the cache rather than being reused by the next tile.
+*/
+void GDALTile::releaseTransformer(bool detaching) {
+    if (transformer != NULL) {
+        if (!cachedTransformer) {
+            GDALDestroyGenImgProjTransformer(transformer);
+        } else if (detaching) {
+            TransformerCache::discard(transformer);
+        } else {
+            TransformerCache::release(transformer);
+        }
+
+        transformer = NULL;
+    }
+}
@@ -32,7 +32,7 @@ class STT_DLL stt::GDALTile: public Tile
 public:
     /// take ownership of a dataset and optional transformer
     GDALTile(GDALDataset *dataset, void *transformer):
-        Tile(), dataset(dataset), transformer(transformer)
+        Tile(), dataset(dataset), transformer(transformer), cachedTransformer(false)
     {}
 
     ~GDALTile();
@@ -47,6 +47,12 @@ protected:
 
     /// the image to image transformer
     void *transformer;
+
+    /// whether the transformer belongs to the `TransformerCache`
+    bool cachedTransformer;
+
+    /// destroy the transformer or hand it back to the cache
+    void releaseTransformer(bool detaching);
 };
 
 #endif /* GDALTILE_H_ */
@@ -6,7 +6,10 @@
 #include <cmath>         // std::abs
 #include <algorithm>     // std::minmax
 #include <cstring>       // strlen
+#include <vector>
+#include <map>
 #include <mutex>
+#include <unordered_map>
 
 #include "gdal_priv.h"
 #include "gdalwarper.h"
@@ -16,6 +19,7 @@
 #include "config.h"
 #include "STTException.h"
 #include "GDALTiler.h"
+#include "TransformerCache.h"
 
 using namespace stt;
 
@@ -190,7 +194,25 @@ GDALTiler::createRasterTile(GDALDataset *dataset, const TileCoordinate &coord) c
 }
 
 /**
-* @brief get an overview dataset which best matches a transformation
+* @details the geometry of the block is that of `rasterGeometry`, which a
+* derived tiler overrides along with this function. a tile within the block
+* can be read at the pixel offset of its position in the block.
+*/
+GDALTile *
+GDALTiler::createRasterTile(GDALDataset *dataset, const TileCoordinate &coord,
+    i_tile columns, i_tile rows) const {
+    double adfGeoTransform[6];
+    int width, height;
+    rasterGeometry(coord, columns, rows, adfGeoTransform, width, height);
+
+    GDALTile *tile = createRasterTile(dataset, adfGeoTransform, width, height);
+    static_cast<TileCoordinate &>(*tile) = coord;
+
+    return tile;
+}
+
+/**
+* @brief get the overview level which best matches a transformation
 *
 * try and get an overview from the source dataset that corresponds more closely
 * to the resolution belonging to any output of the transformation. this will
@@ -205,11 +227,10 @@ GDALTiler::createRasterTile(GDALDataset *dataset, const TileCoordinate &coord) c
 #include "gdaloverviewdataset.cpp"
 
 static
-GDALDatasetH
-getOverviewDataset(GDALDatasetH hSrcDS, GDALTransformerFunc pfnTransformer, void *hTransformerArg)
+int
+getOverviewLevel(GDALDatasetH hSrcDS, GDALTransformerFunc pfnTransformer, void *hTransformerArg)
 {
     GDALDataset *poSrcDS = static_cast<GDALDataset *>(hSrcDS);
-    GDALDataset *poSrcOvrDS = NULL;
     int nOvLevel = -2;
     int nOvCount = poSrcDS->GetRasterBand(1)->GetOverviewCount();
 
@@ -245,52 +266,181 @@ getOverviewDataset(GDALDatasetH hSrcDS, GDALTransformerFunc pfnTransformer, void
 
                 iOvr += (nOvLevel + 2);
                 if (iOvr >= 0) {
-                    poSrcOvrDS = GDALCreateOverviewDataset(poSrcDS, iOvr, 1);
+                    return iOvr;
                 }
             }
         }
     }
 
-    return static_cast<GDALDatasetH>(poSrcOvrDS);
+    return -1;
+}
+
+/// the overviews chosen for a source dataset
+struct SourceOverviews {
+    std::map<double, int> levels;               /// the level chosen for each resolution
+    std::map<int, GDALDatasetH> datasets;       /// the overview datasets by level
+
+    /// close the overview datasets
+    void
+    close() {
+        for (std::map<int, GDALDatasetH>::iterator it = datasets.begin(); it != datasets.end(); ++it) {
+            if (it->second != NULL) {
+                GDALClose(it->second);
+            }
+        }
+        datasets.clear();
+    }
+};
+
+/// the overviews chosen by a thread for each source dataset handle, which
+/// are closed when the thread exits
+struct ThreadOverviews {
+    std::unordered_map<GDALDatasetH, SourceOverviews> sources;
+
+    ~ThreadOverviews() {
+        for (std::unordered_map<GDALDatasetH, SourceOverviews>::iterator it = sources.begin(); it != sources.end(); ++it) {
+            it->second.close();
+        }
+    }
+};
+
+static thread_local ThreadOverviews threadOverviews;
+
+/// get the dataset of an overview level of a source opened by the thread,
+/// opening it on first use, or `NULL` for the full resolution (a level of `-1`)
+static
+GDALDatasetH
+getOverviewDataset(GDALDatasetH hSrcDS, int overviewLevel)
+{
+    if (overviewLevel < 0) {
+        return NULL;
+    }
+
+    GDALDatasetH &hOvrDS = threadOverviews.sources[hSrcDS].datasets[overviewLevel];
+    if (hOvrDS == NULL) {
+        hOvrDS = static_cast<GDALDatasetH>(
+            GDALCreateOverviewDataset(static_cast<GDALDataset *>(hSrcDS), overviewLevel, 1));
+    }
+
+    return hOvrDS;
+}
+
+/// get the overview level the thread has chosen for a resolution of a source,
+/// returning `false` if it hasn't chosen one yet
+static
+bool
+findOverviewLevel(GDALDatasetH hSrcDS, double resolution, int *overviewLevel)
+{
+    std::unordered_map<GDALDatasetH, SourceOverviews>::const_iterator source =
+        threadOverviews.sources.find(hSrcDS);
+    if (source == threadOverviews.sources.end()) {
+        return false;
+    }
+
+    std::map<double, int>::const_iterator level = source->second.levels.find(resolution);
+    if (level == source->second.levels.end()) {
+        return false;
+    }
+
+    *overviewLevel = level->second;
+    return true;
 }
 
 /**
-* @details this method is the heart of the tiler. a `TileCoordinate` is used
-* to obtain the geospatial extent associated with that tile as related to the
-* underlying GDAL dataset. this mapping may require a reproduction if the
-* underlying dataset is not in the tile projection system. this information
-* is the encapsulated as a GDAL virtual raster (VRT) dataset and returned to
-* the caller.
-*
-* it is the caller's responsibility to call `GDALClose()` on the returned
-* dataset.
+* @details the natural resolution of the source, and therefore the best
+* overview, only depends on the resolution of the output and not on where
+* the tile is. the overview level is therefore chosen once for each source
+* dataset and resolution (i.e. zoom level), with a transformer from the
+* source itself, and looked up with `findOverviewLevel` afterwards. its
+* dataset is kept until `GDALTiler::releaseOverviews` is called for the
+* source or the thread exits. a source dataset handle, and so its overviews,
+* is only used by one thread at a time, so every thread keeps the overviews
+* it opens to itself and no lock is taken.
+*/
+static
+GDALDatasetH
+chooseOverviewDataset(GDALDatasetH hSrcDS, double resolution,
+    GDALTransformerFunc pfnTransformer, void *hTransformerArg, int *overviewLevel)
+{
+    *overviewLevel = getOverviewLevel(hSrcDS, pfnTransformer, hTransformerArg);
+    threadOverviews.sources[hSrcDS].levels[resolution] = *overviewLevel;
+
+    return getOverviewDataset(hSrcDS, *overviewLevel);
+}
+
+/**
+* @details the overviews are those opened by the calling thread. a source
+* dataset is therefore closed by the thread which warped it or, as the pools
+* and readers do, once that thread has exited. the transformers the thread
+* cached for the dataset are released as well, as they are keyed by its
+* handle.
 */
+void
+GDALTiler::releaseOverviews(GDALDataset *dataset)
+{
+    TransformerCache::releaseDataset(static_cast<GDALDatasetH>(dataset));
+
+    std::unordered_map<GDALDatasetH, SourceOverviews>::iterator found =
+        threadOverviews.sources.find(static_cast<GDALDatasetH>(dataset));
+
+    if (found != threadOverviews.sources.end()) {
+        found->second.close();
+        threadOverviews.sources.erase(found);
+    }
+}
+
 GDALTile *
 GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6]) const
+{
+    return createRasterTile(dataset, adfGeoTransform, mGrid.tileSize(), mGrid.tileSize());
+}
+
+/// destroy an image to image transformer or hand it back to the cache
+static void
+releaseTransformer(void *transformer, bool cached)
+{
+    if (cached) {
+        TransformerCache::release(transformer);
+    } else {
+        GDALDestroyGenImgProjTransformer(transformer);
+    }
+}
+
+/**
+* @details the warp options transform from the first `bandCount` bands of the
+* dataset, or of its overview best matching the geotransform, to the pixels
+* of the geotransform. the image to image transformer is returned in
+* `transformerArg`, which is the transformer of the options unless it is
+* wrapped by a linear approximator. `cachedTransformer` is set when it belongs
+* to the `TransformerCache`.
+*
+* the caller is responsible for destroying the options, the approximator and
+* the transformer.
+*/
+GDALWarpOptions *
+GDALTiler::createWarpOptions(GDALDataset *dataset, double(&adfGeoTransform)[6],
+    int bandCount, void *&transformerArg, bool &cachedTransformer) const
 {
     if (dataset == NULL) {
         throw STTException("No GDAL dataset is set");
     }
 
-    // the source and sink datasets
+    // the source dataset
     GDALDatasetH hSrcDS = (GDALDatasetH) dataset;
-    GDALDatasetH hDstDS;
 
     // the transformationi option list
     CPLStringList transformOptions;
 
     // the source, sink and grid srs
     const char *pszSrcWKT = GDALGetProjectionRef(hSrcDS);
-    const char *pszGridWKT = pszSrcWKT;
 
     if (!strlen(pszSrcWKT))
         throw STTException("The source dataset no longer has a spatial reference system assigned");
 
     // populate the SRS WKT strings if we need to reproject
     if (requiresReprojection()) {
-        pszGridWKT = crsWKT.c_str();
         transformOptions.SetNameValue("SRC_SRS", pszSrcWKT);
-        transformOptions.SetNameValue("DST_SRS", pszGridWKT);
+        transformOptions.SetNameValue("DST_SRS", crsWKT.c_str());
     }
 
     // set the warp options
@@ -298,7 +448,7 @@ GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6]) c
     psWarpOptions->eResampleAlg = options.resampleAlg;
     psWarpOptions->dfWarpMemoryLimit = options.warpMemoryLimit;
     psWarpOptions->hSrcDS = hSrcDS;
-    psWarpOptions->nBandCount = poDataset->GetRasterCount();
+    psWarpOptions->nBandCount = bandCount;
     psWarpOptions->panSrcBands = (int *) CPLMalloc(sizeof(int) * psWarpOptions->nBandCount);
     psWarpOptions->panDstBands = (int *) CPLMalloc(sizeof(int) * psWarpOptions->nBandCount);
 
@@ -309,7 +459,7 @@ GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6]) c
 
     for (short unsigned int i = 0; i < psWarpOptions->nBandCount; ++i) {
         int bGotNoData = FALSE;
-        double noDataValue = poDataset->GetRasterBand(i + 1)->GetNoDataValue(&bGotNoData);
+        double noDataValue = dataset->GetRasterBand(i + 1)->GetNoDataValue(&bGotNoData);
 
         if (!bGotNoData) noDataValue = -32768;
 
@@ -321,31 +471,60 @@ GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6]) c
         psWarpOptions->panDstBands[i] = psWarpOptions->panSrcBands[i] = i + 1;
     }
 
-    // create the image to image transformer
-    void *transformerArg = GDALCreateGenImgProjTransformer2(hSrcDS, NULL, transformOptions.List());
-    if (transformerArg == NULL) {
-        GDALDestroyWarpOptions(psWarpOptions);
-        throw STTException("Could not create image to image transformer");
-    }
+    // an approximate transformer only wraps the image to image transformer,
+    // which can then be reused by later tiles of this thread instead of being
+    // created again. an exact one is handed over to the caller.
+    cachedTransformer = (options.errorThreshold != 0);
+    auto createTransformer = [&](GDALDatasetH hWrkSrcDS, int overviewLevel) {
+        return cachedTransformer
+            ? TransformerCache::acquire(hSrcDS, hWrkSrcDS, overviewLevel, transformOptions.List())
+            : GDALCreateGenImgProjTransformer2(hWrkSrcDS, NULL, transformOptions.List());
+    };
+
+    // the overview best matching the resolution of the tile is chosen with
+    // a transformer from the dataset itself the first time the resolution is
+    // seen. after that the level is known, and only the transformer of the
+    // dataset the tile is warped from is needed.
+    int overviewLevel = -1;
+    GDALDatasetH hWrkSrcDS = NULL;
+    transformerArg = NULL;
+
+    if (findOverviewLevel(hSrcDS, adfGeoTransform[1], &overviewLevel)) {
+        hWrkSrcDS = getOverviewDataset(hSrcDS, overviewLevel);
+    } else {
+        transformerArg = createTransformer(hSrcDS, -1);
+        if (transformerArg == NULL) {
+            GDALDestroyWarpOptions(psWarpOptions);
+            throw STTException("Could not create image to image transformer");
+        }
 
-    // specify the destination geotransform
-    GDALSetGenImgProjTransformerDstGeoTransform(transformerArg, adfGeoTransform);
+        // specify the destination geotransform
+        GDALSetGenImgProjTransformerDstGeoTransform(transformerArg, adfGeoTransform);
 
-    // try and get an overview from the source dataset that corresponds more
-    // closely to the resolution of this tile.
-    GDALDatasetH hWrkSrcDS = getOverviewDataset(hSrcDS, GDALGenImgProjTransform, transformerArg);
-    if (hWrkSrcDS == NULL) {
-        hWrkSrcDS = psWarpOptions->hSrcDS = hSrcDS;
-    } else {
-        psWarpOptions->hSrcDS = hWrkSrcDS;
+        hWrkSrcDS = chooseOverviewDataset(hSrcDS, adfGeoTransform[1],
+            GDALGenImgProjTransform, transformerArg, &overviewLevel);
 
         // we need to recreate the transform when operating on an overview.
-        GDALDestroyGenImgProjTransformer(transformerArg);
+        if (hWrkSrcDS != NULL) {
+            releaseTransformer(transformerArg, cachedTransformer);
+            transformerArg = NULL;
+        }
+    }
+
+    if (hWrkSrcDS != NULL) {
+        psWarpOptions->hSrcDS = hWrkSrcDS;
+    }
+
+    if (transformerArg == NULL) {
+        transformerArg = (hWrkSrcDS != NULL)
+            ? createTransformer(hWrkSrcDS, overviewLevel)
+            : createTransformer(hSrcDS, -1);
 
-        transformerArg = GDALCreateGenImgProjTransformer2(hWrkSrcDS, NULL, transformOptions.List());
         if (transformerArg == NULL) {
             GDALDestroyWarpOptions(psWarpOptions);
-            throw STTException("Could not create overview image to image transformer");
+            throw STTException(hWrkSrcDS != NULL
+                ? "Could not create overview image to image transformer"
+                : "Could not create image to image transformer");
         }
 
         // specify the destination geotransform
@@ -361,7 +540,7 @@ GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6]) c
 
         if (psWarpOptions->pTransformerArg == NULL) {
             GDALDestroyWarpOptions(psWarpOptions);
-            GDALDestroyGenImgProjTransformer(transformerArg);
+            releaseTransformer(transformerArg, cachedTransformer);
             throw STTException("Could not create linear approximator");
         }
 
@@ -373,24 +552,48 @@ GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6]) c
         psWarpOptions->pfnTransformer = GDALGenImgProjTransform;
     }
 
+    return psWarpOptions;
+}
+
+/**
+* @details this method is the heart of the tiler. a `TileCoordinate` is used
+* to obtain the geospatial extent associated with that tile as related to the
+* underlying GDAL dataset. this mapping may require a reproduction if the
+* underlying dataset is not in the tile projection system. this information
+* is the encapsulated as a GDAL virtual raster (VRT) dataset and returned to
+* the caller.
+*
+* it is the caller's responsibility to call `GDALClose()` on the returned
+* dataset.
+*/
+GDALTile *
+GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6],
+    int width, int height) const
+{
+    void *transformerArg;
+    bool cachedTransformer;
+    GDALWarpOptions *psWarpOptions = createWarpOptions(dataset, adfGeoTransform,
+        dataset->GetRasterCount(), transformerArg, cachedTransformer);
+
     // the raster tile is represented as a VRT dataset
-    hDstDS = GDALCreateWarpedVRT(hWrkSrcDS, mGrid.tileSize(), mGrid.tileSize(), adfGeoTransform, psWarpOptions);
+    GDALDatasetH hDstDS = GDALCreateWarpedVRT(psWarpOptions->hSrcDS, width, height, adfGeoTransform, psWarpOptions);
 
     bool isApproxTransform = (psWarpOptions->pfnTransformer == GDALApproxTransform);
     GDALDestroyWarpOptions(psWarpOptions);
 
     if (hDstDS == NULL) {
-        GDALDestroyGenImgProjTransformer(transformerArg);
+        releaseTransformer(transformerArg, cachedTransformer);
         throw STTException("Could not create warped VRT");
     }
 
     // set the projection information on the dataset.
     // this will always be the grid SRS.
+    const char *pszGridWKT = requiresReprojection() ? crsWKT.c_str() : GDALGetProjectionRef((GDALDatasetH) dataset);
     if (GDALSetProjection(hDstDS, pszGridWKT) != CE_None) {
         GDALClose(hDstDS);
 
         if (transformerArg != NULL) {
-            GDALDestroyGenImgProjTransformer(transformerArg);
+            releaseTransformer(transformerArg, cachedTransformer);
         }
         throw STTException("Could not set projection on VRT");
 
@@ -398,8 +601,212 @@ GDALTiler::createRasterTile(GDALDataset *dataset, double(&adfGeoTransform)[6]) c
 
     // create the tile, passing it the base image transformer to manage if
     // this is an approximate transform
+    GDALTile *tile = new GDALTile((GDALDataset *) hDstDS, isApproxTransform ? transformerArg : NULL);
+    tile->cachedTransformer = isApproxTransform && cachedTransformer;
+
+    return tile;
+}
+
+/**
+* @details the heights are warped with a `GDALWarpOperation` straight into
+* the buffer, which must hold `width * height` values, instead of through a
+* warped VRT which is then read. as with the VRT, heights are warped in the
+* data type of the source and heights outside the source are `0`. datasets
+* aligned with the grid are read without warping where possible (see
+* `GDALTiler::readAlignedRasterHeights`).
+*
+* when `overlay` is set the buffer isn't cleared: the heights are warped as
+* floats over those already in the buffer, which are kept wherever the
+* dataset has no data. this composites several datasets into one buffer.
+*/
+void
+GDALTiler::warpRasterHeights(GDALDataset *dataset, double(&adfGeoTransform)[6],
+    int width, int height, float *heights, bool overlay) const
+{
+    if (!overlay && readAlignedRasterHeights(dataset, adfGeoTransform, width, height, heights)) {
+        return;
+    }
+
+    void *transformerArg;
+    bool cachedTransformer;
+    GDALWarpOptions *psWarpOptions = createWarpOptions(dataset, adfGeoTransform,
+        1, transformerArg, cachedTransformer);
+
+    const bool isApproxTransform = (psWarpOptions->pfnTransformer == GDALApproxTransform);
+    const GDALDataType dataType = overlay ? GDT_Float32
+        : dataset->GetRasterBand(1)->GetRasterDataType();
+    const size_t cellCount = (size_t) width * height;
+    psWarpOptions->eWorkingDataType = dataType;
+
+    // warp floats straight into the heights, converting other types after.
+    // the warp starts from a buffer of zeros as the VRT does.
+    std::vector<unsigned char> converted;
+    void *buffer = heights;
+    if (overlay) {
+        // only heights with data are written over the buffer
+        psWarpOptions->papszWarpOptions = CSLSetNameValue(
+            psWarpOptions->papszWarpOptions, "UNIFIED_SRC_NODATA", "YES");
+    } else if (dataType == GDT_Float32) {
+        std::fill(heights, heights + cellCount, 0.0f);
+    } else {
+        converted.resize(cellCount * GDALGetDataTypeSizeBytes(dataType));
+        buffer = converted.data();
+    }
+
+    CPLErr err = CE_Failure;
+    {
+        GDALWarpOperation operation;
+        if (operation.Initialize(psWarpOptions) == CE_None) {
+            err = operation.WarpRegionToBuffer(0, 0, width, height, buffer, dataType);
+        }
+    }
+
+    if (isApproxTransform) {
+        GDALDestroyApproxTransformer(psWarpOptions->pTransformerArg);
+    }
+    releaseTransformer(transformerArg, cachedTransformer);
+    GDALDestroyWarpOptions(psWarpOptions);
+
+    if (err != CE_None) {
+        throw STTException("Could not warp heights from raster");
+    }
+
+    if (buffer != heights) {
+        GDALCopyWords64(buffer, dataType, GDALGetDataTypeSizeBytes(dataType),
+            heights, GDT_Float32, sizeof(float), cellCount);
+    }
+}
+
+/**
+* @details the block spans `columns` tiles east and `rows` tiles north of
+* `coord`, with the tiles side by side.
+*/
+void
+GDALTiler::rasterGeometry(const TileCoordinate &coord, i_tile columns,
+    i_tile rows, double(&adfGeoTransform)[6], int &width, int &height) const
+{
+    double resolution = mGrid.resolution(coord.zoom);
+    CRSBounds lowerLeft = mGrid.tileBounds(coord);
+    CRSBounds upperRight = mGrid.tileBounds(
+        TileCoordinate(coord.zoom, coord.x + columns - 1, coord.y + rows - 1));
+
+    adfGeoTransform[0] = lowerLeft.getMinX();     // min longitude
+    adfGeoTransform[1] = resolution;
+    adfGeoTransform[2] = 0;
+    adfGeoTransform[3] = upperRight.getMaxY();    // max latitude
+    adfGeoTransform[4] = 0;
+    adfGeoTransform[5] = -resolution;
+
+    width = mGrid.tileSize() * columns;
+    height = mGrid.tileSize() * rows;
+}
+
+void
+GDALTiler::warpRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+    i_tile columns, i_tile rows, float *heights) const
+{
+    // ensure we have some data from which to create a tile
+    if (dataset && dataset->GetRasterCount() < 1) {
+        throw STTException("At least one band must be present in the GDAL dataset");
+    }
+
+    double adfGeoTransform[6];
+    int width, height;
+    rasterGeometry(coord, columns, rows, adfGeoTransform, width, height);
+
+    warpRasterHeights(dataset, adfGeoTransform, width, height, heights);
+}
+
+/// get the `RasterIO` resampling matching a warp resampling, if any
+static bool
+getRasterIOResampleAlg(GDALResampleAlg resampleAlg, GDALRIOResampleAlg &rioResampleAlg)
+{
+    switch (resampleAlg) {
+    case GRA_NearestNeighbour: rioResampleAlg = GRIORA_NearestNeighbour; break;
+    case GRA_Bilinear:         rioResampleAlg = GRIORA_Bilinear; break;
+    case GRA_Cubic:            rioResampleAlg = GRIORA_Cubic; break;
+    case GRA_CubicSpline:      rioResampleAlg = GRIORA_CubicSpline; break;
+    case GRA_Lanczos:          rioResampleAlg = GRIORA_Lanczos; break;
+    case GRA_Average:          rioResampleAlg = GRIORA_Average; break;
+    case GRA_Mode:             rioResampleAlg = GRIORA_Mode; break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+/**
+* @details when the dataset is in the grid SRS and its pixels are aligned
+* with the axes, the pixels of the geotransform map to a rectangle of source
+* pixels. the heights can then be read from that rectangle by `RasterIO`,
+* which resamples them and picks the best overview itself, rather than by
+* the warper. this is the case for geodetic DEMs such as SRTM.
+*
+* `false` is returned, and nothing is read, when the dataset isn't aligned,
+* the rectangle extends beyond the dataset, the resampling can't be done by
+* `RasterIO` or `TilerOptions::alignedRead` is off. the heights should then be
+* warped.
+*/
+bool
+GDALTiler::readAlignedRasterHeights(GDALDataset *dataset, double(&adfGeoTransform)[6],
+    int width, int height, float *heights) const
+{
+    GDALRIOResampleAlg rioResampleAlg;
+    if (!options.alignedRead || requiresReprojection() || dataset == NULL ||
+        dataset->GetRasterCount() < 1 ||
+        !getRasterIOResampleAlg(options.resampleAlg, rioResampleAlg)) {
+        return false;
+    }
+
+    double adfSrcGeoTransform[6];
+    if (dataset->GetGeoTransform(adfSrcGeoTransform) != CE_None ||
+        adfSrcGeoTransform[2] != 0 || adfSrcGeoTransform[4] != 0 ||
+        adfSrcGeoTransform[1] <= 0 || adfSrcGeoTransform[5] >= 0) {
+        return false;
+    }
+
+    // the rectangle covered by the geotransform in source pixels
+    double dfXOff = (adfGeoTransform[0] - adfSrcGeoTransform[0]) / adfSrcGeoTransform[1];
+    double dfYOff = (adfGeoTransform[3] - adfSrcGeoTransform[3]) / adfSrcGeoTransform[5];
+    double dfXSize = width * adfGeoTransform[1] / adfSrcGeoTransform[1];
+    double dfYSize = height * adfGeoTransform[5] / adfSrcGeoTransform[5];
+
+    // allow for rounding errors at the edges of the dataset
+    const double epsilon = 1e-6;
+    const int nRasterXSize = dataset->GetRasterXSize();
+    const int nRasterYSize = dataset->GetRasterYSize();
+
+    if (dfXOff < -epsilon || dfYOff < -epsilon ||
+        dfXOff + dfXSize > nRasterXSize + epsilon ||
+        dfYOff + dfYSize > nRasterYSize + epsilon) {
+        return false;
+    }
 
-    return new GDALTile((GDALDataset *) hDstDS, isApproxTransform ? transformerArg : NULL);
+    dfXOff = std::max(dfXOff, 0.0);
+    dfYOff = std::max(dfYOff, 0.0);
+    dfXSize = std::min(dfXSize, nRasterXSize - dfXOff);
+    dfYSize = std::min(dfYSize, nRasterYSize - dfYOff);
+
+    // the whole pixels containing the rectangle
+    const int nXOff = (int) std::floor(dfXOff);
+    const int nYOff = (int) std::floor(dfYOff);
+    const int nXSize = std::max(1, std::min((int) std::ceil(dfXOff + dfXSize), nRasterXSize) - nXOff);
+    const int nYSize = std::max(1, std::min((int) std::ceil(dfYOff + dfYSize), nRasterYSize) - nYOff);
+
+    GDALRasterIOExtraArg sExtraArg;
+    INIT_RASTERIO_EXTRA_ARG(sExtraArg);
+    sExtraArg.eResampleAlg = rioResampleAlg;
+    sExtraArg.bFloatingPointWindowValidity = TRUE;
+    sExtraArg.dfXOff = dfXOff;
+    sExtraArg.dfYOff = dfYOff;
+    sExtraArg.dfXSize = dfXSize;
+    sExtraArg.dfYSize = dfYSize;
+
+    GDALRasterBand *heightsBand = dataset->GetRasterBand(1);
+
+    return heightsBand->RasterIO(GF_Read, nXOff, nYOff, nXSize, nYSize,
+        (void *) heights, width, height, GDT_Float32, 0, 0, &sExtraArg) == CE_None;
 }
 
 /**
@@ -414,6 +821,7 @@ GDALTiler::closeDataset()
         poDataset->Dereference();
 
         if (poDataset->GetRefCount() < 1) {
+            releaseOverviews(poDataset);
             GDALClose(poDataset);
         }
 
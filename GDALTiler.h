@@ -28,6 +28,8 @@ struct stt::TilerOptions {
     double warpMemoryLimit = 0.0;  // default to GDAL internal setting
     /// the warp resampling algorithm
     GDALResampleAlg resampleAlg = GRA_Average; // recommended by GDAL maintainer
+    /// read datasets aligned with the grid with `RasterIO` instead of warping
+    bool alignedRead = true;
 };
 
 /**
@@ -71,7 +73,7 @@ public:
     GDALTiler &operator=(const GDALTiler &other);
 
     /// the destructor
-    ~GDALTiler();
+    virtual ~GDALTiler();
 
     /// create a tile from a tile coordinate
     virtual Tile *
@@ -134,6 +136,11 @@ public:
         return crsWKT.size() > 0;
     }
 
+    /// close the overview datasets the calling thread keeps and release the
+    /// transformers kept for a source dataset before closing it
+    static void
+    releaseOverviews(GDALDataset *dataset);
+
 protected:
     friend class GDALDatasetReader;
 
@@ -144,10 +151,46 @@ protected:
     virtual GDALTile *
     createRasterTile(GDALDataset *dataset, const TileCoordinate &coord) const;
 
+    /// create a raster tile covering a block of tiles north east of `coord`
+    virtual GDALTile *
+    createRasterTile(GDALDataset *dataset, const TileCoordinate &coord,
+        i_tile columns, i_tile rows) const;
+
     /// create raster tile from a geotransform
     virtual GDALTile *
     createRasterTile(GDALDataset *dataset, double (&adfGeoTransform)[6]) const;
 
+    /// create raster tile of a size in pixels from a geotransform
+    GDALTile *
+    createRasterTile(GDALDataset *dataset, double (&adfGeoTransform)[6],
+        int width, int height) const;
+
+    /// get the geotransform and size in pixels of a block of tiles north east of `coord`
+    virtual void
+    rasterGeometry(const TileCoordinate &coord, i_tile columns, i_tile rows,
+        double (&adfGeoTransform)[6], int &width, int &height) const;
+
+    /// warp the heights of a block of tiles north east of `coord` into a buffer
+    void
+    warpRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        i_tile columns, i_tile rows, float *heights) const;
+
+    /// read heights of a dataset aligned with the grid without warping them
+    bool
+    readAlignedRasterHeights(GDALDataset *dataset, double (&adfGeoTransform)[6],
+        int width, int height, float *heights) const;
+
+    /// warp heights of a size in pixels from a geotransform into a buffer,
+    /// optionally over the heights already in it
+    void
+    warpRasterHeights(GDALDataset *dataset, double (&adfGeoTransform)[6],
+        int width, int height, float *heights, bool overlay = false) const;
+
+    /// create the options for warping a dataset to a geotransform
+    GDALWarpOptions *
+    createWarpOptions(GDALDataset *dataset, double (&adfGeoTransform)[6],
+        int bandCount, void *&transformerArg, bool &cachedTransformer) const;
+
     /// the grid used for generating tiles
     Grid mGrid;
 
@@ -6,13 +6,24 @@
  * @brief this declares and defines the `GridIterator` class
  */
 
+#include <algorithm>
 #include <iterator>
+#include <vector>
 
 #include "TileCoordinate.h"
 #include "Grid.h"
+#include "SpaceFillingCurve.h"
 
 namespace stt {
     class GridIterator;
+
+    /// the order in which the tiles of a zoom level are iterated over
+    enum TileOrder {
+        TILE_ORDER_COLUMN,      /// column by column from the left (the default)
+        TILE_ORDER_ROW,         /// row by row from the bottom
+        TILE_ORDER_MORTON,      /// along a Morton (Z-order) curve
+        TILE_ORDER_HILBERT      /// along a Hilbert curve
+    };
 }
 
 /**
@@ -33,6 +44,25 @@ namespace stt {
  * by default the iterator iterates over the full extent represented by the
  * grid, but alternative extents can be passed in to the constructor, acting as
  * a spatial filter
+ *
+ * every tile in the iteration has an index giving its position in the
+ * sequence. the iterator can be pointed at any index in constant time (see
+ * `GridIterator::seek`) and restricted to a range of indices (see
+ * `GridIterator::setRange`), which allows the tiles to be shared out between
+ * threads or processes without replaying the iteration e.g.
+ *
+ * \code
+ *   GridIterator share(iter);
+ *   share.setRange(begin, end);
+ *   for (; !share.exhausted(); ++share) {
+ *     // do stuff with the tiles in [begin, end)
+ *   }
+ * \endcode
+ *
+ * the tiles of each zoom level are visited column by column unless another
+ * `TileOrder` is set. the Morton and Hilbert orders walk a space filling curve
+ * over the tile bounds instead, so that tiles close together in the iteration
+ * (and in any range of indices) are also close together on the ground.
  */
 
 class stt::GridIterator: public std::iterator<std::input_iterator_tag, TileCoordinate *>
@@ -43,12 +73,15 @@ public:
         grid(grid),
         startZoom(startZoom),
         endZoom(endZoom),
+        order(TILE_ORDER_COLUMN),
         gridExtent(grid.getExtent()),
         bounds(grid.getTileExtent(startZoom)),
         currentTile(TileCoordinate(startZoom, bounds.getLowerLeft())) // the initial tile coordinate
     {
         if (startZoom < endZoom)
             throw STTException("Iterating from a starting zoom level that is less than the end zoom level");
+
+        setZoomOffsets();
     }
 
     /// instantiate an iterator with a grid and separate bounds
@@ -56,6 +89,7 @@ public:
         grid(grid),
         startZoom(startZoom),
         endZoom(endZoom),
+        order(TILE_ORDER_COLUMN),
         gridExtent(extent)
     {
         if (startZoom < endZoom)
@@ -63,6 +97,7 @@ public:
 
         currentTile.zoom = startZoom;
         setTileBounds();
+        setZoomOffsets();
     }
 
     /// override the ++prefix operator
@@ -72,6 +107,16 @@ public:
         if (exhausted())
             return *this;
 
+        // curves can't be followed incrementally so look up the next tile
+        if (order != TILE_ORDER_COLUMN) {
+            if (++index < endIndex) {
+                currentTile = coordinateAt(index);
+                bounds = zoomBounds[startZoom - currentTile.zoom];
+            }
+
+            return *this;
+        }
+
         /*
          * the statements in this function are the equivalent of the following `for`
          * loops but broken down for use in the iterator:
@@ -96,6 +141,8 @@ public:
          * level 0 is reached.
          */
 
+        ++index;
+
         if (++(currentTile.y) > bounds.getMaxY()) {
             if (++(currentTile.x) > bounds.getMaxX()) {
                 if (currentTile.zoom > endZoom) {
@@ -123,6 +170,9 @@ public:
     bool
     operator==(const GridIterator &other) const {
         return currentTile == other.currentTile
+        && index == other.index
+        && endIndex == other.endIndex
+        && order == other.order
         && startZoom == other.startZoom
         && endZoom == other.endZoom
         && bounds == other.bounds
@@ -145,7 +195,7 @@ public:
     /// return `true` if the iterator is at the end
     bool
     exhausted() const {
-        return currentTile.zoom == endZoom && currentTile.x > bounds.getMaxX() && currentTile.y > bounds.getMaxY();
+        return index >= endIndex;
     }
 
     /// reset the iterator to a certain point
@@ -158,21 +208,132 @@ public:
         endZoom = end;
 
         setTileBounds();
+        setZoomOffsets();
     }
 
     /// get the total number of elements in the iterator
-    i_tile
+    i_tile_index
     getSize() const {
-        i_tile size = 0;
-        for (i_zoom zoom = endZoom; zoom <= startZoom; ++zoom) {
-            TileCoordinate ll = grid.crsToTile(gridExtent.getLowerLeft(), zoom);
-            TileCoordinate ur = grid.crsToTile(gridExtent.getUpperRight(), zoom);
+        return zoomOffsets.back();
+    }
+
+    /// get the index of the tile currently pointed to
+    i_tile_index
+    getIndex() const {
+        return index;
+    }
+
+    /// get the index at which the iteration is exhausted
+    i_tile_index
+    getEndIndex() const {
+        return endIndex;
+    }
+
+    /// get the tile coordinate found at an index of the iteration
+    TileCoordinate
+    coordinateAt(i_tile_index tileIndex) const {
+        if (tileIndex >= getSize())
+            throw STTException("The tile index is beyond the end of the iteration");
 
-            TileBounds zoomBound(ll, ur);
-            size += (zoomBound.getWidth() + 1) * (zoomBound.getHeight() + 1);
+        // find the zoom level containing the index
+        size_t level = std::upper_bound(zoomOffsets.begin(), zoomOffsets.end(), tileIndex) - zoomOffsets.begin() - 1;
+        const TileBounds &zoomBound = zoomBounds[level];
+
+        i_tile_index offset = tileIndex - zoomOffsets[level];
+        i_tile_index columns = zoomBound.getWidth() + 1;
+        i_tile_index rows = zoomBound.getHeight() + 1;
+        uint64_t x, y;
+
+        switch (order) {
+        case TILE_ORDER_ROW:
+            x = offset % columns;
+            y = offset / columns;
+            break;
+        case TILE_ORDER_MORTON:
+            curve::unrank(curve::MORTON, columns, rows, offset, x, y);
+            break;
+        case TILE_ORDER_HILBERT:
+            curve::unrank(curve::HILBERT, columns, rows, offset, x, y);
+            break;
+        default:
+            x = offset / rows;
+            y = offset % rows;
         }
 
-        return size;
+        return TileCoordinate(
+            startZoom - level,
+            zoomBound.getMinX() + (i_tile) x,
+            zoomBound.getMinY() + (i_tile) y
+        );
+    }
+
+    /// get the index of a tile coordinate within the iteration
+    i_tile_index
+    indexOf(const TileCoordinate &coord) const {
+        if (coord.zoom > startZoom || coord.zoom < endZoom)
+            throw STTException("The tile zoom level is not part of the iteration");
+
+        size_t level = startZoom - coord.zoom;
+        const TileBounds &zoomBound = zoomBounds[level];
+
+        if (coord.x < zoomBound.getMinX() || coord.x > zoomBound.getMaxX()
+            || coord.y < zoomBound.getMinY() || coord.y > zoomBound.getMaxY())
+            throw STTException("The tile coordinate is not part of the iteration");
+
+        i_tile_index columns = zoomBound.getWidth() + 1;
+        i_tile_index rows = zoomBound.getHeight() + 1;
+        i_tile_index x = coord.x - zoomBound.getMinX();
+        i_tile_index y = coord.y - zoomBound.getMinY();
+
+        switch (order) {
+        case TILE_ORDER_ROW:
+            return zoomOffsets[level] + (y * columns) + x;
+        case TILE_ORDER_MORTON:
+            return zoomOffsets[level] + curve::rank(curve::MORTON, columns, rows, x, y);
+        case TILE_ORDER_HILBERT:
+            return zoomOffsets[level] + curve::rank(curve::HILBERT, columns, rows, x, y);
+        default:
+            return zoomOffsets[level] + (x * rows) + y;
+        }
+    }
+
+    /// point the iterator at the tile found at an index
+    GridIterator &
+    seek(i_tile_index tileIndex) {
+        if (tileIndex >= endIndex) {
+            // leave the iterator exhausted
+            index = endIndex;
+            return *this;
+        }
+
+        currentTile = coordinateAt(tileIndex);
+        bounds = zoomBounds[startZoom - currentTile.zoom];
+        index = tileIndex;
+
+        return *this;
+    }
+
+    /// restrict the iteration to the tiles with an index in `[begin, end)`
+    void
+    setRange(i_tile_index begin, i_tile_index end) {
+        if (begin > end || end > getSize())
+            throw STTException("The tile index range is not part of the iteration");
+
+        endIndex = end;
+        seek(begin);
+    }
+
+    /// get the order in which the tiles of a zoom level are visited
+    TileOrder
+    getOrder() const {
+        return order;
+    }
+
+    /// change the tile order, moving to the tile at the current index
+    void
+    setOrder(TileOrder tileOrder) {
+        order = tileOrder;
+        seek(index);
     }
 
     /// get the grid we are iterating over
@@ -181,26 +342,71 @@ public:
         return grid;
     }
 
+    /// get the zoom level the iteration starts at
+    i_zoom
+    getStartZoom() const {
+        return startZoom;
+    }
+
+    /// get the zoom level the iteration ends at
+    i_zoom
+    getEndZoom() const {
+        return endZoom;
+    }
+
+    /// get the tile bounds iterated over at a particular zoom level
+    TileBounds
+    tileBoundsForZoom(i_zoom zoom) const {
+        TileCoordinate ll = grid.crsToTile(gridExtent.getLowerLeft(), zoom);
+        TileCoordinate ur = grid.crsToTile(gridExtent.getUpperRight(), zoom);
+
+        return TileBounds(ll, ur);
+    }
+
 protected:
     /// set the tile bounds of the grid for the current zoom level
     void
     setTileBounds() {
-        TileCoordinate ll = grid.crsToTile(gridExtent.getLowerLeft(), currentTile.zoom);
-        TileCoordinate ur = grid.crsToTile(gridExtent.getUpperRight(), currentTile.zoom);
-
         // set the bounds
-        bounds = TileBounds(ll, ur);
+        bounds = tileBoundsForZoom(currentTile.zoom);
 
         // set the current tile
-        currentTile.setPoint(ll);
+        currentTile.setPoint(bounds.getLowerLeft());
+    }
+
+    /// cache the tile bounds and first tile index of every zoom level
+    void
+    setZoomOffsets() {
+        zoomBounds.clear();
+        zoomOffsets.assign(1, 0);
+
+        for (i_zoom zoom = startZoom; ; --zoom) {
+            TileBounds zoomBound = tileBoundsForZoom(zoom);
+            i_tile_index size = (i_tile_index) (zoomBound.getWidth() + 1) * (zoomBound.getHeight() + 1);
+
+            zoomBounds.push_back(zoomBound);
+            zoomOffsets.push_back(zoomOffsets.back() + size);
+
+            if (zoom == endZoom)
+                break;
+        }
+
+        index = 0;
+        endIndex = getSize();
     }
 
     const Grid &grid;                /// the grid we are iterating over
     i_zoom startZoom;                /// the starting zom level
     i_zoom endZoom;                  /// the final zoom level
+    TileOrder order;                 /// the order of the tiles within a zoom level
     CRSBounds gridExtent;            /// the extent of the underlying grid to iterate over
     TileBounds bounds;               /// the extent of the currently iterated zoom level
     TileCoordinate currentTile;      /// the identity of the current tile being pointed to
+    i_tile_index index;              /// the position of the current tile in the iteration
+    i_tile_index endIndex;           /// the position at which the iteration is exhausted
+
+    std::vector<TileBounds> zoomBounds;      /// the tile bounds of each zoom level from the start zoom
+    std::vector<i_tile_index> zoomOffsets;   /// the index of the first tile of each zoom level
 };
 
 #endif /* GRIDITERATOR_H_ */
@@ -0,0 +1,107 @@
+/**
+ * @file HeightFieldCache.cpp
+ * @brief this defines the `HeightFieldCache` class
+ */
+
+#include <iterator>
+
+#include "HeightFieldCache.h"
+
+using namespace stt;
+
+stt::HeightFieldCache::HeightFieldCache(size_t capacity):
+    mCapacity(capacity),
+    mHits(0),
+    mMisses(0)
+{
+    mIndex.reserve(capacity);
+}
+
+std::shared_ptr<const HeightFieldCache::Entry>
+stt::HeightFieldCache::get(const TileCoordinate &coord)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::unordered_map<uint64_t, EntryList::iterator>::iterator found = mIndex.find(key(coord));
+
+    if (found == mIndex.end()) {
+        ++mMisses;
+        return NULL;
+    }
+
+    // move the entry to the front of the list
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+    ++mHits;
+
+    return found->second->second;
+}
+
+/**
+* @details an entry which is no longer cached can only be held by those who
+* got it before, so once the cache holds the only reference nobody else can
+* see it being refilled.
+*/
+std::shared_ptr<HeightFieldCache::Entry>
+stt::HeightFieldCache::acquire()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (size_t i = mFree.size(); i-- > 0; ) {
+        if (mFree[i].use_count() == 1) {
+            std::shared_ptr<Entry> entry = std::move(mFree[i]);
+            mFree[i] = std::move(mFree.back());
+            mFree.pop_back();
+            return entry;
+        }
+    }
+
+    return std::make_shared<Entry>();
+}
+
+/**
+* @details when the cache is full the least recently used entry is replaced in
+* its list node, and its index node is given the new key, so that neither is
+* allocated again.
+*/
+void
+stt::HeightFieldCache::put(const TileCoordinate &coord, const std::shared_ptr<Entry> &entry)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mCapacity == 0) {
+        mFree.push_back(entry);
+        return;
+    }
+
+    std::unordered_map<uint64_t, EntryList::iterator>::iterator found = mIndex.find(key(coord));
+
+    // another thread may have cached the same tile in the meantime
+    if (found != mIndex.end()) {
+        mEntries.splice(mEntries.begin(), mEntries, found->second);
+        mFree.push_back(entry);
+        return;
+    }
+
+    if (mEntries.size() < mCapacity) {
+        mEntries.push_front(std::make_pair(key(coord), entry));
+        mIndex[key(coord)] = mEntries.begin();
+        return;
+    }
+
+    mEntries.splice(mEntries.begin(), mEntries, std::prev(mEntries.end()));
+    std::pair<uint64_t, std::shared_ptr<Entry>> &front = mEntries.front();
+
+    std::unordered_map<uint64_t, EntryList::iterator>::node_type node = mIndex.extract(front.first);
+    node.key() = key(coord);
+    mIndex.insert(std::move(node));
+
+    mFree.push_back(std::move(front.second));
+    front.first = key(coord);
+    front.second = entry;
+}
+
+size_t
+stt::HeightFieldCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
@@ -0,0 +1,118 @@
+#ifndef HEIGHTFIELDCACHE_H_
+#define HEIGHTFIELDCACHE_H_
+
+/**
+ * @file HeightFieldCache.h
+ * @brief this declares the `HeightFieldCache` class
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "TileCoordinate.h"
+
+namespace stt {
+    class HeightFieldCache;
+}
+
+/**
+ * @brief a bounded least recently used cache of tile heightfields
+ *
+ * every mesh tile above zoom level 6 is stitched to its four neighbours by
+ * reading their heights and computing their activation levels. an entry holds
+ * both for a tile so that each tile is read and chunked once while it remains
+ * cached, whether it is needed for itself or as the neighbour of another
+ * tile. entries are shared, so they remain valid for holders after being
+ * evicted.
+ *
+ * entries are taken from the cache with `HeightFieldCache::acquire`, filled
+ * and then added with `HeightFieldCache::put`. an evicted entry is kept for
+ * reuse by `acquire` once nothing holds it any more, and the list and index
+ * nodes of an evicted entry are reused for the entry replacing it, so a full
+ * cache doesn't allocate:
+ *
+ * \code
+ *   std::shared_ptr<HeightFieldCache::Entry> entry = cache.acquire();
+ *   entry->heights.assign(heights, heights + cellCount);
+ *   cache.put(coord, entry);
+ * \endcode
+ *
+ * instances can be shared between threads.
+ */
+class STT_DLL stt::HeightFieldCache
+{
+public:
+    /// the heights of a tile and their activation levels
+    struct Entry {
+        std::vector<float> heights;
+        std::vector<uint8_t> levels;
+    };
+
+    /// create a cache holding up to `capacity` entries
+    HeightFieldCache(size_t capacity);
+
+    /// get the entry for a tile, or `NULL` if it is not cached
+    std::shared_ptr<const Entry>
+    get(const TileCoordinate &coord);
+
+    /// get an entry to fill for `put`, reusing an evicted entry if possible
+    std::shared_ptr<Entry>
+    acquire();
+
+    /// add an entry from `acquire` for a tile, evicting the least recently
+    /// used if full. the entry must not be changed afterwards
+    void
+    put(const TileCoordinate &coord, const std::shared_ptr<Entry> &entry);
+
+    /// get the number of entries cached
+    size_t
+    size() const;
+
+    /// get the number of lookups that found an entry
+    inline uint64_t
+    hits() const {
+        return mHits;
+    }
+
+    /// get the number of lookups that found nothing
+    inline uint64_t
+    misses() const {
+        return mMisses;
+    }
+
+protected:
+    typedef std::list<std::pair<uint64_t, std::shared_ptr<Entry>>> EntryList;
+
+    /// pack a tile coordinate into a key
+    static inline uint64_t
+    key(const TileCoordinate &coord) {
+        return ((uint64_t) coord.zoom << 58) | ((uint64_t) coord.x << 29) | coord.y;
+    }
+
+    /// the maximum number of entries
+    size_t mCapacity;
+
+    /// the entries from the most to the least recently used
+    EntryList mEntries;
+
+    /// the position of each entry in the list
+    std::unordered_map<uint64_t, EntryList::iterator> mIndex;
+
+    /// the entries evicted or not cached, reused once nothing holds them
+    std::vector<std::shared_ptr<Entry>> mFree;
+
+    /// the lookup statistics
+    std::atomic<uint64_t> mHits;
+    std::atomic<uint64_t> mMisses;
+
+    mutable std::mutex mMutex;
+};
+
+#endif /* HEIGHTFIELDCACHE_H_ */
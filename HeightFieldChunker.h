@@ -6,6 +6,8 @@
  * @brief this declares and defines the `mesh` and `heightfield` classes
  */
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 #include "cpl_config.h"
@@ -25,6 +27,8 @@ namespace stt
         struct gen_state;
         class mesh;
         class heightfield;
+        struct row_heights;
+        template <class Heights> class compact_heightfield;
     }
 }
 
@@ -64,7 +68,7 @@ public:
 class stt::chunk::heightfield {
 public:
     /// constructor
-    heightfield(float *tileHeights, int tileSize) {
+    heightfield(const float *tileHeights, int tileSize) {
         int tileCellSize = tileSize * tileSize;
 
         m_heights = tileHeights;
@@ -214,6 +218,16 @@ public:
         }
     }
 
+    /// copy the activation levels of the grid, e.g. to restore them later.
+    void copyLevels(std::vector<int> &levels) const {
+        levels.assign(m_levels, m_levels + (m_size * m_size));
+    }
+
+    /// replace the activation levels of the grid with previously copied ones.
+    void setLevels(const int *levels) {
+        std::copy(levels, levels + (m_size * m_size), m_levels);
+    }
+
     /// return the array-index of specified coordinate, row order by default.
     virtual int indexOfGridCoordinate(int x, int y) const {
         return (y * m_size) + x;
@@ -253,7 +267,7 @@ public:
 private:
     int m_size;        // number of cols and rows of this Heightmap
     int m_log_size;    // size == (1 << log_size) + 1
-    float *m_heights;  // grid of heights
+    const float *m_heights;  // grid of heights
     int *m_levels;     // grid of activation levels
 
     /// return the activation level at (x, y)
@@ -480,4 +494,444 @@ private:
     }
 };
 
+/// accesses the heights of a square grid stored row by row.
+struct stt::chunk::row_heights
+{
+    const float *heights;   // the heights, row by row
+    int size;               // number of cols and rows of the grid
+
+    row_heights(const float *tileHeights, int tileSize):
+        heights(tileHeights),
+        size(tileSize)
+    {}
+
+    /// return the height of specified coordinate
+    float operator()(int x, int y) const {
+        return heights[(y * size) + x];
+    }
+};
+
+/**
+ * defines a regular grid of heights like `heightfield`, generating the same
+ * meshes with less memory and time.
+ *
+ * the heights are read through a `Heights` accessor such as `row_heights`
+ * and meshes are emitted to any class with `clear()` and `emit_vertex()`
+ * members, so neither is called virtually. activation levels take a byte per
+ * vertex rather than an `int`, and the triangle bintree and quadtree are
+ * walked with explicit stacks rather than recursion. the levels can be kept
+ * in a buffer of the caller, e.g. one reused between tiles, so that creating
+ * a heightfield doesn't allocate.
+ */
+template <class Heights>
+class stt::chunk::compact_heightfield {
+public:
+    /// the value of the levels of vertices which are not active
+    static constexpr uint8_t inactive = 0x0F;
+
+    /// the largest grid supported is `(1 << max_log_size) + 1` square
+    static constexpr int max_log_size = 15;
+
+    /// constructor
+    compact_heightfield(const Heights &heights, int tileSize):
+        m_heights(heights),
+        m_size(tileSize),
+        m_log_size((int)(log2((float)tileSize - 1) + 0.5)),
+        m_own_levels((size_t) tileSize * tileSize, inactive),
+        m_levels(m_own_levels.data())
+    {
+        check_size();
+    }
+
+    /// constructor keeping the levels in `levels`, a buffer of `tileSize *
+    /// tileSize` bytes which must outlive the heightfield
+    compact_heightfield(const Heights &heights, int tileSize, uint8_t *levels):
+        m_heights(heights),
+        m_size(tileSize),
+        m_log_size((int)(log2((float)tileSize - 1) + 0.5)),
+        m_levels(levels)
+    {
+        check_size();
+        std::fill(m_levels, m_levels + level_count(), inactive);
+    }
+
+    /// the levels may be owned so the heightfield is not copied
+    compact_heightfield(const compact_heightfield &other) = delete;
+    compact_heightfield &operator=(const compact_heightfield &other) = delete;
+
+    // apply the specified maximum geometric error to fill the level
+    // info of the grid
+    void applyGeometricError(double maximumGeometricError, bool smoothSmallZooms = false) {
+        std::fill(m_levels, m_levels + level_count(), inactive);
+
+        // run a view-independent L-K style BTT update on the heightfield,
+        // to generate error and activation_level values for each element.
+        update(maximumGeometricError, 0, m_size - 1, m_size - 1, m_size - 1, 0, 0); // sw half of the square
+        update(maximumGeometricError, m_size - 1, 0, 0, 0, m_size - 1, m_size - 1); // ne half of the square
+
+        // make sure our corner verts are activated.
+        int size = (m_size - 1);
+        activate(size, 0, 0);
+        activate(0, 0, 0);
+        activate(0, size, 0);
+        activate(size, size, 0);
+
+        // activate some vertices to smooth the shape of the Globe for small zooms.
+        if (smoothSmallZooms) {
+            int step = std::max(size / 16, 1);
+
+            for (int x = 0; x <= size; x += step) {
+                for (int y = 0; y <= size; y += step) {
+                    if (get_level(x, y) == -1) activate(x, y, 0);
+                }
+            }
+        }
+
+        propagate();
+    }
+
+    /// apply the activation state of the border of the specified Neighbor
+    /// (Left=0, Top=1, Right=2, Bottom=3)
+    void applyBorderActivationState(const compact_heightfield &hf, int borderIndex) {
+        const int last = m_size - 1;
+        int level = -1;
+
+        for (int i = 0; i < m_size; i++) {
+            switch (borderIndex) {
+                case 0:
+                    level = hf.get_level(last, i);
+                    if (level != -1) activate(0, i, level);
+                    break;
+
+                case 1:
+                    level = hf.get_level(i, last);
+                    if (level != -1) activate(i, 0, level);
+                    break;
+
+                case 2:
+                    level = hf.get_level(0, i);
+                    if (level != -1) activate(last, i, level);
+                    break;
+
+                case 3:
+                    level = hf.get_level(i, 0);
+                    if (level != -1) activate(i, last, level);
+                    break;
+
+                default:
+                    throw STTException("Bad Neighbor border index");
+            }
+        }
+
+        propagate();
+    }
+
+    /// copy the activation levels of the grid, e.g. to restore them later.
+    void copyLevels(std::vector<uint8_t> &levels) const {
+        levels.assign(m_levels, m_levels + level_count());
+    }
+
+    /// replace the activation levels of the grid with previously copied ones.
+    void setLevels(const uint8_t *levels) {
+        std::copy(levels, levels + level_count(), m_levels);
+    }
+
+    /// return the array-index of specified coordinate, in row order.
+    int indexOfGridCoordinate(int x, int y) const {
+        return (y * m_size) + x;
+    }
+
+    /// return the height of specified coordinate
+    float height(int x, int y) const {
+        return m_heights(x, y);
+    }
+
+    /// return the number of cols and rows of the grid
+    int size() const {
+        return m_size;
+    }
+
+    /// generates the mesh using verts which are active at the given level.
+    template <class Mesh>
+    void generateMesh(Mesh &mesh, int level) {
+        int size = (1 << m_log_size);
+
+        // start making the mesh
+        mesh.clear();
+
+        // make sure our corner verts are activate on this level
+        activate(size, 0, level);
+        activate(0, 0, level);
+        activate(0, size, level);
+        activate(size, size, level);
+
+        generate_block(mesh, level, size >> 1, size >> 1);
+    }
+
+private:
+    Heights m_heights;                  // accessor of the grid of heights
+    int m_size;                         // number of cols and rows of this Heightmap
+    int m_log_size;                     // size == (1 << log_size) + 1
+    std::vector<uint8_t> m_own_levels;  // the levels, unless kept by the caller
+    uint8_t *m_levels;                  // grid of activation levels
+
+    /// throw unless the size is a power of two plus one
+    void check_size() const {
+        if (m_log_size > max_log_size || (1 << m_log_size) + 1 != m_size)
+            throw STTException("The heightfield size must be a power of two plus one");
+    }
+
+    /// return the number of levels in the grid
+    size_t level_count() const {
+        return (size_t) m_size * m_size;
+    }
+
+    /// return the activation level stored in `levels`, -1 if inactive
+    static int level_of(const uint8_t *levels, int index) {
+        int level = levels[index];
+        return (level == inactive) ? -1 : level;
+    }
+
+    /// raise the activation level stored in `levels` to the given level.
+    /// as with `heightfield` levels are kept to four bits.
+    static void raise_level(uint8_t *levels, int index, int level) {
+        if (level > level_of(levels, index)) levels[index] = level & 0x0F;
+    }
+
+    /// return the activation level at (x, y)
+    int get_level(int x, int y) const {
+        return level_of(m_levels, indexOfGridCoordinate(x, y));
+    }
+
+    /// sets the activation_level to the given level.
+    /// if it's greater than the vert's current activation level.
+    void activate(int x, int y, int level) {
+        raise_level(m_levels, indexOfGridCoordinate(x, y), level);
+    }
+
+    /// computes an error value and activation level for the base vertex of
+    /// the triangle and of all the triangles it is divided into.
+    void update(double base_max_error, int ax, int ay, int rx, int ry, int lx, int ly) {
+        struct triangle { int ax, ay, rx, ry, lx, ly; };
+
+        // the levels are written through a byte pointer, which may alias
+        // anything, so the state of the walk is kept in locals
+        uint8_t *levels = m_levels;
+        const Heights heights = m_heights;
+        const int size = m_size;
+
+        // the bintree is walked depth first, so at most a triangle per
+        // level is waiting besides the one being divided
+        triangle stack[2 * max_log_size + 1];
+        int top = 0;
+        triangle t = { ax, ay, rx, ry, lx, ly };
+
+        for (;;) {
+            // compute the coordinates of this triangle's base vertex.
+            int dx = t.lx - t.rx;
+            int dy = t.ly - t.ry;
+
+            // we've reached the base level. there's no base vertex
+            // to update, and no child triangles to go on with.
+            if (std::abs(dx) <= 1 && std::abs(dy) <= 1) {
+                if (top == 0) break;
+                t = stack[--top];
+                continue;
+            }
+
+            // base vert is midway between left and right verts
+            int bx = t.rx + (dx >> 1);
+            int by = t.ry + (dy >> 1);
+
+            float heightB = heights(bx, by);
+            float heightL = heights(t.lx, t.ly);
+            float heightR = heights(t.rx, t.ry);
+            float error_B = std::abs(heightB - 0.5 * (heightL + heightR));
+
+            if (error_B >= base_max_error) {
+                // compute the mesh level above which this vertex needs
+                // to be included in LOD meshes.
+                int activation_level = (int)std::floor(log2(error_B / base_max_error) + 0.5);
+
+                // force the base vert to at least this activation level
+                raise_level(levels, (by * size) + bx, activation_level);
+            }
+
+            // child triangles: base, apex, right now and base, left, apex later
+            stack[top++] = { bx, by, t.lx, t.ly, t.ax, t.ay };
+            t = { bx, by, t.ax, t.ay, t.rx, t.ry };
+        }
+    }
+
+    /// propagate the activation_level values of verts to their parent verts,
+    /// quadtree LOD style. gives same result as L-K.
+    void propagate() {
+        for (int i = 0; i < m_log_size; i++) {
+            propagate_activation_level(i);
+            propagate_activation_level(i);
+        }
+    }
+
+    /// gather the even bits of `d` into the low half of the result
+    static uint32_t even_bits(uint32_t d) {
+        d &= 0x55555555;
+        d = (d | (d >> 1)) & 0x33333333;
+        d = (d | (d >> 2)) & 0x0F0F0F0F;
+        d = (d | (d >> 4)) & 0x00FF00FF;
+        d = (d | (d >> 8)) & 0x0000FFFF;
+        return d;
+    }
+
+    /// propagates the child center verts of every square of size
+    /// (2 ^ (level + 1) + 1 to the corresponding edge verts, and the edge
+    /// verts to the center. the squares are visited in the order of
+    /// `heightfield`'s quadtree descent, i.e. along a Morton curve, which
+    /// matters as neighbouring squares share edge verts.
+    void propagate_activation_level(int level) {
+        uint8_t *levels = m_levels;
+        const int size = m_size;
+        const int half_size = 1 << level;
+        const int quarter_size = half_size >> 1;
+        const uint32_t count = (uint32_t) 1 << (2 * (m_log_size - 1 - level));
+
+        for (uint32_t d = 0; d < count; d++) {
+            // de-interleave the Morton code into the square's column and row
+            int cx = half_size + (int)(even_bits(d) << (level + 1));
+            int cy = half_size + (int)(even_bits(d >> 1) << (level + 1));
+            int c = (cy * size) + cx;
+
+            // indices of the edge verts
+            int e = c + half_size;
+            int n = c - half_size * size;
+            int w = c - half_size;
+            int s = c + half_size * size;
+
+            if (level > 0) {
+                int lev = 0;
+
+                // propagate child verts to edge verts.
+                lev = level_of(levels, c + quarter_size - quarter_size * size);  // ne.
+                raise_level(levels, e, lev);
+                raise_level(levels, n, lev);
+
+                lev = level_of(levels, c - quarter_size - quarter_size * size);  // nw.
+                raise_level(levels, n, lev);
+                raise_level(levels, w, lev);
+
+                lev = level_of(levels, c - quarter_size + quarter_size * size);  // sw.
+                raise_level(levels, w, lev);
+                raise_level(levels, s, lev);
+
+                lev = level_of(levels, c + quarter_size + quarter_size * size);  // se.
+                raise_level(levels, s, lev);
+                raise_level(levels, e, lev);
+            }
+
+            // propagate edge verts to center.
+            raise_level(levels, c, level_of(levels, e));
+            raise_level(levels, c, level_of(levels, n));
+            raise_level(levels, c, level_of(levels, s));
+            raise_level(levels, c, level_of(levels, w));
+        }
+    }
+
+    /// generates a mesh from a triangular quadrant of a square heightfield
+    /// block, walking its bintree in order as `heightfield` does.
+    template <class Mesh>
+    void generate_quadrant(Mesh &mesh, gen_state &state, int lx, int ly, int tx, int ty, int rx, int ry, int recursion_level) const {
+        struct triangle { int lx, ly, tx, ty, rx, ry, recursion_level; };
+
+        // the triangles are walked in order: a triangle waits on the stack
+        // while its left half is generated, so at most one per level is waiting.
+        triangle stack[2 * max_log_size + 1];
+        int top = 0;
+        triangle t = { lx, ly, tx, ty, rx, ry, recursion_level };
+
+        for (;;) {
+            // descend the left halves of active triangles
+            while (t.recursion_level > 0 && get_level(t.tx, t.ty) >= state.activation_level) {
+                stack[top++] = t;
+                t = { t.lx, t.ly, (t.lx + t.rx) >> 1, (t.ly + t.ry) >> 1, t.tx, t.ty, t.recursion_level - 1 };
+            }
+
+            if (top == 0) break;
+            t = stack[--top];
+
+            if (state.in_my_buffer(t.tx, t.ty) == false) {
+                if ((t.recursion_level + state.previous_level) & 1) {
+                    state.ptr ^= 1;
+                } else {
+                    int x = state.my_buffer[1 - state.ptr][0];
+                    int y = state.my_buffer[1 - state.ptr][1];
+                    mesh.emit_vertex(*this, x, y);    // or, emit vertex(last - 1);
+                }
+                mesh.emit_vertex(*this, t.tx, t.ty);
+                state.set_my_buffer(t.tx, t.ty);
+                state.previous_level = t.recursion_level;
+            }
+
+            // then the right half of the triangle
+            t = { t.tx, t.ty, (t.lx + t.rx) >> 1, (t.ly + t.ry) >> 1, t.rx, t.ry, t.recursion_level - 1 };
+        }
+    }
+
+    /// generate the mesh for the specified square with the given center as a
+    /// single continuous triangle strip, as `heightfield::generate_block`.
+    template <class Mesh>
+    void generate_block(Mesh &mesh, int activation_level, int cx, int cy) const {
+        int hs = 1 << (m_log_size - 1);
+
+        // quadrant corner coordinates.
+        int q[4][2] = {
+            { cx + hs, cy + hs }, // se
+            { cx + hs, cy - hs }, // ne
+            { cx - hs, cy - hs }, // nw
+            { cx - hs, cy + hs }, // sw
+        };
+
+        // init state for generating mesh.
+        gen_state state;
+        state.ptr = 0;
+        state.previous_level = 0;
+        state.activation_level = activation_level;
+
+        for (int i = 0; i < 4; i++) {
+            state.my_buffer[i >> 1][i & 1] = -1;
+        }
+
+        mesh.emit_vertex(*this, q[0][0], q[0][1]);
+        state.set_my_buffer(q[0][0], q[0][1]);
+
+        for (int i = 0; i < 4; i++) {
+            if ((state.previous_level & 1) == 0) {
+                // turn a corner
+                state.ptr ^= 1;
+            } else {
+                // jump via degenerate
+                int x = state.my_buffer[1 - state.ptr][0];
+                int y = state.my_buffer[1 - state.ptr][1];
+
+                mesh.emit_vertex(*this, x, y); // or, emit vertex(last - 1);
+            }
+
+            // initial vertex of quadrant.
+            mesh.emit_vertex(*this, q[i][0], q[i][1]);
+            state.set_my_buffer(q[i][0], q[i][1]);
+            state.previous_level = 2 * m_log_size + 1;
+
+            generate_quadrant(mesh, state,
+                q[i][0], q[i][1],                        // q[i][l]
+                cx, cy,                                  // q[i][t]
+                q[(i + 1) & 3][0], q[(i + 1) & 3][1],    // q[i][r]
+                2 * m_log_size
+            );
+        }
+
+        if (state.in_my_buffer(q[0][0], q[0][1]) == false) {
+            // finish off the strip.
+            mesh.emit_vertex(*this, q[0][0], q[0][1]);
+        }
+    }
+};
+
 #endif /* HEIGHTFIELDCHUNKER_H_ */
@@ -0,0 +1,253 @@
+/**
+ * @file HeightFieldStore.cpp
+ * @brief this defines the `HeightFieldStore` class
+ */
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cpl_vsi.h"
+
+#include "STTException.h"
+#include "HeightFieldStore.h"
+
+using namespace stt;
+
+/// write a whole buffer at an offset of a file
+static bool
+writeAt(int fd, const void *data, size_t size, uint64_t offset)
+{
+    const char *bytes = static_cast<const char *>(data);
+
+    while (size > 0) {
+        ssize_t written = pwrite(fd, bytes, size, offset);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+
+    return true;
+}
+
+/// read a whole buffer from an offset of a file
+static bool
+readAt(int fd, void *data, size_t size, uint64_t offset)
+{
+    char *bytes = static_cast<char *>(data);
+
+    while (size > 0) {
+        ssize_t read = pread(fd, bytes, size, offset);
+        if (read < 0 && errno == EINTR)
+            continue;
+        if (read <= 0)
+            return false;
+
+        bytes += read;
+        size -= read;
+        offset += read;
+    }
+
+    return true;
+}
+
+stt::HeightFieldStore::HeightFieldStore(size_t cellCount, uint64_t memoryLimit,
+    const std::string &spillFilename):
+    mCellCount(cellCount),
+    mMemoryLimit(memoryLimit),
+    mMemoryUsed(0),
+    mSpillFilename(spillFilename),
+    mSpillFile(-1),
+    mSpillOffset(0)
+{}
+
+stt::HeightFieldStore::~HeightFieldStore()
+{
+    if (mSpillFile >= 0) {
+        close(mSpillFile);
+        VSIUnlink(mSpillFilename.c_str());
+    }
+}
+
+bool
+stt::HeightFieldStore::reserveMemory(uint64_t bytes)
+{
+    uint64_t used = mMemoryUsed.load();
+
+    do {
+        if (used + bytes > mMemoryLimit)
+            return false;
+    } while (!mMemoryUsed.compare_exchange_weak(used, used + bytes));
+
+    return true;
+}
+
+/**
+ * @details a slot released by `erase` is reused first, otherwise one is
+ * appended to the spill file. every slot holds the heights of a tile, so the
+ * file only grows to the most tiles spilled at once.
+ */
+uint64_t
+stt::HeightFieldStore::reserveSlot()
+{
+    std::lock_guard<std::mutex> lock(mSlotMutex);
+
+    if (mSpillFile < 0) {
+        mSpillFile = open(mSpillFilename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (mSpillFile < 0) {
+            throw STTException("Could not open the height spill file");
+        }
+    }
+
+    if (!mFreeSlots.empty()) {
+        const uint64_t offset = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        return offset;
+    }
+
+    const uint64_t offset = mSpillOffset;
+    mSpillOffset += mCellCount * sizeof(float);
+    return offset;
+}
+
+void
+stt::HeightFieldStore::releaseSlots(const std::vector<uint64_t> &offsets)
+{
+    std::lock_guard<std::mutex> lock(mSlotMutex);
+    mFreeSlots.insert(mFreeSlots.end(), offsets.begin(), offsets.end());
+}
+
+/**
+ * @details heights which do not fit within the memory limit are spilled to a
+ * slot of the spill file. the memory or slot is reserved and the heights are
+ * copied before the tile is added under the lock of its shard, so a tile is
+ * only found once its heights are complete. when two threads store the same
+ * tile at once, the second gives its reservation back.
+ */
+void
+stt::HeightFieldStore::put(const TileCoordinate &coord, const float *heights)
+{
+    const uint64_t tileKey = key(coord);
+    const size_t bytes = mCellCount * sizeof(float);
+    Shard &tileShard = shard(tileKey);
+
+    if (contains(coord))
+        return;
+
+    Entry entry;
+    entry.offset = 0;
+
+    const bool inMemory = reserveMemory(bytes);
+    if (inMemory) {
+        entry.heights.assign(heights, heights + mCellCount);
+    } else {
+        entry.offset = reserveSlot();
+
+        if (!writeAt(mSpillFile, heights, bytes, entry.offset)) {
+            releaseSlots(std::vector<uint64_t>(1, entry.offset));
+            throw STTException("Could not write to the height spill file");
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(tileShard.mutex);
+        if (tileShard.entries.emplace(tileKey, std::move(entry)).second)
+            return;
+    }
+
+    if (inMemory) {
+        mMemoryUsed -= bytes;
+    } else {
+        releaseSlots(std::vector<uint64_t>(1, entry.offset));
+    }
+}
+
+/**
+ * @details heights in memory are copied under the lock of their shard, while
+ * spilled heights are read from the file after it has been released.
+ */
+bool
+stt::HeightFieldStore::get(const TileCoordinate &coord, float *heights) const
+{
+    const uint64_t tileKey = key(coord);
+    const Shard &tileShard = shard(tileKey);
+    uint64_t offset;
+
+    {
+        std::lock_guard<std::mutex> lock(tileShard.mutex);
+        std::unordered_map<uint64_t, Entry>::const_iterator found = tileShard.entries.find(tileKey);
+
+        if (found == tileShard.entries.end())
+            return false;
+
+        const Entry &entry = found->second;
+
+        if (!entry.heights.empty()) {
+            std::copy(entry.heights.begin(), entry.heights.end(), heights);
+            return true;
+        }
+
+        offset = entry.offset;
+    }
+
+    if (!readAt(mSpillFile, heights, mCellCount * sizeof(float), offset)) {
+        throw STTException("Could not read from the height spill file");
+    }
+
+    return true;
+}
+
+bool
+stt::HeightFieldStore::contains(const TileCoordinate &coord) const
+{
+    const uint64_t tileKey = key(coord);
+    const Shard &tileShard = shard(tileKey);
+
+    std::lock_guard<std::mutex> lock(tileShard.mutex);
+    return tileShard.entries.find(tileKey) != tileShard.entries.end();
+}
+
+void
+stt::HeightFieldStore::erase(i_zoom zoom)
+{
+    std::vector<uint64_t> freed;
+
+    for (size_t i = 0; i < shardCount; ++i) {
+        std::lock_guard<std::mutex> lock(mShards[i].mutex);
+        std::unordered_map<uint64_t, Entry> &entries = mShards[i].entries;
+
+        for (std::unordered_map<uint64_t, Entry>::iterator it = entries.begin(); it != entries.end(); ) {
+            if ((it->first >> 58) == zoom) {
+                if (it->second.heights.empty()) {
+                    freed.push_back(it->second.offset);
+                }
+                mMemoryUsed -= it->second.heights.size() * sizeof(float);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    releaseSlots(freed);
+}
+
+size_t
+stt::HeightFieldStore::size() const
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < shardCount; ++i) {
+        std::lock_guard<std::mutex> lock(mShards[i].mutex);
+        count += mShards[i].entries.size();
+    }
+
+    return count;
+}
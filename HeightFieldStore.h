@@ -0,0 +1,141 @@
+#ifndef HEIGHTFIELDSTORE_H_
+#define HEIGHTFIELDSTORE_H_
+
+/**
+ * @file HeightFieldStore.h
+ * @brief this declares the `HeightFieldStore` class
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "TileCoordinate.h"
+
+namespace stt {
+    class HeightFieldStore;
+}
+
+/**
+ * @brief hold the raster heights of tiles until they are no longer needed
+ *
+ * heights are kept in memory until a memory limit is reached, after which
+ * further heights are spilled to a temporary file and read back from there on
+ * request. heights are released a zoom level at a time with
+ * `HeightFieldStore::erase`, which frees their slots in the spill file for
+ * the heights spilled next. instances can be shared between threads: the
+ * tiles are spread over shards with a lock each, and the heights are copied
+ * to and from the spill file without holding a lock. a zoom level must not
+ * be erased while its heights are still being read.
+ */
+class STT_DLL stt::HeightFieldStore
+{
+public:
+    /// create a store for tiles of `cellCount` heights with a memory limit in bytes
+    HeightFieldStore(size_t cellCount, uint64_t memoryLimit, const std::string &spillFilename);
+
+    /// the store owns its spill file so it is not copied
+    HeightFieldStore(const HeightFieldStore &other) = delete;
+    HeightFieldStore &operator=(const HeightFieldStore &other) = delete;
+
+    /// the destructor removes the spill file
+    ~HeightFieldStore();
+
+    /// store a copy of the heights of a tile
+    void
+    put(const TileCoordinate &coord, const float *heights);
+
+    /// copy the heights of a tile, returning `false` if they are not stored
+    bool
+    get(const TileCoordinate &coord, float *heights) const;
+
+    /// is a tile stored?
+    bool
+    contains(const TileCoordinate &coord) const;
+
+    /// release the heights of every tile at a zoom level
+    void
+    erase(i_zoom zoom);
+
+    /// get the number of tiles stored
+    size_t
+    size() const;
+
+    /// get the number of heights stored per tile
+    inline size_t
+    cellCount() const {
+        return mCellCount;
+    }
+
+protected:
+    /// the heights of a tile, either in memory or at an offset in the spill file
+    struct Entry {
+        std::vector<float> heights;
+        uint64_t offset;
+    };
+
+    /// the number of shards the tiles are spread over
+    static const size_t shardCount = 16;
+
+    /// the tiles of a shard and the lock guarding them
+    struct Shard {
+        std::unordered_map<uint64_t, Entry> entries;
+        mutable std::mutex mutex;
+    };
+
+    /// pack a tile coordinate into a key
+    static inline uint64_t
+    key(const TileCoordinate &coord) {
+        return ((uint64_t) coord.zoom << 58) | ((uint64_t) coord.x << 29) | coord.y;
+    }
+
+    /// get the shard of a key, mixing the bits so neighbouring tiles spread
+    inline Shard &
+    shard(uint64_t key) const {
+        return mShards[((key * 0x9E3779B97F4A7C15ull) >> 32) % shardCount];
+    }
+
+    /// reserve the memory for the heights of a tile, returning `false` if it
+    /// would exceed the limit
+    bool
+    reserveMemory(uint64_t bytes);
+
+    /// get a free slot in the spill file, opening it on first use
+    uint64_t
+    reserveSlot();
+
+    /// hand slots of the spill file back for reuse
+    void
+    releaseSlots(const std::vector<uint64_t> &offsets);
+
+    /// the number of heights in a tile
+    size_t mCellCount;
+
+    /// the number of bytes of heights allowed in memory
+    uint64_t mMemoryLimit;
+
+    /// the number of bytes of heights currently in memory
+    std::atomic<uint64_t> mMemoryUsed;
+
+    /// the stored tiles
+    mutable Shard mShards[shardCount];
+
+    /// the file heights are spilled to, opened on first use, or `-1`
+    std::string mSpillFilename;
+    int mSpillFile;
+
+    /// the end of the data in the spill file
+    uint64_t mSpillOffset;
+
+    /// the offsets of the slots in the spill file which have been released
+    std::vector<uint64_t> mFreeSlots;
+
+    /// guards the spill file's slots, never held while copying heights
+    std::mutex mSlotMutex;
+};
+
+#endif /* HEIGHTFIELDSTORE_H_ */
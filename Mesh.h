@@ -32,6 +32,28 @@ public:
     /// the index collection for each triangle in the mesh (3 for each triangle)
     std::vector<uint32_t> indices;
 
+    /// the edges of a mesh
+    enum Edge {
+        EDGE_WEST = 0,
+        EDGE_SOUTH = 1,
+        EDGE_EAST = 2,
+        EDGE_NORTH = 3
+    };
+
+    /// the indices of the vertices on each edge of the mesh, from south to
+    /// north on the west and east edges and from west to east on the others
+    std::vector<uint32_t> edgeIndices[4];
+
+    /// remove all vertices, triangles and edges, keeping their memory
+    void clear() {
+        vertices.clear();
+        indices.clear();
+
+        for (int edge = 0; edge < 4; edge++) {
+            edgeIndices[edge].clear();
+        }
+    }
+
     /// write mesh data to a WKT file
     void writeWktFile(const char *fileName) const {
         FILE *fp = fopen(fileName, "w");
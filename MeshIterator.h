@@ -29,10 +29,13 @@ public:
         MeshIterator(tiler, tiler.maxZoomLevel(), 0)
     {}
 
-    MeshIterator(const MeshTiler &tiler, i_zoom startZoom, i_zoom endZoom = 0):
+    /// instantiate an iterator over a range of zoom levels in a tile order
+    MeshIterator(const MeshTiler &tiler, i_zoom startZoom, i_zoom endZoom = 0, TileOrder order = TILE_ORDER_COLUMN):
         GridIterator(tiler.grid(), tiler.bounds(), startZoom, endZoom),
         tiler(tiler)
-    {}
+    {
+        setOrder(order);
+    }
 
     /// override the dereference operator to return a Tile
     virtual MeshTile *
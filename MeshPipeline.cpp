@@ -0,0 +1,250 @@
+/**
+ * @file MeshPipeline.cpp
+ * @brief this defines the `MeshPipeline` class
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#include "STTException.h"
+#include "STTMemoryOutputStream.h"
+#include "MeshPipeline.h"
+
+using namespace stt;
+
+/// the names of the stages as printed in the statistics
+static const char *stageNames[] = {"read", "chunk", "encode", "compress", "write"};
+
+/// a tile on its way through the pipeline
+struct stt::MeshPipeline::Job {
+    Job(const TileCoordinate &coord):
+        coord(coord),
+        heights(NULL),
+        tile(NULL)
+    {}
+
+    ~Job() {
+        CPLFree(heights);
+        delete tile;
+    }
+
+    TileCoordinate coord;                 /// the tile being built
+    float *heights;                       /// the heights, until chunked
+    MeshTile *tile;                       /// the mesh, until encoded
+    std::vector<unsigned char> data;      /// the encoded and then compressed tile
+};
+
+stt::MeshPipeline::MeshPipeline(const MeshTiler &tiler, GDALDatasetPool &pool,
+    MeshSerializer &serializer, const Options &options):
+    mTiler(tiler),
+    mPool(pool),
+    mSerializer(serializer),
+    mWriteVertexNormals(options.writeVertexNormals),
+    mCodec(options.codec ? *options.codec : TileCodec::gzip()),
+    mQueueCapacity(options.queueCapacity),
+    mNextIndex(0),
+    mEndIndex(0),
+    mAborted(false)
+{
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        mThreads[stage] = options.threads[stage];
+
+        if (mThreads[stage] == 0) {
+            mThreads[stage] = std::thread::hardware_concurrency();
+        }
+        if (mThreads[stage] == 0) {
+            mThreads[stage] = 1;
+        }
+    }
+}
+
+stt::MeshPipeline::~MeshPipeline()
+{
+}
+
+/**
+* @details readers `0` to `threadCount(READ) - 1` are used by the read stage
+* and the rest by the chunk stage, which reads the neighbours of each tile.
+* every reader, and the pooled handle of the same index, is only ever used by
+* one thread.
+*/
+void
+stt::MeshPipeline::run(const GridIterator &iter,
+    const std::vector<GDALDatasetReader *> &readers, const TileFilter &filter)
+{
+    if (readers.size() < readerCount()) {
+        throw STTException("The pipeline needs a reader for every read and chunk thread");
+    }
+    if (mPool.workers() < readerCount()) {
+        throw STTException("The pipeline needs a pooled dataset for every read and chunk thread");
+    }
+
+    mQueues.clear();
+    for (int stage = 0; stage < WRITE; ++stage) {
+        mQueues.push_back(std::unique_ptr<JobQueue>(new JobQueue(mQueueCapacity)));
+    }
+
+    mNextIndex = iter.getIndex();
+    mEndIndex = iter.getEndIndex();
+    mAborted = false;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        mActive[stage] = mThreads[stage];
+        mStatistics[stage] = StageStatistics();
+    }
+
+    std::vector<std::thread> threads;
+    unsigned int readerIndex = 0;
+
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        for (unsigned int i = 0; i < mThreads[stage]; ++i) {
+            const unsigned int handle = readerIndex;
+            GDALDatasetReader *reader = (stage == READ || stage == CHUNK) ? readers[readerIndex++] : NULL;
+
+            threads.push_back(std::thread([this, stage, i, &iter, handle, reader, &filter]() {
+                try {
+                    work((Stage) stage, i, iter, handle, reader, filter);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mErrorMutex);
+                    if (!mError) {
+                        mError = std::current_exception();
+                    }
+                    abort();
+                }
+
+                // the last thread of a stage tells the next stage there is no more
+                if (--mActive[stage] == 0 && stage < WRITE) {
+                    mQueues[stage]->close();
+                }
+            }));
+        }
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    mQueueStatistics.clear();
+    for (size_t i = 0; i < mQueues.size(); ++i) {
+        mQueueStatistics.push_back(mQueues[i]->statistics());
+    }
+    mQueues.clear();
+
+    if (mError) {
+        std::exception_ptr error = mError;
+        mError = NULL;
+        std::rethrow_exception(error);
+    }
+}
+
+void
+stt::MeshPipeline::printStatistics(std::ostream &stream) const
+{
+    stream << std::fixed << std::setprecision(2);
+
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        const StageStatistics &stats = mStatistics[stage];
+        double rate = (stats.seconds > 0) ? stats.tiles / stats.seconds : 0;
+
+        stream << stageNames[stage] << ": " << mThreads[stage] << " threads, "
+               << stats.tiles << " tiles in " << stats.seconds << "s ("
+               << rate << " tiles/s per thread)\n";
+
+        if (stage < (int) mQueueStatistics.size()) {
+            const JobQueue::Statistics &queue = mQueueStatistics[stage];
+
+            stream << "  queue to " << stageNames[stage + 1] << ": mean depth "
+                   << queue.meanDepth() << " of " << mQueueCapacity << ", max "
+                   << queue.maxDepth << ", producers waited " << queue.fullSeconds
+                   << "s, consumers waited " << queue.emptySeconds << "s\n";
+        }
+    }
+}
+
+void
+stt::MeshPipeline::work(Stage stage, unsigned int thread, const GridIterator &iter,
+    unsigned int handle, GDALDatasetReader *reader, const TileFilter &filter)
+{
+    StageStatistics stats;
+    JobPtr job;
+
+    while (!mAborted) {
+        if (stage == READ) {
+            i_tile_index index = mNextIndex++;
+            if (index >= mEndIndex)
+                break;
+
+            TileCoordinate coord = iter.coordinateAt(index);
+            if (filter && !filter(thread, coord))
+                continue;
+
+            job.reset(new Job(coord));
+        } else if (!mQueues[stage - 1]->pop(job)) {
+            break;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        process(stage, *job, handle, reader);
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++stats.tiles;
+
+        if (stage < WRITE && !mQueues[stage]->push(std::move(job)))
+            break;
+    }
+
+    std::lock_guard<std::mutex> lock(mStatisticsMutex);
+    mStatistics[stage].tiles += stats.tiles;
+    mStatistics[stage].seconds += stats.seconds;
+}
+
+void
+stt::MeshPipeline::process(Stage stage, Job &job, unsigned int handle, GDALDatasetReader *reader)
+{
+    const i_tile tileSize = mTiler.grid().tileSize();
+
+    switch (stage) {
+    case READ:
+        job.heights = reader->readRasterHeights(mPool.dataset(handle), job.coord, tileSize, tileSize);
+        break;
+
+    case CHUNK:
+        job.tile = mTiler.createMesh(mPool.dataset(handle), job.coord, job.heights, reader);
+        CPLFree(job.heights);
+        job.heights = NULL;
+        break;
+
+    case ENCODE: {
+        STTMemoryOutputStream ostream;
+        job.tile->writeFile(ostream, mWriteVertexNormals);
+        job.data.swap(ostream.buffer());
+
+        delete job.tile;
+        job.tile = NULL;
+        break;
+    }
+
+    case COMPRESS: {
+        std::vector<unsigned char> compressed;
+        mCodec.encode(job.data.data(), job.data.size(), compressed);
+        job.data.swap(compressed);
+        break;
+    }
+
+    default:
+        mSerializer.serializeTileData(&job.coord, job.data.data(), job.data.size());
+    }
+}
+
+/**
+* @details all queues are emptied and closed, which releases every thread
+* blocked on them.
+*/
+void
+stt::MeshPipeline::abort()
+{
+    mAborted = true;
+
+    for (size_t i = 0; i < mQueues.size(); ++i) {
+        mQueues[i]->abort();
+    }
+}
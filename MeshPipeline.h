@@ -0,0 +1,170 @@
+#ifndef MESHPIPELINE_H_
+#define MESHPIPELINE_H_
+
+/**
+ * @file MeshPipeline.h
+ * @brief this declares the `MeshPipeline` class
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "config.h"
+#include "TileCoordinate.h"
+#include "GridIterator.h"
+#include "BoundedQueue.h"
+#include "MeshTiler.h"
+#include "MeshSerializer.h"
+#include "GDALDatasetPool.h"
+#include "GDALDatasetReader.h"
+#include "TileCodec.h"
+
+namespace stt {
+    class MeshPipeline;
+}
+
+/**
+ * @brief create and store mesh tiles in overlapping stages
+ *
+ * every tile passes through five stages, each run by its own pool of threads
+ * and connected to the next by a `BoundedQueue`:
+ *
+ * - read: the raster heights of the tile are read from the dataset
+ * - chunk: the heights are turned into a `MeshTile`
+ * - encode: the tile is encoded in the quantized mesh format
+ * - compress: the encoded tile is compressed by a `TileCodec`
+ * - write: the compressed tile is handed to a `MeshSerializer`
+ *
+ * the I/O bound stages can therefore overlap with the CPU bound ones instead
+ * of alternating with them. the queues limit the number of tiles in flight,
+ * and their statistics show which stage holds the others up:
+ *
+ * \code
+ *   MeshPipeline pipeline(tiler, pool, serializer, options);
+ *   pool.resize(pipeline.readerCount());
+ *   pipeline.run(MeshIterator(tiler), readers, filter);
+ *   pipeline.printStatistics(std::cout);
+ * \endcode
+ *
+ * the first exception thrown by any stage stops the pipeline and is rethrown
+ * from `MeshPipeline::run`.
+ */
+class STT_DLL stt::MeshPipeline
+{
+public:
+    /// the stages in the order tiles pass through them
+    enum Stage {
+        READ,
+        CHUNK,
+        ENCODE,
+        COMPRESS,
+        WRITE,
+        STAGE_COUNT
+    };
+
+    /// called by the read stage for every tile, returning whether to build it
+    typedef std::function<bool(unsigned int, const TileCoordinate &)> TileFilter;
+
+    /// options controlling the size of the pipeline
+    struct Options {
+        /// the number of threads in each stage (`0` uses all cores)
+        unsigned int threads[STAGE_COUNT] = {2, 0, 1, 1, 1};
+        /// the number of tiles each queue holds between stages
+        size_t queueCapacity = 64;
+        /// whether to write vertex normals into the tiles
+        bool writeVertexNormals = false;
+        /// the codec compressing the tiles, which defaults to gzip
+        const TileCodec *codec = NULL;
+    };
+
+    /// what a stage has done during a run
+    struct StageStatistics {
+        uint64_t tiles = 0;     /// the number of tiles processed
+        double seconds = 0;     /// the time spent processing them, over all threads
+    };
+
+    /// create a pipeline for a tiler storing its tiles with a serializer
+    MeshPipeline(const MeshTiler &tiler, GDALDatasetPool &pool,
+        MeshSerializer &serializer, const Options &options);
+
+    /// the destructor
+    ~MeshPipeline();
+
+    /// get the number of threads in a stage
+    inline unsigned int
+    threadCount(Stage stage) const {
+        return mThreads[stage];
+    }
+
+    /// get the number of readers, and of dataset pool handles, `MeshPipeline::run` needs
+    inline unsigned int
+    readerCount() const {
+        return mThreads[READ] + mThreads[CHUNK];
+    }
+
+    /// build the tiles of an iterator from its current position
+    void
+    run(const GridIterator &iter, const std::vector<GDALDatasetReader *> &readers,
+        const TileFilter &filter = TileFilter());
+
+    /// write what each stage and queue did in the last run
+    void
+    printStatistics(std::ostream &stream) const;
+
+protected:
+    /// a tile on its way through the pipeline
+    struct Job;
+    typedef std::unique_ptr<Job> JobPtr;
+    typedef BoundedQueue<JobPtr> JobQueue;
+
+    /// the loop run by each thread of a stage
+    void
+    work(Stage stage, unsigned int thread, const GridIterator &iter,
+        unsigned int handle, GDALDatasetReader *reader, const TileFilter &filter);
+
+    /// process a single tile in a stage, reading with a pooled handle
+    void
+    process(Stage stage, Job &job, unsigned int handle, GDALDatasetReader *reader);
+
+    /// record an exception and stop the pipeline
+    void
+    abort();
+
+    const MeshTiler &mTiler;
+    GDALDatasetPool &mPool;
+    MeshSerializer &mSerializer;
+    bool mWriteVertexNormals;
+    const TileCodec &mCodec;
+
+    /// the number of threads in each stage
+    unsigned int mThreads[STAGE_COUNT];
+
+    /// the queues, each feeding the stage after its index
+    size_t mQueueCapacity;
+    std::vector<std::unique_ptr<JobQueue>> mQueues;
+
+    /// the index of the next tile to be read
+    std::atomic<i_tile_index> mNextIndex;
+    i_tile_index mEndIndex;
+
+    /// the number of threads still running in each stage
+    std::atomic<unsigned int> mActive[STAGE_COUNT];
+
+    /// the statistics of the last run
+    StageStatistics mStatistics[STAGE_COUNT];
+    std::vector<JobQueue::Statistics> mQueueStatistics;
+    std::mutex mStatisticsMutex;
+
+    /// the first exception thrown by a stage
+    std::atomic<bool> mAborted;
+    std::exception_ptr mError;
+    std::mutex mErrorMutex;
+};
+
+#endif /* MESHPIPELINE_H_ */
@@ -18,6 +18,8 @@ namespace stt {
 class STT_DLL stt::MeshSerializer
 {
 public:
+    virtual ~MeshSerializer() {}
+
     /// start a new serialization task
     virtual void startSerialization() = 0;
 
@@ -27,6 +29,14 @@ public:
     /// serialize a MeshTile to the store
     virtual bool serializeTile(const stt::MeshTile *tile, bool writeVertexNormals = false) = 0;
 
+    /// store the already encoded and compressed data of a MeshTile
+    virtual bool serializeTileData(const stt::TileCoordinate *coordinate, const unsigned char *data, size_t size) = 0;
+
+    /// return once the tiles serialized so far would survive the process
+    /// stopping. stores which have written a tile when serializing it have
+    /// nothing to do
+    virtual void flush() {}
+
     /// serialization finished, releases any resources loaded
     virtual void endSerialization() = 0;
 };
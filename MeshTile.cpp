@@ -5,7 +5,6 @@
 
 #include <cmath>
 #include <vector>
-#include <map>
 #include "cpl_conv.h"
 
 #include "STTException.h"
@@ -116,30 +115,14 @@ static inline int quantizeIndices(
     return int(std::round((value - origin) * factor));
 }
 
-// write the edge indices of the mesh
+// write the indices of the vertices on an edge of the mesh
 template <typename T> int writeEdgeIndices(
     STTOutputStream &ostream,
     const Mesh &mesh,
-    double edgeCoord,
-    int componentIndex
+    Mesh::Edge edge
 )
 {
-    std::vector<uint32_t> indices;
-    std::map<uint32_t, size_t> ihash;
-
-    for (size_t i = 0; i < mesh.indices.size(); i++) {
-        uint32_t indice = mesh.indices[i];
-        double val = mesh.vertices[indice][componentIndex];
-
-        if (val == edgeCoord) {
-            std::map<uint32_t, size_t>::iterator it = ihash.find(indice);
-
-            if (it == ihash.end()) {
-                ihash.insert(std::make_pair(indice, i));
-                indices.push_back(indice);
-            }
-        }
-    }
+    const std::vector<uint32_t> &indices = mesh.edgeIndices[edge];
 
     int edgeCount = indices.size();
     ostream.write(&edgeCount, sizeof(int));
@@ -318,10 +301,10 @@ void MeshTile::writeFile(STTOutputStream &ostream, bool writeVertexNormals) cons
         }
 
         // write all vertices on the edge of the tile (W, S, E, N)
-        writeEdgeIndices<uint32_t>(ostream, mMesh, bounds.min.x, 0);
-        writeEdgeIndices<uint32_t>(ostream, mMesh, bounds.min.y, 1);
-        writeEdgeIndices<uint32_t>(ostream, mMesh, bounds.max.x, 0);
-        writeEdgeIndices<uint32_t>(ostream, mMesh, bounds.max.y, 1);
+        writeEdgeIndices<uint32_t>(ostream, mMesh, Mesh::EDGE_WEST);
+        writeEdgeIndices<uint32_t>(ostream, mMesh, Mesh::EDGE_SOUTH);
+        writeEdgeIndices<uint32_t>(ostream, mMesh, Mesh::EDGE_EAST);
+        writeEdgeIndices<uint32_t>(ostream, mMesh, Mesh::EDGE_NORTH);
     }
 
     // write 'Oct-Encoded Per-Vertex Normals' for Terrain Lighting
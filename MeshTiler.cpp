@@ -3,35 +3,55 @@
 * @brief this defines the `MeshTiler` class
 */
 
+#include <algorithm>
+
 #include "STTException.h"
 #include "MeshTiler.h"
 #include "HeightFieldChunker.h"
 #include "GDALDatasetReader.h"
+#include "TileArena.h"
 
 using namespace stt;
 
+/// the chunker used for the heights of a tile
+typedef stt::chunk::compact_heightfield<stt::chunk::row_heights> HeightField;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /**
-* implementation of stt::chunk::mesh for stt::Mesh class
+* receives the triangle strip of a `HeightField` to fill a stt::Mesh
+*
+* every corner of the strip's triangles is looked up in a flat array from grid
+* index to mesh vertex, so each vertex is added once in constant time. the
+* vertices on the edges of the mesh are found through the same array.
 */
-class WrapperMesh : public stt::chunk::mesh
+class WrapperMesh
 {
 private:
+    /// the value of grid indices without a mesh vertex yet
+    static constexpr int noVertex = -1;
+
     CRSBounds &mBounds;
     Mesh &mMesh;
     double mCellSizeX;
     double mCellSizeY;
 
-    std::map<int, int> mIndicesMap;
+    int *mIndices;              // the mesh vertex of each grid index, or noVertex
+    size_t mIndexCount;
+    i_tile mTileSizeX;
+    i_tile mTileSizeY;
     Coordinate<int> mTriangles[3];
     bool mTriOddOrder;
     int mTriIndex;
 
 public:
-    WrapperMesh(CRSBounds &bounds, Mesh &mesh, i_tile tileSizeX, i_tile tileSizeY):
-        mMesh(mesh),
+    WrapperMesh(CRSBounds &bounds, Mesh &mesh, i_tile tileSizeX, i_tile tileSizeY, TileArena &arena):
         mBounds(bounds),
+        mMesh(mesh),
+        mIndices(arena.vertexIndices((size_t) tileSizeX * tileSizeY)),
+        mIndexCount((size_t) tileSizeX * tileSizeY),
+        mTileSizeX(tileSizeX),
+        mTileSizeY(tileSizeY),
         mTriOddOrder(false),
         mTriIndex(0)
     {
@@ -39,15 +59,14 @@ public:
         mCellSizeY = (bounds.getMaxY() - bounds.getMinY()) / (double)(tileSizeY - 1);
     }
 
-    virtual void clear() {
-        mMesh.vertices.clear();
-        mMesh.indices.clear();
-        mIndicesMap.clear();
+    void clear() {
+        mMesh.clear();
+        std::fill(mIndices, mIndices + mIndexCount, noVertex);
         mTriOddOrder = false;
         mTriIndex = 0;
     }
 
-    virtual void emit_vertex(const stt::chunk::heightfield &heightfield, int x, int y) {
+    void emit_vertex(const HeightField &heightfield, int x, int y) {
         mTriangles[mTriIndex].x = x;
         mTriangles[mTriIndex].y = y;
         mTriIndex++;
@@ -72,13 +91,11 @@ public:
         }
     }
 
-    void appendVertex(const stt::chunk::heightfield &heightfield, int x, int y) {
-        int iv;
+    void appendVertex(const HeightField &heightfield, int x, int y) {
         int index = heightfield.indexOfGridCoordinate(x, y);
+        int iv = mIndices[index];
 
-        std::map<int, int>::iterator it = mIndicesMap.find(index);
-
-        if (it == mIndicesMap.end()) {
+        if (iv == noVertex) {
             iv = mMesh.vertices.size();
 
             double xmin = mBounds.getMinX();
@@ -86,25 +103,42 @@ public:
             double height = heightfield.height(x, y);
 
             mMesh.vertices.push_back(CRSVertex(xmin + (x * mCellSizeX), ymax - (y * mCellSizeY), height));
-            mIndicesMap.insert(std::make_pair(index, iv));
-        } else {
-            iv = it->second;
+            mIndices[index] = iv;
         }
         mMesh.indices.push_back(iv);
     }
+
+    /// fill the edge indices of the mesh once all vertices have been emitted.
+    /// grid rows run from north to south.
+    void emit_edges() {
+        const int lastX = mTileSizeX - 1;
+        const int lastY = mTileSizeY - 1;
+
+        for (int y = lastY; y >= 0; y--) {
+            appendEdgeVertex(Mesh::EDGE_WEST, 0, y);
+            appendEdgeVertex(Mesh::EDGE_EAST, lastX, y);
+        }
+        for (int x = 0; x <= lastX; x++) {
+            appendEdgeVertex(Mesh::EDGE_SOUTH, x, lastY);
+            appendEdgeVertex(Mesh::EDGE_NORTH, x, 0);
+        }
+    }
+
+    void appendEdgeVertex(Mesh::Edge edge, int x, int y) {
+        int iv = mIndices[(y * mTileSizeX) + x];
+        if (iv != noVertex) mMesh.edgeIndices[edge].push_back(iv);
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void stt::MeshTiler::prepareSettingsOfTile(MeshTile *terrainTile, GDALDataset *dataset,
-    const TileCoordinate &coord, float *rasterHeights, stt::i_tile tileSizeX,
-    stt::i_tile tileSizeY) const
+double stt::MeshTiler::geometricErrorForZoom(i_zoom zoom, stt::i_tile tileSize) const
 {
-    const stt::i_tile TILE_SIZE = tileSizeX;
+    const stt::i_tile TILE_SIZE = tileSize;
 
     // number of tiles in the horizontal direction at tile level zero
     double resolutionAtLevelZero = mGrid.resolution(0);
-    int numberOfTilesAtLevelZero = (int)(mGrid.getExtent().getWidth() / (tileSizeX * resolutionAtLevelZero));
+    int numberOfTilesAtLevelZero = (int)(mGrid.getExtent().getWidth() / (tileSize * resolutionAtLevelZero));
 
     // default quality of terrain created from heightmaps (TerrainProvider.js).
     double heightmapTerrainQuality = 0.25;
@@ -122,14 +156,87 @@ void stt::MeshTiler::prepareSettingsOfTile(MeshTile *terrainTile, GDALDataset *d
     );
 
     // geometric error for current level
-    maximumGeometricError /= (double)(1 << coord.zoom);
+    return maximumGeometricError / (double)(1 << zoom);
+}
+
+/**
+* @details the levels cached are those computed for the tile alone, before any
+* activation state is taken from its neighbours, which is what is needed both
+* for the tile itself and for stitching its neighbours to it. the cache is
+* only used above zoom level 6 where that holds.
+*/
+std::shared_ptr<const HeightFieldCache::Entry> stt::MeshTiler::cachedHeightField(
+    GDALDataset *dataset,
+    const TileCoordinate &coord,
+    GDALDatasetReader *reader,
+    TileArena &arena) const
+{
+    std::shared_ptr<const HeightFieldCache::Entry> cached = mCache->get(coord);
+    if (cached) {
+        return cached;
+    }
+
+    const stt::i_tile TILE_SIZE = mGrid.tileSize();
+    float *rasterHeights = arena.heights(TILE_SIZE * TILE_SIZE);
+    readRasterHeights(dataset, coord, reader, rasterHeights);
+
+    return cacheHeightField(coord, rasterHeights, arena);
+}
+
+std::shared_ptr<const HeightFieldCache::Entry> stt::MeshTiler::cacheHeightField(
+    const TileCoordinate &coord,
+    const float *rasterHeights,
+    TileArena &arena) const
+{
+    const stt::i_tile TILE_SIZE = mGrid.tileSize();
+
+    std::shared_ptr<HeightFieldCache::Entry> entry = mCache->acquire();
+    entry->heights.assign(rasterHeights, rasterHeights + (TILE_SIZE * TILE_SIZE));
+
+    HeightField heightfield(stt::chunk::row_heights(entry->heights.data(), TILE_SIZE), TILE_SIZE,
+        arena.levels(TILE_SIZE * TILE_SIZE));
+    heightfield.applyGeometricError(geometricErrorForZoom(coord.zoom, TILE_SIZE));
+    heightfield.copyLevels(entry->levels);
+
+    mCache->put(coord, entry);
+
+    return entry;
+}
+
+/**
+* @details the heights are read with `reader` if set, or else with this tiler.
+*/
+void stt::MeshTiler::readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+    GDALDatasetReader *reader, float *heights) const
+{
+    const stt::i_tile TILE_SIZE = mGrid.tileSize();
+
+    if (reader) {
+        reader->readRasterHeights(dataset, coord, TILE_SIZE, TILE_SIZE, heights);
+    } else {
+        stt::GDALDatasetReader::readRasterHeights(*this, dataset, coord, TILE_SIZE, TILE_SIZE, heights);
+    }
+}
+
+void stt::MeshTiler::prepareSettingsOfTile(MeshTile *terrainTile, GDALDataset *dataset,
+    const TileCoordinate &coord, const float *rasterHeights, stt::i_tile tileSizeX,
+    stt::i_tile tileSizeY, TileArena &arena, GDALDatasetReader *reader,
+    const uint8_t *levels) const
+{
+    const stt::i_tile TILE_SIZE = tileSizeX;
+    double maximumGeometricError = geometricErrorForZoom(coord.zoom, TILE_SIZE);
 
     // convert the raster grid into an irregular mesh applying the
     // Chunked LOD strategy by 'Thatcher Ulrich'.
     // http://tulrich.com/geekstuff/chunklod.html
 
-    stt::chunk::heightfield heightfield(rasterHeights, TILE_SIZE);
-    heightfield.applyGeometricError(maximumGeometricError, coord.zoom <= 6);
+    HeightField heightfield(stt::chunk::row_heights(rasterHeights, TILE_SIZE), TILE_SIZE,
+        arena.levels(TILE_SIZE * TILE_SIZE));
+    if (levels) {
+        heightfield.setLevels(levels);
+    } else {
+        heightfield.applyGeometricError(maximumGeometricError, coord.zoom <= 6);
+    }
 
     // propagate the geometric error of neighbors to avoid gaps in borders.
     if (coord.zoom > 6) {
@@ -149,29 +256,30 @@ void stt::MeshTiler::prepareSettingsOfTile(MeshTile *terrainTile, GDALDataset *d
 
             stt::CRSBounds neighborBounds = mGrid.tileBounds(neighborCoord);
 
-            if (datasetBounds.overlaps(neighborBounds)) {
-                float *neighborHeights = stt::GDALDatasetReader::readRasterHeights(
-                    *this,
-                    dataset,
-                    neighborCoord,
-                    mGrid.tileSize(),
-                    mGrid.tileSize()
-                );
+            if (datasetBounds.overlaps(neighborBounds) && mCache) {
+                std::shared_ptr<const HeightFieldCache::Entry> neighbor = cachedHeightField(dataset, neighborCoord, reader, arena);
 
-                stt::chunk::heightfield neighborHeightfield(neighborHeights, TILE_SIZE);
-                neighborHeightfield.applyGeometricError(maximumGeometricError);
+                HeightField neighborHeightfield(stt::chunk::row_heights(neighbor->heights.data(), TILE_SIZE), TILE_SIZE,
+                    arena.levels(TILE_SIZE * TILE_SIZE));
+                neighborHeightfield.setLevels(neighbor->levels.data());
                 heightfield.applyBorderActivationState(neighborHeightfield, borderIndex);
+            } else if (datasetBounds.overlaps(neighborBounds)) {
+                float *neighborHeights = arena.heights(TILE_SIZE * TILE_SIZE);
+                readRasterHeights(dataset, neighborCoord, reader, neighborHeights);
 
-                CPLFree(neighborHeights);
+                HeightField neighborHeightfield(stt::chunk::row_heights(neighborHeights, TILE_SIZE), TILE_SIZE,
+                    arena.levels(TILE_SIZE * TILE_SIZE));
+                neighborHeightfield.applyGeometricError(maximumGeometricError);
+                heightfield.applyBorderActivationState(neighborHeightfield, borderIndex);
             }
         }
     }
 
     stt::CRSBounds mGridBounds = mGrid.tileBounds(coord);
     Mesh &tileMesh = terrainTile->getMesh();
-    WrapperMesh mesh(mGridBounds, tileMesh, tileSizeX, tileSizeY);
+    WrapperMesh mesh(mGridBounds, tileMesh, tileSizeX, tileSizeY, arena);
     heightfield.generateMesh(mesh, 0);
-    heightfield.clear();
+    mesh.emit_edges();
 
     // if we are not at the maximum zoom level we need to set child flags on
     // the tile where child tiles overlap the dataset bounds.
@@ -199,19 +307,15 @@ void stt::MeshTiler::prepareSettingsOfTile(MeshTile *terrainTile, GDALDataset *d
 
 MeshTile * stt::MeshTiler::createMesh(GDALDataset *dataset, const TileCoordinate &coord) const
 {
+    TileArena arena;
+
     // copy the raster data into an array
-    float *rasterHeights = stt::GDALDatasetReader::readRasterHeights(
-        *this,
-        dataset,
-        coord,
-        mGrid.tileSize(),
-        mGrid.tileSize()
-    );
+    float *rasterHeights = arena.heights(mGrid.tileSize() * mGrid.tileSize());
+    readRasterHeights(dataset, coord, NULL, rasterHeights);
 
     // get a mesh tile represented by the tile coordinate
     MeshTile *terrainTile = new MeshTile(coord);
-    prepareSettingsOfTile(terrainTile, dataset, coord, rasterHeights, mGrid.tileSize(), mGrid.tileSize());
-    CPLFree(rasterHeights);
+    prepareSettingsOfTile(terrainTile, dataset, coord, rasterHeights, mGrid.tileSize(), mGrid.tileSize(), arena);
 
     return terrainTile;
 
@@ -222,18 +326,87 @@ MeshTile * stt::MeshTiler::createMesh(
     const TileCoordinate &coord,
     stt::GDALDatasetReader *reader) const
 {
+    TileArena arena;
+    MeshTile *terrainTile = new MeshTile(coord);
+
+    try {
+        fillMesh(terrainTile, dataset, coord, reader, arena);
+    } catch (...) {
+        delete terrainTile;
+        throw;
+    }
+
+    return terrainTile;
+}
+
+/**
+* @details the arena is reset first, so the mesh tile of the previous call
+* with the arena is reused and must no longer be needed.
+*/
+MeshTile * stt::MeshTiler::createMesh(
+    GDALDataset *dataset,
+    const TileCoordinate &coord,
+    stt::GDALDatasetReader *reader,
+    TileArena &arena) const
+{
+    arena.reset();
+
+    MeshTile &terrainTile = arena.tile(coord);
+    fillMesh(&terrainTile, dataset, coord, reader, arena);
+
+    return &terrainTile;
+}
+
+void stt::MeshTiler::fillMesh(
+    MeshTile *terrainTile,
+    GDALDataset *dataset,
+    const TileCoordinate &coord,
+    stt::GDALDatasetReader *reader,
+    TileArena &arena) const
+{
+    // the tile may already have been read as the neighbour of another
+    if (mCache && coord.zoom > 6) {
+        std::shared_ptr<const HeightFieldCache::Entry> entry = cachedHeightField(dataset, coord, reader, arena);
+
+        prepareSettingsOfTile(terrainTile, dataset, coord, entry->heights.data(),
+            mGrid.tileSize(), mGrid.tileSize(), arena, reader, entry->levels.data());
+        return;
+    }
+
     // copy the raster data into an array
-    float *rasterHeights = reader->readRasterHeights(
-        dataset,
-        coord,
-        mGrid.tileSize(),
-        mGrid.tileSize()
-    );
+    float *rasterHeights = arena.heights(mGrid.tileSize() * mGrid.tileSize());
+    readRasterHeights(dataset, coord, reader, rasterHeights);
 
-    // get a mesh tile represented by the tile coordinate
+    prepareSettingsOfTile(terrainTile, dataset, coord, rasterHeights, mGrid.tileSize(), mGrid.tileSize(), arena, reader);
+}
+
+/**
+* @details the heights must have been read for the tile coordinate with the
+* tile size of the grid. the dataset and reader are still used to read the
+* neighbours of the tile.
+*/
+MeshTile * stt::MeshTiler::createMesh(
+    GDALDataset *dataset,
+    const TileCoordinate &coord,
+    const float *rasterHeights,
+    stt::GDALDatasetReader *reader) const
+{
+    TileArena arena;
     MeshTile *terrainTile = new MeshTile(coord);
-    prepareSettingsOfTile(terrainTile, dataset, coord, rasterHeights, mGrid.tileSize(), mGrid.tileSize());
-    CPLFree(rasterHeights);
+
+    if (mCache && coord.zoom > 6) {
+        // the levels may already have been computed for a neighbour
+        std::shared_ptr<const HeightFieldCache::Entry> entry = mCache->get(coord);
+        if (!entry) {
+            entry = cacheHeightField(coord, rasterHeights, arena);
+        }
+
+        prepareSettingsOfTile(terrainTile, dataset, coord, entry->heights.data(),
+            mGrid.tileSize(), mGrid.tileSize(), arena, reader, entry->levels.data());
+    } else {
+        prepareSettingsOfTile(terrainTile, dataset, coord, rasterHeights,
+            mGrid.tileSize(), mGrid.tileSize(), arena, reader);
+    }
 
     return terrainTile;
 }
@@ -241,6 +414,7 @@ MeshTile * stt::MeshTiler::createMesh(
 MeshTiler & stt::MeshTiler::operator=(const MeshTiler &other)
 {
     TerrainTiler::operator=(other);
+    mCache = other.mCache;
 
     return *this;
 }
@@ -6,8 +6,12 @@
  * @brief this declares the `MeshTiler` class
  */
 
+#include <memory>
+
 #include "MeshTile.h"
 #include "TerrainTiler.h"
+#include "HeightFieldCache.h"
+#include "TileArena.h"
 
 namespace stt {
     class MeshTiler;
@@ -18,6 +22,15 @@ namespace stt {
  *
  * this class derives from `GDALTiler` and `TerrainTiler` enabling `MeshTile`s
  * to be created for a specific `TileCoordinate`.
+ *
+ * tiles above zoom level 6 are stitched to their neighbours, which means
+ * reading and chunking the neighbours as well. a `HeightFieldCache` can be
+ * assigned with `MeshTiler::setHeightFieldCache` so that the heightfield of
+ * each tile is computed once and reused for its neighbours.
+ *
+ * the heights, activation levels and vertex indices needed for a tile are
+ * scratch buffers of a `TileArena`. a worker creating every tile with its own
+ * arena reuses them along with the mesh tile itself, without allocating.
  */
 class STT_DLL stt::MeshTiler: public TerrainTiler
 {
@@ -25,19 +38,22 @@ public:
     /// instantiate a tiler with all required arguments
     MeshTiler(GDALDataset *poDataset, const Grid &grid, const TilerOptions &options, double meshQualityFactor = 1.0):
         TerrainTiler(poDataset, grid, options),
-        mMeshQualityFactor(meshQualityFactor)
+        mMeshQualityFactor(meshQualityFactor),
+        mCache(NULL)
     {}
 
     /// instantiate a tiler with an empty GDAL dataset
     MeshTiler(double meshQualityFactor = 1.0):
         TerrainTiler(),
-        mMeshQualityFactor(meshQualityFactor)
+        mMeshQualityFactor(meshQualityFactor),
+        mCache(NULL)
     {}
 
     /// instantiate a tiler with a dataset and grid but no options
     MeshTiler(GDALDataset *poDataset, const Grid &grid, double meshQualityFactor = 1.0):
         TerrainTiler(poDataset, grid, TilerOptions()),
-        mMeshQualityFactor(meshQualityFactor)
+        mMeshQualityFactor(meshQualityFactor),
+        mCache(NULL)
     {}
 
     /// overload the assignment operator
@@ -52,10 +68,34 @@ public:
     MeshTile *
     createMesh(GDALDataset *dataset, const TileCoordinate &coord, GDALDatasetReader *reader) const;
 
+    /// create a mesh from a tile coordinate in an arena, which owns the mesh
+    /// tile returned until it is next used
+    MeshTile *
+    createMesh(GDALDataset *dataset, const TileCoordinate &coord, GDALDatasetReader *reader, TileArena &arena) const;
+
+    /// create a mesh from heights already read for a tile coordinate
+    MeshTile *
+    createMesh(GDALDataset *dataset, const TileCoordinate &coord, const float *rasterHeights, GDALDatasetReader *reader) const;
+
+    /// share heightfields between tiles through a cache (`NULL` disables it)
+    inline void
+    setHeightFieldCache(HeightFieldCache *cache) {
+        mCache = cache;
+    }
+
+    /// get the heightfield cache, if any
+    inline HeightFieldCache *
+    heightFieldCache() const {
+        return mCache;
+    }
+
 protected:
     // specifies the factor of the quality to convert terrain heightmaps to meshes.
     double mMeshQualityFactor;
 
+    // the cache of heightfields shared between neighbouring tiles, not owned.
+    HeightFieldCache *mCache;
+
     // determines an appropriate geometric error estimate when the goemetry comes from a heightmap.
     static double getEstimatedLevelZeroGeometricErrorForAHeightmap(
         double maximumRadius,
@@ -64,14 +104,55 @@ protected:
         int numberOfTilesAtLevelZero
     );
 
-    /// assigns settings of Tile just to use.
+    /// determines the maximum geometric error of a mesh tile at a zoom level.
+    double geometricErrorForZoom(i_zoom zoom, stt::i_tile tileSize) const;
+
+    /// read the heights of a tile into a buffer of the tile size of the grid
+    void readRasterHeights(
+        GDALDataset *dataset,
+        const TileCoordinate &coord,
+        GDALDatasetReader *reader,
+        float *heights
+    ) const;
+
+    /// get the heights and activation levels of a tile from the cache, reading
+    /// and caching them if necessary.
+    std::shared_ptr<const HeightFieldCache::Entry> cachedHeightField(
+        GDALDataset *dataset,
+        const TileCoordinate &coord,
+        GDALDatasetReader *reader,
+        TileArena &arena
+    ) const;
+
+    /// compute the activation levels of heights read for a tile and cache them.
+    std::shared_ptr<const HeightFieldCache::Entry> cacheHeightField(
+        const TileCoordinate &coord,
+        const float *rasterHeights,
+        TileArena &arena
+    ) const;
+
+    /// read the heights of a tile with `reader` and fill its mesh
+    void fillMesh(
+        MeshTile *tile,
+        GDALDataset *dataset,
+        const TileCoordinate &coord,
+        GDALDatasetReader *reader,
+        TileArena &arena
+    ) const;
+
+    /// assigns settings of Tile just to use, reading neighbours with `reader`
+    /// if set and taking scratch buffers from `arena`. the activation levels
+    /// are computed unless `levels` is set.
     void prepareSettingsOfTile(
         MeshTile *tile,
         GDALDataset *dataset,
         const TileCoordinate &coord,
-        float *rasterHeights,
+        const float *rasterHeights,
         stt::i_tile tileSizeX,
-        stt::i_tile tileSizeY
+        stt::i_tile tileSizeY,
+        TileArena &arena,
+        GDALDatasetReader *reader = NULL,
+        const uint8_t *levels = NULL
     ) const;
 };
 
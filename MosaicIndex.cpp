@@ -0,0 +1,594 @@
+/**
+ * @file MosaicIndex.cpp
+ * @brief this defines the `MosaicIndex` class
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "STTException.h"
+#include "MosaicIndex.h"
+
+using namespace stt;
+
+namespace {
+    /// the extensions of the files listed from a directory
+    const char *rasterExtensions[] = {
+        "tif", "tiff", "img", "hgt", "bil", "bsq", "bip", "flt", "asc", "dem",
+        "dt0", "dt1", "dt2", NULL
+    };
+
+    /// identifies a cache file and the version of its layout
+    const char cacheMagic[8] = { 'S', 'T', 'T', 'M', 'O', 'S', 'A', 'I' };
+    const uint32_t cacheVersion = 1;
+
+    /// the most children of an R-tree node
+    const size_t nodeCapacity = 16;
+
+    /// the points transformed along each edge of a source footprint
+    const int edgePoints = 21;
+
+    /// whether a filename has one of the raster extensions
+    bool
+    isRasterFilename(const char *filename) {
+        const char *extension = CPLGetExtension(filename);
+
+        for (const char **known = rasterExtensions; *known != NULL; ++known) {
+            if (EQUAL(extension, *known))
+                return true;
+        }
+
+        return false;
+    }
+
+    /// get the size and modification time of a file
+    bool
+    statFile(const std::string &filename, int64_t &size, int64_t &mtime) {
+        VSIStatBufL stat;
+
+        if (VSIStatL(filename.c_str(), &stat) != 0)
+            return false;
+
+        size = stat.st_size;
+        mtime = stat.st_mtime;
+        return true;
+    }
+
+    template <typename T>
+    void
+    writeValue(VSILFILE *file, const T &value) {
+        if (VSIFWriteL(&value, sizeof(T), 1, file) != 1)
+            throw STTException("Could not write to the mosaic index cache");
+    }
+
+    void
+    writeString(VSILFILE *file, const std::string &value) {
+        writeValue<uint32_t>(file, value.size());
+
+        if (!value.empty() && VSIFWriteL(value.data(), 1, value.size(), file) != value.size())
+            throw STTException("Could not write to the mosaic index cache");
+    }
+
+    template <typename T>
+    bool
+    readValue(VSILFILE *file, T &value) {
+        return VSIFReadL(&value, sizeof(T), 1, file) == 1;
+    }
+
+    bool
+    readString(VSILFILE *file, std::string &value) {
+        uint32_t size;
+
+        if (!readValue(file, size) || size > (1 << 20))
+            return false;
+
+        value.resize(size);
+        return size == 0 || VSIFReadL(&value[0], 1, size, file) == size;
+    }
+
+    /// the center of a box along an axis
+    inline double
+    center(double min, double max) {
+        return (min + max) / 2;
+    }
+}
+
+/**
+ * @details the filenames are sorted when a directory is listed, so that the
+ * same directory gives the same list of sources. a list file is read in
+ * order, skipping blank lines and those starting with `#`. relative names in
+ * it are relative to the list file.
+ */
+std::vector<std::string>
+stt::MosaicIndex::listSources(const std::string &path)
+{
+    std::vector<std::string> filenames;
+    VSIStatBufL stat;
+
+    if (VSIStatL(path.c_str(), &stat) != 0) {
+        throw STTException("Could not find the mosaic sources");
+    }
+
+    if (VSI_ISDIR(stat.st_mode)) {
+        char **entries = VSIReadDirRecursive(path.c_str());
+
+        for (char **entry = entries; entry && *entry; ++entry) {
+            if (isRasterFilename(*entry)) {
+                filenames.push_back(CPLFormFilename(path.c_str(), *entry, NULL));
+            }
+        }
+
+        CSLDestroy(entries);
+        std::sort(filenames.begin(), filenames.end());
+    } else {
+        VSILFILE *file = VSIFOpenL(path.c_str(), "rb");
+        if (file == NULL) {
+            throw STTException("Could not open the mosaic source list");
+        }
+
+        const std::string directory = CPLGetPath(path.c_str());
+        const char *line;
+
+        while ((line = CPLReadLineL(file)) != NULL) {
+            std::string filename = line;
+            filename.erase(filename.find_last_not_of(" \t\r") + 1);
+            filename.erase(0, filename.find_first_not_of(" \t"));
+
+            if (filename.empty() || filename[0] == '#')
+                continue;
+
+            if (CPLIsFilenameRelative(filename.c_str())) {
+                filename = CPLFormFilename(directory.c_str(), filename.c_str(), NULL);
+            }
+            filenames.push_back(filename);
+        }
+
+        VSIFCloseL(file);
+    }
+
+    return filenames;
+}
+
+stt::MosaicIndex::MosaicIndex(const std::vector<std::string> &filenames,
+    const OGRSpatialReference &gridSRS, const std::string &cacheFilename):
+    mResolution(0),
+    mHasNoData(false),
+    mNoDataValue(0),
+    mCached(false)
+{
+    if (filenames.empty()) {
+        throw STTException("The mosaic has no sources");
+    }
+
+    char *gridWKT = NULL;
+    if (gridSRS.exportToWkt(&gridWKT) != OGRERR_NONE) {
+        CPLFree(gridWKT);
+        throw STTException("Could not create grid WKT string");
+    }
+    mGridWKT = gridWKT;
+    CPLFree(gridWKT);
+
+    mCached = !cacheFilename.empty() && load(cacheFilename, filenames);
+
+    if (!mCached) {
+        build(filenames);
+
+        if (!cacheFilename.empty()) {
+            save(cacheFilename);
+        }
+    }
+
+    // the union of the footprints and the finest resolution
+    double minX = std::numeric_limits<double>::max(), minY = minX;
+    double maxX = -minX, maxY = -minX;
+    mResolution = std::numeric_limits<double>::max();
+
+    for (size_t i = 0; i < mSources.size(); ++i) {
+        const Source &source = mSources[i];
+
+        minX = std::min(minX, source.bounds.getMinX());
+        minY = std::min(minY, source.bounds.getMinY());
+        maxX = std::max(maxX, source.bounds.getMaxX());
+        maxY = std::max(maxY, source.bounds.getMaxY());
+        mResolution = std::min(mResolution, source.resolution);
+    }
+
+    mBounds = CRSBounds(minX, minY, maxX, maxY);
+    buildTree();
+}
+
+/**
+ * @details the footprint of a source is the envelope of its outline
+ * transformed to the grid CRS, with points along each edge as well as the
+ * corners so that curved outlines are covered. the no data value of the
+ * mosaic is taken from the first source.
+ */
+void
+stt::MosaicIndex::build(const std::vector<std::string> &filenames)
+{
+    OGRSpatialReference gridSRS(mGridWKT.c_str());
+    #if ( GDAL_VERSION_MAJOR >= 3)
+    gridSRS.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+    #endif
+
+    mSources.clear();
+    mSources.reserve(filenames.size());
+
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        Source source;
+        source.filename = filenames[i];
+
+        if (!statFile(source.filename, source.size, source.mtime)) {
+            throw STTException((std::string("Could not find a mosaic source: ") + source.filename).c_str());
+        }
+
+        GDALDataset *dataset = GDALDataset::FromHandle(GDALOpen(source.filename.c_str(), GA_ReadOnly));
+        if (dataset == NULL) {
+            throw STTException((std::string("Could not open a mosaic source: ") + source.filename).c_str());
+        }
+
+        double adfGeoTransform[6];
+        const char *srcWKT = dataset->GetProjectionRef();
+        if (dataset->GetGeoTransform(adfGeoTransform) != CE_None || !strlen(srcWKT)) {
+            GDALClose(dataset);
+            throw STTException((std::string("A mosaic source is not georeferenced: ") + source.filename).c_str());
+        }
+
+        const double width = dataset->GetRasterXSize();
+        const double height = dataset->GetRasterYSize();
+
+        if (i == 0 && dataset->GetRasterCount() > 0) {
+            int bGotNoData = FALSE;
+            mNoDataValue = dataset->GetRasterBand(1)->GetNoDataValue(&bGotNoData);
+            mHasNoData = bGotNoData;
+        }
+
+        // points along the outline of the source in pixels
+        std::vector<double> x, y;
+        for (int p = 0; p < edgePoints; ++p) {
+            const double t = (double) p / (edgePoints - 1);
+            const double px[4] = { t * width, width, (1 - t) * width, 0 };
+            const double py[4] = { 0, t * height, height, (1 - t) * height };
+
+            for (int edge = 0; edge < 4; ++edge) {
+                x.push_back(adfGeoTransform[0] + px[edge] * adfGeoTransform[1] + py[edge] * adfGeoTransform[2]);
+                y.push_back(adfGeoTransform[3] + px[edge] * adfGeoTransform[4] + py[edge] * adfGeoTransform[5]);
+            }
+        }
+
+        OGRSpatialReference srcSRS(srcWKT);
+        #if ( GDAL_VERSION_MAJOR >= 3)
+        srcSRS.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+        #endif
+        GDALClose(dataset);
+
+        std::vector<int> success(x.size(), TRUE);
+        if (!srcSRS.IsSame(&gridSRS)) {
+            OGRCoordinateTransformation *transformer = OGRCreateCoordinateTransformation(&srcSRS, &gridSRS);
+            if (transformer == NULL) {
+                throw STTException("The mosaic source to tile grid coordinate transformation could not be created");
+            }
+
+            transformer->Transform(x.size(), x.data(), y.data(), NULL, success.data());
+            delete transformer;
+        }
+
+        double minX = std::numeric_limits<double>::max(), minY = minX;
+        double maxX = -minX, maxY = -minX;
+        for (size_t p = 0; p < x.size(); ++p) {
+            if (success[p]) {
+                minX = std::min(minX, x[p]);
+                minY = std::min(minY, y[p]);
+                maxX = std::max(maxX, x[p]);
+                maxY = std::max(maxY, y[p]);
+            }
+        }
+
+        if (minX > maxX || minY > maxY) {
+            throw STTException((std::string("Could not transform the footprint of a mosaic source: ") + source.filename).c_str());
+        }
+
+        source.bounds = CRSBounds(minX, minY, maxX, maxY);
+        source.resolution = source.bounds.getWidth() / width;
+        mSources.push_back(source);
+    }
+}
+
+/**
+ * @details the cache is only used if it was written for the same grid and
+ * the same list of sources, and no source has changed size or been modified
+ * since. otherwise `false` is returned and the sources should be indexed.
+ */
+bool
+stt::MosaicIndex::load(const std::string &cacheFilename,
+    const std::vector<std::string> &filenames)
+{
+    VSILFILE *file = VSIFOpenL(cacheFilename.c_str(), "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    char magic[sizeof(cacheMagic)];
+    uint32_t version;
+    std::string gridWKT;
+    uint64_t count;
+    uint8_t hasNoData;
+    double noDataValue;
+
+    bool valid = VSIFReadL(magic, 1, sizeof(magic), file) == sizeof(magic)
+        && memcmp(magic, cacheMagic, sizeof(magic)) == 0
+        && readValue(file, version) && version == cacheVersion
+        && readString(file, gridWKT) && gridWKT == mGridWKT
+        && readValue(file, count) && count == filenames.size()
+        && readValue(file, hasNoData)
+        && readValue(file, noDataValue);
+
+    std::vector<Source> sources;
+    for (uint64_t i = 0; valid && i < count; ++i) {
+        Source source;
+        double bounds[4];
+        int64_t size, mtime;
+
+        valid = readString(file, source.filename)
+            && source.filename == filenames[i]
+            && readValue(file, source.size)
+            && readValue(file, source.mtime)
+            && VSIFReadL(bounds, sizeof(double), 4, file) == 4
+            && readValue(file, source.resolution)
+            && statFile(source.filename, size, mtime)
+            && size == source.size && mtime == source.mtime
+            && bounds[0] <= bounds[2] && bounds[1] <= bounds[3];
+
+        if (valid) {
+            source.bounds = CRSBounds(bounds[0], bounds[1], bounds[2], bounds[3]);
+            sources.push_back(source);
+        }
+    }
+
+    VSIFCloseL(file);
+
+    if (valid) {
+        mSources.swap(sources);
+        mHasNoData = hasNoData;
+        mNoDataValue = noDataValue;
+    }
+
+    return valid;
+}
+
+void
+stt::MosaicIndex::save(const std::string &cacheFilename) const
+{
+    // write to a temporary file so that an interrupted run leaves no cache
+    const std::string tempFilename = cacheFilename + ".tmp";
+    VSILFILE *file = VSIFOpenL(tempFilename.c_str(), "wb");
+    if (file == NULL) {
+        throw STTException("Could not open the mosaic index cache");
+    }
+
+    try {
+        if (VSIFWriteL(cacheMagic, 1, sizeof(cacheMagic), file) != sizeof(cacheMagic))
+            throw STTException("Could not write to the mosaic index cache");
+
+        writeValue(file, cacheVersion);
+        writeString(file, mGridWKT);
+        writeValue<uint64_t>(file, mSources.size());
+        writeValue<uint8_t>(file, mHasNoData);
+        writeValue(file, mNoDataValue);
+
+        for (size_t i = 0; i < mSources.size(); ++i) {
+            const Source &source = mSources[i];
+            const double bounds[4] = {
+                source.bounds.getMinX(), source.bounds.getMinY(),
+                source.bounds.getMaxX(), source.bounds.getMaxY()
+            };
+
+            writeString(file, source.filename);
+            writeValue(file, source.size);
+            writeValue(file, source.mtime);
+            if (VSIFWriteL(bounds, sizeof(double), 4, file) != 4)
+                throw STTException("Could not write to the mosaic index cache");
+            writeValue(file, source.resolution);
+        }
+    } catch (const STTException &) {
+        VSIFCloseL(file);
+        VSIUnlink(tempFilename.c_str());
+        throw;
+    }
+
+    if (VSIFCloseL(file) != 0 || VSIRename(tempFilename.c_str(), cacheFilename.c_str()) != 0) {
+        VSIUnlink(tempFilename.c_str());
+        throw STTException("Could not write the mosaic index cache");
+    }
+}
+
+/**
+ * @details the tree is packed with the Sort-Tile-Recursive algorithm: the
+ * boxes of a level are sorted into vertical slices by the x of their centers,
+ * each slice is sorted by y and cut into runs of `nodeCapacity` boxes which
+ * become the nodes of the level above. each level is stored in that order so
+ * the children of a node are contiguous.
+ */
+void
+stt::MosaicIndex::buildTree()
+{
+    mNodes.clear();
+    mItems.clear();
+
+    // order boxes into runs of `nodeCapacity` close together
+    auto pack = [](const std::vector<Node> &boxes) {
+        std::vector<uint32_t> order(boxes.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+
+        const size_t runs = (boxes.size() + nodeCapacity - 1) / nodeCapacity;
+        const size_t sliceSize = nodeCapacity * (size_t) std::ceil(std::sqrt((double) runs));
+
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return center(boxes[a].minX, boxes[a].maxX) < center(boxes[b].minX, boxes[b].maxX);
+        });
+
+        for (size_t begin = 0; begin < order.size(); begin += sliceSize) {
+            const size_t end = std::min(begin + sliceSize, order.size());
+
+            std::sort(order.begin() + begin, order.begin() + end, [&](uint32_t a, uint32_t b) {
+                return center(boxes[a].minY, boxes[a].maxY) < center(boxes[b].minY, boxes[b].maxY);
+            });
+        }
+
+        return order;
+    };
+
+    // make a node covering a run of boxes
+    auto parent = [](const std::vector<Node> &boxes, size_t begin, size_t end,
+                     uint32_t first, bool leaf) {
+        Node node = { boxes[begin].minX, boxes[begin].minY, boxes[begin].maxX, boxes[begin].maxY,
+                      first, (uint32_t) (end - begin), leaf };
+
+        for (size_t i = begin + 1; i < end; ++i) {
+            node.minX = std::min(node.minX, boxes[i].minX);
+            node.minY = std::min(node.minY, boxes[i].minY);
+            node.maxX = std::max(node.maxX, boxes[i].maxX);
+            node.maxY = std::max(node.maxY, boxes[i].maxY);
+        }
+
+        return node;
+    };
+
+    std::vector<Node> level;
+    for (size_t i = 0; i < mSources.size(); ++i) {
+        const CRSBounds &bounds = mSources[i].bounds;
+        Node box = { bounds.getMinX(), bounds.getMinY(), bounds.getMaxX(), bounds.getMaxY(),
+                     (uint32_t) i, 0, true };
+        level.push_back(box);
+    }
+
+    if (level.empty()) {
+        return;
+    }
+
+    // the leaves refer to runs of sources
+    std::vector<uint32_t> order = pack(level);
+    std::vector<Node> sorted;
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted.push_back(level[order[i]]);
+        mItems.push_back(order[i]);
+    }
+
+    level.clear();
+    for (size_t begin = 0; begin < sorted.size(); begin += nodeCapacity) {
+        const size_t end = std::min(begin + nodeCapacity, sorted.size());
+        level.push_back(parent(sorted, begin, end, begin, true));
+    }
+
+    // the levels above refer to runs of nodes stored in the level below
+    while (level.size() > 1) {
+        order = pack(level);
+        sorted.clear();
+        const uint32_t base = mNodes.size();
+
+        for (size_t i = 0; i < order.size(); ++i) {
+            sorted.push_back(level[order[i]]);
+            mNodes.push_back(level[order[i]]);
+        }
+
+        level.clear();
+        for (size_t begin = 0; begin < sorted.size(); begin += nodeCapacity) {
+            const size_t end = std::min(begin + nodeCapacity, sorted.size());
+            level.push_back(parent(sorted, begin, end, base + begin, false));
+        }
+    }
+
+    mNodes.push_back(level[0]);
+}
+
+/**
+ * @details the sources are found in no particular order. footprints that
+ * only touch the bounds are not found.
+ */
+void
+stt::MosaicIndex::query(const CRSBounds &bounds, std::vector<size_t> &found) const
+{
+    found.clear();
+
+    if (mNodes.empty()) {
+        return;
+    }
+
+    auto overlaps = [&](const Node &node) {
+        return node.minX < bounds.getMaxX() && bounds.getMinX() < node.maxX &&
+            node.minY < bounds.getMaxY() && bounds.getMinY() < node.maxY;
+    };
+
+    std::vector<uint32_t> stack(1, mNodes.size() - 1);
+
+    while (!stack.empty()) {
+        const Node &node = mNodes[stack.back()];
+        stack.pop_back();
+
+        if (!overlaps(node))
+            continue;
+
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            if (!node.leaf) {
+                stack.push_back(i);
+            } else if (mSources[mItems[i]].bounds.overlaps(bounds)) {
+                found.push_back(mItems[i]);
+            }
+        }
+    }
+}
+
+/**
+ * @details the dataset has a single band with no sources, so every pixel is
+ * `0` or no data. it covers the footprints of the mosaic in the grid CRS at
+ * the finest source resolution, which is all a tiler needs from it to work
+ * out the tiles and zoom levels; the heights themselves are read from the
+ * sources with a `GDALDatasetReaderWithMosaic`.
+ */
+void
+stt::MosaicIndex::writeDataset(const std::string &filename) const
+{
+    const double width = std::ceil(mBounds.getWidth() / mResolution);
+    const double height = std::ceil(mBounds.getHeight() / mResolution);
+
+    if (width < 1 || height < 1 || width > INT_MAX || height > INT_MAX) {
+        throw STTException("The mosaic is too large to be represented by a dataset");
+    }
+
+    GDALDriverH hDriver = GDALGetDriverByName("VRT");
+    if (hDriver == NULL) {
+        throw STTException("Could not get the VRT driver");
+    }
+
+    GDALDatasetH hDS = GDALCreate(hDriver, filename.c_str(), (int) width, (int) height, 1, GDT_Float32, NULL);
+    if (hDS == NULL) {
+        throw STTException("Could not create the mosaic dataset");
+    }
+
+    double adfGeoTransform[6] = {
+        mBounds.getMinX(), mResolution, 0,
+        mBounds.getMaxY(), 0, -mResolution
+    };
+
+    bool ok = GDALSetGeoTransform(hDS, adfGeoTransform) == CE_None
+        && GDALSetProjection(hDS, mGridWKT.c_str()) == CE_None;
+
+    if (ok && mHasNoData) {
+        ok = GDALSetRasterNoDataValue(GDALGetRasterBand(hDS, 1), mNoDataValue) == CE_None;
+    }
+
+    GDALClose(hDS);
+
+    if (!ok) {
+        throw STTException("Could not georeference the mosaic dataset");
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef MOSAICINDEX_H_
+#define MOSAICINDEX_H_
+
+/**
+ * @file MosaicIndex.h
+ * @brief this declares the `MosaicIndex` class
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gdal_priv.h"
+#include "ogr_spatialref.h"
+
+#include "config.h"
+#include "types.h"
+
+namespace stt {
+    class MosaicIndex;
+}
+
+/**
+ * @brief a spatial index of the rasters making up a mosaic
+ *
+ * a mosaic is made up of many source rasters, e.g. the tens of thousands of
+ * GeoTIFFs of a national elevation model. rather than warping every tile
+ * through a VRT listing all sources, the footprint of each source in the
+ * grid CRS is put in an R-tree so that a tile is warped only from the
+ * sources it intersects:
+ *
+ * \code
+ *   MosaicIndex index(MosaicIndex::listSources(directory), grid.getSRS(), cacheFilename);
+ *   index.query(tileBounds, sources);
+ * \endcode
+ *
+ * reading the footprint of every source means opening it, so the footprints
+ * are cached in a file. the cache is used as long as it lists the same
+ * sources with the same sizes and modification times, otherwise it is
+ * rebuilt. the R-tree itself is bulk loaded from the footprints each time,
+ * which takes milliseconds.
+ */
+class STT_DLL stt::MosaicIndex
+{
+public:
+    /// a source raster of the mosaic
+    struct Source {
+        std::string filename;   /// the name of the raster
+        int64_t size;           /// the size of the file when indexed
+        int64_t mtime;          /// the modification time of the file when indexed
+        CRSBounds bounds;       /// the footprint in the grid CRS
+        double resolution;      /// the width of a pixel in the grid CRS
+    };
+
+    /// index sources in a grid CRS, using and updating a cache file if named
+    MosaicIndex(const std::vector<std::string> &filenames,
+        const OGRSpatialReference &gridSRS, const std::string &cacheFilename = "");
+
+    /// list the rasters in a directory, or named one per line in a file
+    static std::vector<std::string>
+    listSources(const std::string &path);
+
+    /// get the sources of the mosaic
+    inline const std::vector<Source> &
+    sources() const {
+        return mSources;
+    }
+
+    /// get the bounds of the whole mosaic in the grid CRS
+    inline const CRSBounds &
+    bounds() const {
+        return mBounds;
+    }
+
+    /// get the finest source resolution in the grid CRS
+    inline double
+    resolution() const {
+        return mResolution;
+    }
+
+    /// get whether the footprints were read from the cache file
+    inline bool
+    isCached() const {
+        return mCached;
+    }
+
+    /// find the sources whose footprints intersect some bounds
+    void
+    query(const CRSBounds &bounds, std::vector<size_t> &found) const;
+
+    /// write a VRT without sources covering the mosaic, for use by a tiler
+    void
+    writeDataset(const std::string &filename) const;
+
+protected:
+    /// a node of the R-tree, whose children are contiguous
+    struct Node {
+        double minX, minY, maxX, maxY;
+        uint32_t first;     /// the first child node, or source of a leaf
+        uint32_t count;     /// the number of children
+        bool leaf;          /// whether the children are sources
+    };
+
+    /// read the footprints from a cache file if it is up to date
+    bool
+    load(const std::string &cacheFilename, const std::vector<std::string> &filenames);
+
+    /// write the footprints to a cache file
+    void
+    save(const std::string &cacheFilename) const;
+
+    /// open every source to find its footprint
+    void
+    build(const std::vector<std::string> &filenames);
+
+    /// bulk load the R-tree from the footprints
+    void
+    buildTree();
+
+    /// the grid CRS in well known text format
+    std::string mGridWKT;
+
+    /// the sources and their footprints
+    std::vector<Source> mSources;
+
+    /// the nodes of the R-tree, with the root last
+    std::vector<Node> mNodes;
+
+    /// the sources in the order the leaves refer to them
+    std::vector<uint32_t> mItems;
+
+    /// the union of the footprints
+    CRSBounds mBounds;
+
+    /// the finest resolution of the sources
+    double mResolution;
+
+    /// the no data value of the sources, if any
+    bool mHasNoData;
+    double mNoDataValue;
+
+    /// whether the footprints came from the cache
+    bool mCached;
+};
+
+#endif /* MOSAICINDEX_H_ */
@@ -0,0 +1,267 @@
+/**
+ * @file STTArchiveSerializer.cpp
+ * @brief this defines the `STTArchiveSerializer` class
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "concat.h"
+#include "STTException.h"
+#include "STTArchiveSerializer.h"
+#include "STTMemoryOutputStream.h"
+
+using namespace stt;
+
+stt::STTArchiveSerializer::STTArchiveSerializer(const std::string &filename, bool resume,
+    const TileCodec *codec):
+    mfilename(filename),
+    mresume(resume),
+    mcodec(codec ? *codec : TileCodec::gzip()),
+    mfile(NULL),
+    mend(0)
+{}
+
+stt::STTArchiveSerializer::~STTArchiveSerializer()
+{
+    if (mfile) {
+        VSIFCloseL(mfile);
+    }
+}
+
+void
+stt::STTArchiveSerializer::writeHeader(uint64_t directoryOffset)
+{
+    TileArchive::Header header;
+    memset(&header, 0, sizeof(header));
+
+    memcpy(header.magic, TileArchive::magic, sizeof(header.magic));
+    header.version = TileArchive::version;
+    header.directoryOffset = directoryOffset;
+    header.tileCount = directoryOffset ? mentries.size() : 0;
+    strncpy(header.format, "terrain", sizeof(header.format));
+    if (mcodec.contentEncoding()) {
+        strncpy(header.encoding, mcodec.contentEncoding(), sizeof(header.encoding));
+    }
+
+    if (VSIFSeekL(mfile, 0, SEEK_SET) != 0
+            || VSIFWriteL(&header, sizeof(header), 1, mfile) != 1) {
+        throw STTException("Could not write to the tile archive");
+    }
+}
+
+/**
+* @details a finished archive lists its tiles in its directory. otherwise the
+* records of the data section are read up to the first one which is not
+* complete, which is where an interrupted run stopped writing.
+*/
+vsi_l_offset
+stt::STTArchiveSerializer::readTiles()
+{
+    TileArchive::Header header;
+    VSIStatBufL stat;
+
+    if (VSIStatL(mfilename.c_str(), &stat) != 0
+            || VSIFReadL(&header, sizeof(header), 1, mfile) != 1
+            || memcmp(header.magic, TileArchive::magic, sizeof(header.magic)) != 0
+            || header.version != TileArchive::version) {
+        throw STTException(concat("Not a tile archive: ", mfilename).c_str());
+    }
+
+    const char *encoding = mcodec.contentEncoding() ? mcodec.contentEncoding() : "";
+    if (strncmp(header.encoding, encoding, sizeof(header.encoding)) != 0) {
+        throw STTException("The tile archive was written with a different compression");
+    }
+
+    const vsi_l_offset length = stat.st_size;
+    vsi_l_offset end = sizeof(header);
+
+    if (header.directoryOffset != 0) {
+        mentries.resize(header.tileCount);
+
+        if (VSIFSeekL(mfile, header.directoryOffset, SEEK_SET) != 0
+                || VSIFReadL(mentries.data(), sizeof(TileArchive::Entry), mentries.size(), mfile) != mentries.size()) {
+            throw STTException("Could not read the tile archive directory");
+        }
+
+        // the directory and the padding before it are overwritten
+        for (size_t i = 0; i < mentries.size(); ++i) {
+            end = std::max<vsi_l_offset>(end, mentries[i].offset + mentries[i].size);
+        }
+    } else {
+        uint64_t key;
+        uint32_t size;
+
+        while (VSIFSeekL(mfile, end, SEEK_SET) == 0
+                && VSIFReadL(&key, sizeof(key), 1, mfile) == 1
+                && VSIFReadL(&size, sizeof(size), 1, mfile) == 1
+                && end + TileArchive::recordHeaderSize + size <= length) {
+            TileArchive::Entry entry = { key, end + TileArchive::recordHeaderSize, size, 0 };
+            mentries.push_back(entry);
+            end = entry.offset + size;
+        }
+    }
+
+    for (size_t i = 0; i < mentries.size(); ++i) {
+        mstored.insert(mentries[i].key);
+    }
+
+    return end;
+}
+
+/**
+* @details the header is rewritten as unfinished until the directory has been
+* written, so that a run which stops before then can be resumed.
+*/
+void
+stt::STTArchiveSerializer::startSerialization()
+{
+    VSIStatBufL stat;
+
+    if (mresume && VSIStatL(mfilename.c_str(), &stat) == 0) {
+        mfile = VSIFOpenL(mfilename.c_str(), "r+b");
+        if (mfile == NULL) {
+            throw STTException(concat("Could not open the tile archive ", mfilename).c_str());
+        }
+
+        mend = readTiles();
+
+        if (VSIFTruncateL(mfile, mend) != 0) {
+            throw STTException("Could not truncate the tile archive");
+        }
+    } else {
+        mfile = VSIFOpenL(mfilename.c_str(), "w+b");
+        if (mfile == NULL) {
+            throw STTException(concat("Could not create the tile archive ", mfilename).c_str());
+        }
+
+        mend = sizeof(TileArchive::Header);
+    }
+
+    writeHeader(0);
+
+    if (VSIFSeekL(mfile, mend, SEEK_SET) != 0) {
+        throw STTException("Could not write to the tile archive");
+    }
+}
+
+/**
+* @details
+* returns if the specified TileCoordinate should be serialized
+*/
+bool
+stt::STTArchiveSerializer::mustSerializeCoordinate(const stt::TileCoordinate *coordinate)
+{
+    return !mresume || mstored.find(TileArchive::key(*coordinate)) == mstored.end();
+}
+
+/**
+* @details
+* serialize a TerrainTile to the archive, compressed by the codec
+*/
+bool
+stt::STTArchiveSerializer::serializeTile(const stt::TerrainTile *tile)
+{
+    thread_local STTMemoryOutputStream ostream;
+    thread_local std::vector<unsigned char> compressed;
+
+    ostream.clear();
+    tile->writeFile(ostream);
+    mcodec.encode(ostream.buffer().data(), ostream.buffer().size(), compressed);
+
+    return serializeTileData(tile, compressed.data(), compressed.size());
+}
+
+/**
+* @details
+* serialize a MeshTile to the archive, compressed by the codec
+*/
+bool
+stt::STTArchiveSerializer::serializeTile(const stt::MeshTile *tile, bool writeVertexNormals)
+{
+    thread_local STTMemoryOutputStream ostream;
+    thread_local std::vector<unsigned char> compressed;
+
+    ostream.clear();
+    tile->writeFile(ostream, writeVertexNormals);
+    mcodec.encode(ostream.buffer().data(), ostream.buffer().size(), compressed);
+
+    return serializeTileData(tile, compressed.data(), compressed.size());
+}
+
+/**
+* @details the tile is appended as a record of its key, its size and its bytes
+* through the buffered archive file.
+*/
+bool
+stt::STTArchiveSerializer::serializeTileData(const stt::TileCoordinate *coordinate,
+    const unsigned char *data, size_t size)
+{
+    const uint64_t key = TileArchive::key(*coordinate);
+    const uint32_t size32 = size;
+
+    std::lock_guard<std::mutex> lock(mmutex);
+
+    if (VSIFWriteL(&key, sizeof(key), 1, mfile) != 1
+            || VSIFWriteL(&size32, sizeof(size32), 1, mfile) != 1
+            || VSIFWriteL(data, 1, size, mfile) != size) {
+        throw STTException("Could not write to the tile archive");
+    }
+
+    TileArchive::Entry entry = { key, mend + TileArchive::recordHeaderSize, size32, 0 };
+    mentries.push_back(entry);
+    mend = entry.offset + size;
+
+    return true;
+}
+
+/**
+* @details the records are written whole under the lock, so the data section
+* ends with a complete record once the buffer is flushed.
+*/
+void
+stt::STTArchiveSerializer::flush()
+{
+    std::lock_guard<std::mutex> lock(mmutex);
+
+    if (VSIFFlushL(mfile) != 0) {
+        throw STTException("Could not write to the tile archive");
+    }
+}
+
+/**
+* @details the entries are sorted by key. a tile stored more than once is
+* found at its last copy. the directory is flushed before the header points at
+* it, so the archive is either finished or can still be resumed.
+*/
+void
+stt::STTArchiveSerializer::endSerialization()
+{
+    std::stable_sort(mentries.begin(), mentries.end(),
+        [](const TileArchive::Entry &a, const TileArchive::Entry &b) { return a.key < b.key; });
+
+    size_t count = 0;
+    for (size_t i = 0; i < mentries.size(); ++i) {
+        if (i + 1 < mentries.size() && mentries[i + 1].key == mentries[i].key)
+            continue;
+        mentries[count++] = mentries[i];
+    }
+    mentries.resize(count);
+
+    const uint64_t directoryOffset = (mend + 7) & ~(uint64_t) 7;
+    const char padding[8] = {};
+
+    if (VSIFWriteL(padding, 1, directoryOffset - mend, mfile) != directoryOffset - mend
+            || VSIFWriteL(mentries.data(), sizeof(TileArchive::Entry), mentries.size(), mfile) != mentries.size()
+            || VSIFFlushL(mfile) != 0) {
+        throw STTException("Could not write the tile archive directory");
+    }
+
+    writeHeader(directoryOffset);
+
+    VSILFILE *file = mfile;
+    mfile = NULL;
+    if (VSIFCloseL(file) != 0) {
+        throw STTException("Could not close the tile archive");
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef STTARCHIVESERIALIZER_H_
+#define STTARCHIVESERIALIZER_H_
+
+/**
+ * @file STTArchiveSerializer.h
+ * @brief this declares the `STTArchiveSerializer` class
+ */
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "cpl_vsi.h"
+
+#include "TileCoordinate.h"
+#include "TerrainSerializer.h"
+#include "MeshSerializer.h"
+#include "TileArchive.h"
+#include "TileCodec.h"
+
+namespace stt {
+    class STTArchiveSerializer;
+}
+
+/**
+ * @brief implements a serializer storing tiles in a single file archive
+ *
+ * the tiles are appended to the data section of a `TileArchive` as they are
+ * stored, which is in the order they are created. the sorted directory is
+ * written by `endSerialization`, after which the archive can be read.
+ *
+ * when resuming, the tiles of an existing archive are kept and new tiles are
+ * appended after them. this also works for an archive that was never
+ * finished, whose tiles are found from the records of its data section.
+ */
+class STT_DLL stt::STTArchiveSerializer :
+    public stt::TerrainSerializer,
+    public stt::MeshSerializer
+{
+public:
+    /// create a serializer for an archive, compressing the tiles with a codec
+    /// which defaults to gzip
+    STTArchiveSerializer(const std::string &filename, bool resume,
+        const TileCodec *codec = NULL);
+
+    /// the destructor closes an unfinished archive, which can be resumed
+    ~STTArchiveSerializer();
+
+    /// open the archive, reading the tiles already stored when resuming
+    virtual void startSerialization();
+
+    /// returns if the specified Tile Coordinate should be serialized
+    virtual bool mustSerializeCoordinate(const stt::TileCoordinate *coordinate);
+
+    /// serialize a TerrainTile to the archive
+    virtual bool serializeTile(const stt::TerrainTile *tile);
+
+    /// serialize a MeshTile to the archive
+    virtual bool serializeTile(
+        const stt::MeshTile *tile,
+        bool writeVertexNormals = false
+    );
+
+    /// append the encoded and compressed data of a MeshTile to the archive
+    virtual bool serializeTileData(
+        const stt::TileCoordinate *coordinate,
+        const unsigned char *data,
+        size_t size
+    );
+
+    /// write the tiles appended so far to the archive file
+    virtual void flush();
+
+    /// write the directory and close the archive
+    virtual void endSerialization();
+
+protected:
+    /// read the tiles of an existing archive, returning the end of their data
+    vsi_l_offset
+    readTiles();
+
+    /// write the header, pointing at a directory if the archive is finished
+    void
+    writeHeader(uint64_t directoryOffset);
+
+    /// the path of the archive
+    std::string mfilename;
+    /// keep the tiles of an existing archive
+    bool mresume;
+    /// the codec compressing the tiles
+    const TileCodec &mcodec;
+
+    /// the open archive and the end of its data section
+    VSILFILE *mfile;
+    vsi_l_offset mend;
+
+    /// the tiles stored so far, in the order they were stored
+    std::vector<TileArchive::Entry> mentries;
+    /// the keys of the tiles stored before resuming
+    std::unordered_set<uint64_t> mstored;
+
+    std::mutex mmutex;
+};
+
+#endif /* STTARCHIVESERIALIZER_H_ */
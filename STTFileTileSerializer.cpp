@@ -3,9 +3,12 @@
 * @brief this defines the `STTFileTileSerializer` class
 */
 
+#include <algorithm>
+#include <climits>
 #include <cstdio>
 #include <string>
 #include <mutex>
+#include <unordered_set>
 
 #include "concat.h"
 #include "cpl_vsi.h"
@@ -14,14 +17,14 @@
 
 #include "GDALDatasetReader.h"
 #include "STTFileOutputStream.h"
-#include "STTZOutputStream.h"
+#include "STTMemoryOutputStream.h"
 
 static const char *osDirSep = "/";
 
 
-/// create a filename for a tile coordinate
-std::string
-stt::STTFileTileSerializer::getTileFilename(const TileCoordinate *coord, const std::string dirname, const char *extension)
+/// create the `{zoom}/{x}` directory of a tile unless it exists
+static void
+createTileDirectory(const stt::TileCoordinate *coord, const std::string &dirname)
 {
     static std::mutex mutex;
     VSIStatBufL stat;
@@ -37,23 +40,47 @@ stt::STTFileTileSerializer::getTileFilename(const TileCoordinate *coord, const s
         if (VSIStatExL(filename.c_str(), &stat, VSI_STAT_EXISTS_FLAG | VSI_STAT_NATURE_FLAG)) {
             // create the `{zoom}` directory
             if (VSIMkdir(filename.c_str(), 0755))
-                throw STTException("Could not create the zoom level directory");
+                throw stt::STTException("Could not create the zoom level directory");
 
         } else if (!VSI_ISDIR(stat.st_mode)) {
-            throw STTException("Zoom level file path is not a directory");
+            throw stt::STTException("Zoom level file path is not a directory");
         }
 
         // create the `{zoom}/{x}` directory
         filename += concat(osDirSep, coord->x);
         if (VSIMkdir(filename.c_str(), 0755))
-            throw STTException("Could not create the x level directory");
+            throw stt::STTException("Could not create the x level directory");
 
     } else if (!VSI_ISDIR(stat.st_mode)) {
-        throw STTException("X level file path is not a directory");
+        throw stt::STTException("X level file path is not a directory");
+    }
+}
+
+/**
+* @details every thread remembers the `{zoom}/{x}` directories it has already
+* found or created, so once a thread has stored a tile in a directory the
+* names of the other tiles in it are built without taking a lock or calling
+* into the file system. a run only creates a few thousand of these
+* directories.
+*/
+std::string
+stt::STTFileTileSerializer::getTileFilename(const TileCoordinate *coord, const std::string dirname, const char *extension)
+{
+    thread_local std::unordered_set<std::string> directories;
+
+    std::string filename = dirname;
+    filename += std::to_string(coord->zoom);
+    filename += osDirSep;
+    filename += std::to_string(coord->x);
+
+    if (directories.find(filename) == directories.end()) {
+        createTileDirectory(coord, dirname);
+        directories.insert(filename);
     }
 
     // create the filename itself, adding the extension if required
-    filename += concat(osDirSep, coord->y);
+    filename += osDirSep;
+    filename += std::to_string(coord->y);
     if (extension != NULL) {
         filename += ".";
         filename += extension;
@@ -78,7 +105,7 @@ bool stt::STTFileTileSerializer::mustSerializeCoordinate(const stt::TileCoordina
     if (!mresume)
         return true;
 
-    const std::string filename = getTileFilename(coordinate, moutputDir, "terrian");
+    const std::string filename = getTileFilename(coordinate, moutputDir, mextension.c_str());
 
     return !fileExists(filename);
 }
@@ -113,45 +140,262 @@ stt::STTFileTileSerializer::serializeTile(const stt::GDALTile *tile, GDALDriver
 
 /**
  * @details
- * serialize a TerrainTile to the directory store
+ * serialize a TerrainTile to the directory store, compressed by the codec
  */
 bool
 stt::STTFileTileSerializer::serializeTile(const stt::TerrainTile *tile)
 {
-    const TileCoordinate *coordinate = tile;
-    const std::string filename = getTileFilename(coordinate, moutputDir, "terrain");
-    const std::string temp_filename = concat(filename, ".tmp");
+    thread_local STTMemoryOutputStream ostream;
 
-    STTZFileOutputStream ostream(temp_filename.c_str());
+    ostream.clear();
     tile->writeFile(ostream);
-    ostream.close();
 
-    if (VSIRename(temp_filename.c_str(), filename.c_str()) != 0) {
-        throw STTException("Could not rename temporary file");
-    }
+    std::vector<unsigned char> compressed;
+    mcodec.encode(ostream.buffer().data(), ostream.buffer().size(), compressed);
 
-    return true;
+    return storeTileData(*tile, std::move(compressed));
 }
 
 
 /**
 * @details
-* serializer a MeshTile to the directory store
+* serializer a MeshTile to the directory store. the tile is encoded into a
+* buffer in memory, compressed by the codec with a single call and written
+* with a single write; the encoding buffer is kept by each thread for its next
+* tile.
 */
 bool
 stt::STTFileTileSerializer::serializeTile(const stt::MeshTile *tile, bool writeVertexNormals)
 {
-    const TileCoordinate *coordinate = tile;
-    const std::string filename = getTileFilename(coordinate, moutputDir, "terrain");
-    const std::string temp_filename = concat(filename, ".tmp");
+    thread_local STTMemoryOutputStream ostream;
 
-    STTZFileOutputStream ostream(temp_filename.c_str());
+    ostream.clear();
     tile->writeFile(ostream, writeVertexNormals);
-    ostream.close();
+
+    std::vector<unsigned char> compressed;
+    mcodec.encode(ostream.buffer().data(), ostream.buffer().size(), compressed);
+
+    return storeTileData(*tile, std::move(compressed));
+}
+
+/**
+* @details
+* stores the compressed data of a MeshTile in the directory store
+*/
+bool
+stt::STTFileTileSerializer::serializeTileData(const stt::TileCoordinate *coordinate, const unsigned char *data, size_t size)
+{
+    if (mwriters.empty()) {
+        renameTemporaryFile(writeTemporaryFile(coordinate, data, size));
+        return true;
+    }
+
+    return storeTileData(*coordinate, std::vector<unsigned char>(data, data + size));
+}
+
+std::string
+stt::STTFileTileSerializer::writeTemporaryFile(const TileCoordinate *coordinate, const unsigned char *data, size_t size)
+{
+    const std::string filename = getTileFilename(coordinate, moutputDir, mextension.c_str());
+    const std::string temp_filename = concat(filename, ".tmp");
+
+    VSILFILE *fp = VSIFOpenL(temp_filename.c_str(), "wb");
+    if (fp == NULL) {
+        throw STTException("Failed to open file");
+    }
+
+    size_t written = VSIFWriteL(data, 1, size, fp);
+
+    if (VSIFCloseL(fp) != 0 || written != size) {
+        throw STTException("Failed to write file");
+    }
+
+    return filename;
+}
+
+void
+stt::STTFileTileSerializer::renameTemporaryFile(const std::string &filename)
+{
+    const std::string temp_filename = concat(filename, ".tmp");
 
     if (VSIRename(temp_filename.c_str(), filename.c_str()) != 0) {
         throw STTException("Could not rename temporary file");
     }
+}
+
+void
+stt::STTFileTileSerializer::setWriteThreads(unsigned int threads, uint64_t maxBytesInFlight)
+{
+    mwriteThreads = threads;
+    mmaxBytesInFlight = maxBytesInFlight;
+}
+
+void
+stt::STTFileTileSerializer::startSerialization()
+{
+    mclosing = false;
+    merror = std::exception_ptr();
+    mwriting.assign(mwriteThreads, UINT64_MAX);
+
+    for (unsigned int i = 0; i < mwriteThreads; ++i) {
+        mwriters.emplace_back(&STTFileTileSerializer::writeTiles, this, i);
+    }
+}
+
+/**
+* @details without I/O threads the tile is written straight away. otherwise
+* it is queued and the calling thread only waits while the tiles already
+* queued hold the budget of bytes in flight; a single tile larger than the
+* budget is still accepted once the queue is empty.
+*/
+bool
+stt::STTFileTileSerializer::storeTileData(const TileCoordinate &coord, std::vector<unsigned char> &&data)
+{
+    if (mwriters.empty()) {
+        renameTemporaryFile(writeTemporaryFile(&coord, data.data(), data.size()));
+        return true;
+    }
+
+    const uint64_t size = data.size();
+
+    std::unique_lock<std::mutex> lock(mpendingMutex);
+    mbytesWritten.wait(lock, [&]() {
+        return merror || mbytesInFlight == 0 || mbytesInFlight + size <= mmaxBytesInFlight;
+    });
+
+    if (merror) {
+        throw STTException("Failed to write tiles to the output directory");
+    }
+
+    PendingTile tile = { mqueued++, coord, std::move(data) };
+    mpending.push_back(std::move(tile));
+    mbytesInFlight += size;
+
+    lock.unlock();
+    mtilesPending.notify_one();
 
     return true;
 }
+
+/**
+* @details each thread takes its share of the tiles waiting, up to a batch,
+* and writes the files of the batch before renaming them, so the directory
+* entries of a batch are updated together. the first error stops every thread and is
+* rethrown by `endSerialization`.
+*/
+void
+stt::STTFileTileSerializer::writeTiles(unsigned int thread)
+{
+    const size_t batchSize = 64;
+    std::vector<PendingTile> batch;
+    std::vector<std::string> filenames;
+
+    std::unique_lock<std::mutex> lock(mpendingMutex);
+    while (true) {
+        mtilesPending.wait(lock, [this]() { return mclosing || merror || !mpending.empty(); });
+
+        if (merror || mpending.empty()) {
+            break;
+        }
+
+        // share the waiting tiles out between the threads
+        const size_t count = std::min(batchSize, std::max<size_t>(1, mpending.size() / mwriters.size()));
+
+        batch.clear();
+        uint64_t batchBytes = 0;
+        while (batch.size() < count) {
+            batchBytes += mpending.front().data.size();
+            batch.push_back(std::move(mpending.front()));
+            mpending.pop_front();
+        }
+        mwriting[thread] = batch.front().sequence;
+        lock.unlock();
+
+        try {
+            filenames.clear();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                filenames.push_back(writeTemporaryFile(&batch[i].coord, batch[i].data.data(), batch[i].data.size()));
+            }
+            for (size_t i = 0; i < filenames.size(); ++i) {
+                renameTemporaryFile(filenames[i]);
+            }
+        } catch (...) {
+            lock.lock();
+            if (!merror) {
+                merror = std::current_exception();
+            }
+            break;
+        }
+
+        lock.lock();
+        mwriting[thread] = UINT64_MAX;
+        mbytesInFlight -= batchBytes;
+        mbytesWritten.notify_all();
+    }
+
+    lock.unlock();
+    mbytesWritten.notify_all();
+    mtilesPending.notify_all();
+}
+
+uint64_t
+stt::STTFileTileSerializer::firstUnwritten() const
+{
+    uint64_t first = mpending.empty() ? mqueued : mpending.front().sequence;
+
+    for (size_t i = 0; i < mwriting.size(); ++i) {
+        first = std::min(first, mwriting[i]);
+    }
+
+    return first;
+}
+
+/**
+* @details the tiles are numbered as they are queued and taken by the I/O
+* threads in that order, so the tiles queued before the call are written once
+* no tile before the last of them is still queued or in a batch being written.
+* the threads creating tiles carry on queueing meanwhile.
+*/
+void
+stt::STTFileTileSerializer::flush()
+{
+    std::unique_lock<std::mutex> lock(mpendingMutex);
+    const uint64_t queued = mqueued;
+
+    mbytesWritten.wait(lock, [&]() { return merror || firstUnwritten() >= queued; });
+
+    if (merror) {
+        throw STTException("Failed to write tiles to the output directory");
+    }
+}
+
+void
+stt::STTFileTileSerializer::endSerialization()
+{
+    {
+        std::lock_guard<std::mutex> lock(mpendingMutex);
+        mclosing = true;
+    }
+    mtilesPending.notify_all();
+
+    for (size_t i = 0; i < mwriters.size(); ++i) {
+        mwriters[i].join();
+    }
+    mwriters.clear();
+
+    if (merror) {
+        std::exception_ptr error = merror;
+        mpending.clear();
+        mbytesInFlight = 0;
+        std::rethrow_exception(error);
+    }
+}
+
+stt::STTFileTileSerializer::~STTFileTileSerializer()
+{
+    try {
+        endSerialization();
+    } catch (...) {
+        // an error is only reported by calling `endSerialization`
+    }
+}
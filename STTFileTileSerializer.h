@@ -6,12 +6,19 @@
  * @brief this declares and defines the `STTFileTileSerializer` class
  */
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "TileCoordinate.h"
 #include "GDALSerializer.h"
 #include "TerrainSerializer.h"
 #include "MeshSerializer.h"
+#include "TileCodec.h"
 
 namespace stt {
     class STTFileTileSerializer;
@@ -24,13 +31,32 @@ class STT_DLL stt::STTFileTileSerializer :
     public stt::MeshSerializer
 {
 public:
-    STTFileTileSerializer(const std::string &outputDir, bool resume):
+    /// create a serializer compressing terrain and mesh tiles with a codec,
+    /// which defaults to gzip
+    STTFileTileSerializer(const std::string &outputDir, bool resume,
+        const TileCodec *codec = NULL):
         moutputDir(outputDir),
-        mresume(resume)
+        mresume(resume),
+        mcodec(codec ? *codec : TileCodec::gzip()),
+        mextension(std::string("terrain") + mcodec.extension()),
+        mwriteThreads(0),
+        mmaxBytesInFlight(0),
+        mbytesInFlight(0),
+        mqueued(0),
+        mclosing(false)
     {}
 
-    /// start a new serialization task
-    virtual void startSerialization() {};
+    /// the destructor writes any tiles still waiting for the I/O threads
+    ~STTFileTileSerializer();
+
+    /// write terrain and mesh tiles from a pool of I/O threads instead of the
+    /// threads creating them, holding up to `maxBytesInFlight` bytes of tiles
+    /// waiting to be written. this is set before serialization starts
+    void
+    setWriteThreads(unsigned int threads, uint64_t maxBytesInFlight);
+
+    /// start a new serialization task, starting any I/O threads
+    virtual void startSerialization();
 
     /// returns if the specified Tile Coordiante should be serialized
     virtual bool mustSerializeCoordinate(const stt::TileCoordinate *coordinate);
@@ -52,8 +78,18 @@ public:
         bool writeVertexNormals = false
     );
 
-    /// serialization finished, releases any resources loaded
-    virtual void endSerialization() {};
+    /// store the encoded and gzipped data of a MeshTile
+    virtual bool serializeTileData(
+        const stt::TileCoordinate *coordinate,
+        const unsigned char *data,
+        size_t size
+    );
+
+    /// wait for the I/O threads to write the tiles handed to them so far
+    virtual void flush();
+
+    /// serialization finished, waits for the I/O threads to write every tile
+    virtual void endSerialization();
 
     /// create a filename for a tile coordinate
     static std::string getTileFilename(
@@ -68,6 +104,60 @@ protected:
 
     /// do not overwrite existing files
     bool mresume;
+    /// the codec compressing terrain and mesh tiles
+    const TileCodec &mcodec;
+    /// the extension of terrain and mesh tiles, which follows the codec
+    std::string mextension;
+
+    /// a tile waiting for an I/O thread
+    struct PendingTile {
+        uint64_t sequence;
+        TileCoordinate coord;
+        std::vector<unsigned char> data;
+    };
+
+    /// store the data of a terrain or mesh tile, handing it to the I/O
+    /// threads if there are any
+    bool
+    storeTileData(const TileCoordinate &coord, std::vector<unsigned char> &&data);
+
+    /// write a tile to a temporary file, returning the name of its tile file
+    std::string
+    writeTemporaryFile(const TileCoordinate *coordinate, const unsigned char *data, size_t size);
+
+    /// move the temporary file of a tile file into place
+    static void
+    renameTemporaryFile(const std::string &filename);
+
+    /// the loop of an I/O thread
+    void
+    writeTiles(unsigned int thread);
+
+    /// get the sequence number of the first tile which is not yet written
+    uint64_t
+    firstUnwritten() const;
+
+    /// the number of I/O threads and the bytes of tiles they may hold
+    unsigned int mwriteThreads;
+    uint64_t mmaxBytesInFlight;
+
+    /// the I/O threads and the tiles waiting for them
+    std::vector<std::thread> mwriters;
+    std::deque<PendingTile> mpending;
+    /// the bytes of the tiles handed to the I/O threads and not yet written
+    uint64_t mbytesInFlight;
+    /// the number of tiles handed to the I/O threads, which numbers them
+    uint64_t mqueued;
+    /// the first tile of the batch each I/O thread is writing
+    std::vector<uint64_t> mwriting;
+    /// whether the I/O threads stop once the tiles are written
+    bool mclosing;
+    /// the first error of an I/O thread
+    std::exception_ptr merror;
+
+    std::mutex mpendingMutex;
+    std::condition_variable mtilesPending;
+    std::condition_variable mbytesWritten;
 };
 
 #endif /* STTFILETILESERIALIZER_H_ */
@@ -0,0 +1,379 @@
+/**
+ * @file STTMBTilesSerializer.cpp
+ * @brief this defines the `STTMBTilesSerializer` class
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "sqlite3.h"
+#include "cpl_vsi.h"
+
+#include "concat.h"
+#include "STTException.h"
+#include "STTMBTilesSerializer.h"
+#include "STTMemoryOutputStream.h"
+
+using namespace stt;
+
+stt::STTMBTilesSerializer::STTMBTilesSerializer(const std::string &filename,
+    const Options &options, bool resume, const TileCodec *codec):
+    mfilename(filename),
+    mresume(resume),
+    mcodec(codec ? *codec : TileCodec::gzip()),
+    moptions(options),
+    mdb(NULL),
+    minsert(NULL),
+    mqueue(options.queueCapacity),
+    mfailed(false),
+    mminZoom(INT_MAX),
+    mmaxZoom(-1)
+{
+    if (moptions.batchSize == 0) {
+        moptions.batchSize = 1;
+    }
+}
+
+/**
+* @details a serialization which was not finished is abandoned: the writer
+* thread is stopped and the tiles it had not committed are discarded.
+*/
+stt::STTMBTilesSerializer::~STTMBTilesSerializer()
+{
+    mqueue.abort();
+    if (mwriter.joinable()) {
+        mwriter.join();
+    }
+
+    sqlite3_finalize(minsert);
+    sqlite3_close(mdb);
+}
+
+void
+stt::STTMBTilesSerializer::execute(const char *sql)
+{
+    char *message = NULL;
+
+    if (sqlite3_exec(mdb, sql, NULL, NULL, &message) != SQLITE_OK) {
+        std::string error = concat("SQLite error in `", sql, "`: ", message ? message : "");
+        sqlite3_free(message);
+        throw STTException(error.c_str());
+    }
+}
+
+/**
+* @details the page size only applies to a new database and has to be set
+* before it is switched to write ahead logging, which lets the commits of the
+* writer thread append to the log instead of rewriting the database. the tiles
+* are kept in a rowid table with a separate index, as blobs of this size would
+* bloat the pages of an index organised table. when resuming, the coordinates
+* of the tiles already stored are read so that they can be skipped without
+* querying the database from the tiling threads.
+*/
+void
+stt::STTMBTilesSerializer::startSerialization()
+{
+    if (sqlite3_open_v2(mfilename.c_str(), &mdb,
+            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        throw STTException(concat("Could not open the MBTiles file ", mfilename).c_str());
+    }
+
+    execute(concat("PRAGMA page_size = ", moptions.pageSize).c_str());
+    execute("PRAGMA journal_mode = WAL");
+    execute("PRAGMA synchronous = NORMAL");
+
+    execute("CREATE TABLE IF NOT EXISTS metadata (name TEXT PRIMARY KEY, value TEXT)");
+    execute("CREATE TABLE IF NOT EXISTS tiles ("
+        "zoom_level INTEGER NOT NULL, tile_column INTEGER NOT NULL, tile_row INTEGER NOT NULL, "
+        "tile_data BLOB NOT NULL)");
+    execute("CREATE UNIQUE INDEX IF NOT EXISTS tile_index ON tiles (zoom_level, tile_column, tile_row)");
+
+    if (mresume) {
+        sqlite3_stmt *select = NULL;
+        if (sqlite3_prepare_v2(mdb, "SELECT zoom_level, tile_column, tile_row FROM tiles",
+                -1, &select, NULL) != SQLITE_OK) {
+            throw STTException(sqlite3_errmsg(mdb));
+        }
+
+        int result;
+        while ((result = sqlite3_step(select)) == SQLITE_ROW) {
+            TileCoordinate coord(sqlite3_column_int(select, 0),
+                sqlite3_column_int(select, 1), sqlite3_column_int(select, 2));
+            mstored.insert(key(coord));
+
+            mminZoom = std::min(mminZoom, (int) coord.zoom);
+            mmaxZoom = std::max(mmaxZoom, (int) coord.zoom);
+        }
+
+        if (result != SQLITE_DONE) {
+            std::string error = sqlite3_errmsg(mdb);
+            sqlite3_finalize(select);
+            throw STTException(error.c_str());
+        }
+        sqlite3_finalize(select);
+    }
+
+    if (sqlite3_prepare_v2(mdb,
+            "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)",
+            -1, &minsert, NULL) != SQLITE_OK) {
+        throw STTException(sqlite3_errmsg(mdb));
+    }
+
+    mwriter = std::thread(&STTMBTilesSerializer::write, this);
+}
+
+/**
+* @details
+* returns if the specified TileCoordinate should be serialized
+*/
+bool
+stt::STTMBTilesSerializer::mustSerializeCoordinate(const stt::TileCoordinate *coordinate)
+{
+    return !mresume || mstored.find(key(*coordinate)) == mstored.end();
+}
+
+/**
+* @details a tile is only copied into the queue, so the threads creating tiles
+* only wait for the writer thread while the queue is full. once the writer
+* thread has failed no more tiles are accepted.
+*/
+bool
+stt::STTMBTilesSerializer::enqueue(const TileCoordinate &coord,
+    const unsigned char *data, size_t size, const char *format)
+{
+    std::call_once(mformatSet, [this, format]() { mformat = format; });
+
+    Row row;
+    row.coord = coord;
+    row.data.assign(data, data + size);
+
+    if (!mqueue.push(std::move(row)) || mfailed) {
+        throw STTException("Failed to write to the MBTiles file");
+    }
+
+    return true;
+}
+
+/**
+* @details the tiles are committed every `Options::batchSize` inserts, which
+* spreads the cost of a commit over many tiles.
+*/
+void
+stt::STTMBTilesSerializer::write()
+{
+    size_t pending = 0;
+
+    try {
+        Row row;
+        while (mqueue.pop(row)) {
+            if (row.committed) {
+                if (pending > 0) {
+                    execute("COMMIT");
+                    pending = 0;
+                }
+
+                row.committed->set_value();
+                row.committed.reset();
+                continue;
+            }
+
+            if (pending == 0) {
+                execute("BEGIN");
+            }
+
+            sqlite3_bind_int(minsert, 1, row.coord.zoom);
+            sqlite3_bind_int(minsert, 2, row.coord.x);
+            sqlite3_bind_int(minsert, 3, row.coord.y);
+            sqlite3_bind_blob(minsert, 4, row.data.data(), row.data.size(), SQLITE_STATIC);
+
+            int result = sqlite3_step(minsert);
+            sqlite3_reset(minsert);
+            if (result != SQLITE_DONE) {
+                throw STTException(sqlite3_errmsg(mdb));
+            }
+
+            mminZoom = std::min(mminZoom, (int) row.coord.zoom);
+            mmaxZoom = std::max(mmaxZoom, (int) row.coord.zoom);
+
+            if (++pending == moptions.batchSize) {
+                execute("COMMIT");
+                pending = 0;
+            }
+        }
+
+        if (pending > 0) {
+            execute("COMMIT");
+        }
+    } catch (...) {
+        merror = std::current_exception();
+        mfailed = true;
+        mqueue.abort();
+    }
+}
+
+/**
+* @details a request to commit is queued behind the tiles, so the writer
+* thread commits them when it gets to it. a request dropped because the writer
+* thread failed breaks its promise.
+*/
+void
+stt::STTMBTilesSerializer::flush()
+{
+    Row row;
+    row.committed.reset(new std::promise<void>());
+    std::future<void> committed = row.committed->get_future();
+
+    if (!mqueue.push(std::move(row)) || mfailed) {
+        throw STTException("Failed to write to the MBTiles file");
+    }
+
+    try {
+        committed.get();
+    } catch (const std::future_error &) {
+        throw STTException("Failed to write to the MBTiles file");
+    }
+}
+
+/**
+* @details the metadata follows the MBTiles specification, with the tiles
+* compressed by the codec recorded as their `encoding`.
+*/
+void
+stt::STTMBTilesSerializer::endSerialization()
+{
+    mqueue.close();
+    if (mwriter.joinable()) {
+        mwriter.join();
+    }
+
+    if (merror) {
+        std::rethrow_exception(merror);
+    }
+
+    sqlite3_stmt *metadata = NULL;
+    if (sqlite3_prepare_v2(mdb, "INSERT OR REPLACE INTO metadata (name, value) VALUES (?, ?)",
+            -1, &metadata, NULL) != SQLITE_OK) {
+        throw STTException(sqlite3_errmsg(mdb));
+    }
+
+    auto set = [&](const char *name, const std::string &value) {
+        sqlite3_bind_text(metadata, 1, name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(metadata, 2, value.c_str(), -1, SQLITE_TRANSIENT);
+
+        int result = sqlite3_step(metadata);
+        sqlite3_reset(metadata);
+        if (result != SQLITE_DONE) {
+            throw STTException(sqlite3_errmsg(mdb));
+        }
+    };
+
+    try {
+        execute("BEGIN");
+        set("name", moptions.name);
+        set("scheme", "tms");
+        if (!mformat.empty()) {
+            set("format", mformat);
+        }
+        if (mmaxZoom >= 0) {
+            set("minzoom", concat(mminZoom));
+            set("maxzoom", concat(mmaxZoom));
+        }
+        if (mformat == "terrain" && mcodec.contentEncoding()) {
+            set("encoding", mcodec.contentEncoding());
+        }
+        execute("COMMIT");
+    } catch (...) {
+        sqlite3_finalize(metadata);
+        throw;
+    }
+    sqlite3_finalize(metadata);
+
+    sqlite3_finalize(minsert);
+    minsert = NULL;
+
+    // fold the write ahead log back into the database
+    execute("PRAGMA wal_checkpoint(TRUNCATE)");
+
+    sqlite3_close(mdb);
+    mdb = NULL;
+}
+
+/**
+* @details the tile is created in memory with GDAL's `/vsimem/` file system
+* and its bytes are taken from there.
+*/
+bool
+stt::STTMBTilesSerializer::serializeTile(const stt::GDALTile *tile, GDALDriver *driver,
+    const char *extension, CPLStringList &creationOptions)
+{
+    const TileCoordinate *coordinate = tile;
+    const std::string filename = concat("/vsimem/stt-mbtiles-", (const void *) this, "-",
+        coordinate->zoom, "-", coordinate->x, "-", coordinate->y, ".", extension);
+
+    GDALDataset *poDstDS;
+    poDstDS = driver->CreateCopy(filename.c_str(), tile->dataset, FALSE, creationOptions, NULL, NULL);
+
+    if (poDstDS == NULL) {
+        throw STTException("Could not create GDAL tile");
+    }
+
+    GDALClose(poDstDS);
+
+    vsi_l_offset size = 0;
+    GByte *data = VSIGetMemFileBuffer(filename.c_str(), &size, TRUE);
+    if (data == NULL) {
+        throw STTException("Could not read GDAL tile");
+    }
+
+    try {
+        enqueue(*coordinate, data, size, extension);
+    } catch (...) {
+        CPLFree(data);
+        throw;
+    }
+    CPLFree(data);
+
+    return true;
+}
+
+/**
+* @details
+* serialize a TerrainTile to the store, compressed by the codec
+*/
+bool
+stt::STTMBTilesSerializer::serializeTile(const stt::TerrainTile *tile)
+{
+    thread_local STTMemoryOutputStream ostream;
+    thread_local std::vector<unsigned char> compressed;
+
+    ostream.clear();
+    tile->writeFile(ostream);
+    mcodec.encode(ostream.buffer().data(), ostream.buffer().size(), compressed);
+
+    return serializeTileData(tile, compressed.data(), compressed.size());
+}
+
+/**
+* @details
+* serialize a MeshTile to the store, compressed by the codec
+*/
+bool
+stt::STTMBTilesSerializer::serializeTile(const stt::MeshTile *tile, bool writeVertexNormals)
+{
+    thread_local STTMemoryOutputStream ostream;
+    thread_local std::vector<unsigned char> compressed;
+
+    ostream.clear();
+    tile->writeFile(ostream, writeVertexNormals);
+    mcodec.encode(ostream.buffer().data(), ostream.buffer().size(), compressed);
+
+    return serializeTileData(tile, compressed.data(), compressed.size());
+}
+
+bool
+stt::STTMBTilesSerializer::serializeTileData(const stt::TileCoordinate *coordinate,
+    const unsigned char *data, size_t size)
+{
+    return enqueue(*coordinate, data, size, "terrain");
+}
@@ -0,0 +1,173 @@
+#ifndef STTMBTILESSERIALIZER_H_
+#define STTMBTILESSERIALIZER_H_
+
+/**
+ * @file STTMBTilesSerializer.h
+ * @brief this declares the `STTMBTilesSerializer` class
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "TileCoordinate.h"
+#include "BoundedQueue.h"
+#include "GDALSerializer.h"
+#include "TerrainSerializer.h"
+#include "MeshSerializer.h"
+#include "TileCodec.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace stt {
+    class STTMBTilesSerializer;
+}
+
+/**
+ * @brief implements a serializer storing tiles in an MBTiles file
+ *
+ * a single SQLite database holds every tile as a row of the `tiles` table in
+ * place of a file per tile. the tiles are encoded and compressed by the
+ * threads creating them and handed to a single writer thread, which inserts
+ * them with a prepared statement and commits them in batches:
+ *
+ * \code
+ *   STTMBTilesSerializer serializer("terrain.mbtiles", options, false);
+ *   serializer.startSerialization();
+ *   // serialize tiles from any number of threads
+ *   serializer.endSerialization();
+ * \endcode
+ *
+ * the rows are keyed by the TMS coordinates of the tiles, which is the scheme
+ * of the MBTiles `tile_row` column and of the grids.
+ */
+class STT_DLL stt::STTMBTilesSerializer :
+    public stt::GDALSerializer,
+    public stt::TerrainSerializer,
+    public stt::MeshSerializer
+{
+public:
+    /// options controlling the database and its writes
+    struct Options {
+        /// the number of tiles inserted by each transaction
+        size_t batchSize = 1000;
+        /// the number of tiles waiting for the writer thread
+        size_t queueCapacity = 256;
+        /// the size in bytes of the database pages, chosen for tiles of tens of kilobytes
+        int pageSize = 65536;
+        /// the name of the tileset recorded in the metadata
+        std::string name;
+    };
+
+    /// create a serializer for a database, compressing terrain and mesh tiles
+    /// with a codec which defaults to gzip
+    STTMBTilesSerializer(const std::string &filename, const Options &options,
+        bool resume, const TileCodec *codec = NULL);
+
+    /// the destructor
+    ~STTMBTilesSerializer();
+
+    /// open the database and start the writer thread
+    virtual void startSerialization();
+
+    /// returns if the specified Tile Coordinate should be serialized
+    virtual bool mustSerializeCoordinate(const stt::TileCoordinate *coordinate);
+
+    /// serialize a GDALTile to the store
+    virtual bool serializeTile(
+        const stt::GDALTile *tile,
+        GDALDriver *driver,
+        const char *extension,
+        CPLStringList &creationOptions
+    );
+
+    /// serialize a TerrainTile to the store
+    virtual bool serializeTile(const stt::TerrainTile *tile);
+
+    /// serialize a MeshTile to the store
+    virtual bool serializeTile(
+        const stt::MeshTile *tile,
+        bool writeVertexNormals = false
+    );
+
+    /// store the encoded and compressed data of a MeshTile
+    virtual bool serializeTileData(
+        const stt::TileCoordinate *coordinate,
+        const unsigned char *data,
+        size_t size
+    );
+
+    /// wait for the writer thread to commit the tiles queued so far
+    virtual void flush();
+
+    /// write the remaining tiles and the metadata and close the database
+    virtual void endSerialization();
+
+protected:
+    /// a tile waiting for the writer thread, or a request to commit the
+    /// tiles before it
+    struct Row {
+        TileCoordinate coord;
+        std::vector<unsigned char> data;
+        std::shared_ptr<std::promise<void>> committed;
+    };
+
+    /// hand a tile to the writer thread
+    bool
+    enqueue(const TileCoordinate &coord, const unsigned char *data, size_t size,
+        const char *format);
+
+    /// the loop of the writer thread
+    void
+    write();
+
+    /// run a statement without results, throwing on failure
+    void
+    execute(const char *sql);
+
+    /// get a key identifying a tile coordinate
+    static inline uint64_t
+    key(const TileCoordinate &coord) {
+        return ((uint64_t) coord.zoom << 58) | ((uint64_t) coord.x << 29) | (uint64_t) coord.y;
+    }
+
+    /// the path of the database
+    std::string mfilename;
+    /// do not overwrite tiles already in the database
+    bool mresume;
+    /// the codec compressing terrain and mesh tiles
+    const TileCodec &mcodec;
+    /// the options of the database
+    Options moptions;
+
+    /// the open database and its insert statement
+    sqlite3 *mdb;
+    sqlite3_stmt *minsert;
+
+    /// the tiles already in the database when resuming
+    std::unordered_set<uint64_t> mstored;
+
+    /// the tiles waiting for the writer thread, and the thread
+    BoundedQueue<Row> mqueue;
+    std::thread mwriter;
+    /// the error which stopped the writer thread
+    std::exception_ptr merror;
+    std::atomic<bool> mfailed;
+
+    /// the format of the tiles, set by the first tile stored
+    std::string mformat;
+    std::once_flag mformatSet;
+    /// the zoom levels stored, updated by the writer thread
+    int mminZoom;
+    int mmaxZoom;
+};
+
+#endif /* STTMBTILESSERIALIZER_H_ */
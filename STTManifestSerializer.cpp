@@ -0,0 +1,121 @@
+/**
+ * @file STTManifestSerializer.cpp
+ * @brief this defines the `STTManifestSerializer` class
+ */
+
+#include "STTManifestSerializer.h"
+
+using namespace stt;
+
+stt::STTManifestSerializer::STTManifestSerializer(MeshSerializer &serializer,
+    TileManifest &manifest, unsigned int interval):
+    mserializer(serializer),
+    mmanifest(manifest),
+    minterval(interval),
+    mstopping(false)
+{}
+
+stt::STTManifestSerializer::~STTManifestSerializer()
+{
+    stop();
+}
+
+void
+stt::STTManifestSerializer::startSerialization()
+{
+    mstopping = false;
+    merror = std::exception_ptr();
+
+    if (minterval.count() > 0) {
+        mthread = std::thread(&STTManifestSerializer::checkpoints, this);
+    }
+}
+
+/**
+* @details a manifest kept from an earlier run lists every tile which needs
+* no more work, so the serializer is only asked about a tile when the manifest
+* is new, as the tiles of a run from before the manifest may still be stored.
+*/
+bool
+stt::STTManifestSerializer::mustSerializeCoordinate(const stt::TileCoordinate *coordinate)
+{
+    if (mmanifest.isComplete(*coordinate))
+        return false;
+
+    return mmanifest.isResumed() || mserializer.mustSerializeCoordinate(coordinate);
+}
+
+bool
+stt::STTManifestSerializer::serializeTile(const stt::MeshTile *tile, bool writeVertexNormals)
+{
+    bool serialized = mserializer.serializeTile(tile, writeVertexNormals);
+    mmanifest.add(*tile);
+
+    return serialized;
+}
+
+bool
+stt::STTManifestSerializer::serializeTileData(const stt::TileCoordinate *coordinate,
+    const unsigned char *data, size_t size)
+{
+    bool serialized = mserializer.serializeTileData(coordinate, data, size);
+    mmanifest.add(*coordinate);
+
+    return serialized;
+}
+
+void
+stt::STTManifestSerializer::flush()
+{
+    mmanifest.checkpoint([this]() { mserializer.flush(); });
+}
+
+/**
+* @details a checkpoint which fails stops the checkpoints and is rethrown by
+* `endSerialization`; the tiles it took are recorded by a later checkpoint.
+*/
+void
+stt::STTManifestSerializer::checkpoints()
+{
+    std::unique_lock<std::mutex> lock(mmutex);
+
+    while (!mstopped.wait_for(lock, minterval, [this]() { return mstopping; })) {
+        lock.unlock();
+
+        try {
+            flush();
+        } catch (...) {
+            lock.lock();
+            merror = std::current_exception();
+            break;
+        }
+
+        lock.lock();
+    }
+}
+
+void
+stt::STTManifestSerializer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mmutex);
+        mstopping = true;
+    }
+    mstopped.notify_all();
+
+    if (mthread.joinable()) {
+        mthread.join();
+    }
+}
+
+void
+stt::STTManifestSerializer::endSerialization()
+{
+    stop();
+
+    if (merror) {
+        std::rethrow_exception(merror);
+    }
+
+    flush();
+}
@@ -0,0 +1,105 @@
+#ifndef STTMANIFESTSERIALIZER_H_
+#define STTMANIFESTSERIALIZER_H_
+
+/**
+ * @file STTManifestSerializer.h
+ * @brief this declares the `STTManifestSerializer` class
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "TileCoordinate.h"
+#include "MeshSerializer.h"
+#include "TileManifest.h"
+
+namespace stt {
+    class STTManifestSerializer;
+}
+
+/**
+ * @brief records the tiles stored by another serializer in a `TileManifest`
+ *
+ * the tiles are handed on to the serializer wrapped and added to the manifest
+ * once it has taken them. a checkpoint thread has the serializer flush its
+ * tiles and records them in the manifest at a fixed interval. a tile recorded
+ * in the manifest is not serialized again, which lets a resumed run skip the
+ * tiles it has done before creating them:
+ *
+ * \code
+ *   STTManifestSerializer manifested(serializer, manifest, 60);
+ *   manifested.startSerialization();
+ *   // serialize tiles from any number of threads
+ *   manifested.endSerialization();
+ * \endcode
+ *
+ * the serializer wrapped is started and ended by its owner; starting and
+ * ending this serializer starts and stops the checkpoints.
+ */
+class STT_DLL stt::STTManifestSerializer :
+    public stt::MeshSerializer
+{
+public:
+    /// wrap a serializer, recording its tiles every `interval` seconds
+    STTManifestSerializer(MeshSerializer &serializer, TileManifest &manifest,
+        unsigned int interval);
+
+    /// the destructor stops the checkpoints, dropping the tiles not recorded
+    ~STTManifestSerializer();
+
+    /// start the checkpoint thread
+    virtual void startSerialization();
+
+    /// returns if the specified Tile Coordinate should be serialized
+    virtual bool mustSerializeCoordinate(const stt::TileCoordinate *coordinate);
+
+    /// serialize a MeshTile to the wrapped serializer
+    virtual bool serializeTile(
+        const stt::MeshTile *tile,
+        bool writeVertexNormals = false
+    );
+
+    /// store the encoded and compressed data of a MeshTile with the wrapped
+    /// serializer
+    virtual bool serializeTileData(
+        const stt::TileCoordinate *coordinate,
+        const unsigned char *data,
+        size_t size
+    );
+
+    /// take a checkpoint, recording the tiles serialized so far
+    virtual void flush();
+
+    /// stop the checkpoint thread and record every tile serialized
+    virtual void endSerialization();
+
+protected:
+    /// the loop of the checkpoint thread
+    void
+    checkpoints();
+
+    /// stop the checkpoint thread
+    void
+    stop();
+
+    /// the serializer storing the tiles
+    MeshSerializer &mserializer;
+    /// the manifest recording them
+    TileManifest &mmanifest;
+    /// the time between checkpoints
+    std::chrono::seconds minterval;
+
+    /// the checkpoint thread and whether it is to stop
+    std::thread mthread;
+    bool mstopping;
+    /// the error which stopped the checkpoint thread
+    std::exception_ptr merror;
+
+    std::mutex mmutex;
+    std::condition_variable mstopped;
+};
+
+#endif /* STTMANIFESTSERIALIZER_H_ */
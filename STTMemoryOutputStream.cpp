@@ -0,0 +1,23 @@
+/**
+* @file STTMemoryOutputStream.cpp
+* @brief this defines the `STTMemoryOutputStream` class
+*/
+
+#include <cstring>
+
+#include "STTMemoryOutputStream.h"
+
+using namespace stt;
+
+/**
+* @details
+* appends a sequence of memory pointed by ptr to the buffer. most writes are
+* of a single field, which is copied in place once the buffer has room.
+*/
+uint32_t
+stt::STTMemoryOutputStream::write(const void *ptr, uint32_t size) {
+    const size_t offset = mbuffer.size();
+    mbuffer.resize(offset + size);
+    memcpy(mbuffer.data() + offset, ptr, size);
+    return size;
+}
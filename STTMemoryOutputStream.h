@@ -0,0 +1,46 @@
+#ifndef STTMEMORYOUTPUTSTREAM_H_
+#define STTMEMORYOUTPUTSTREAM_H_
+
+/**
+ * @file STTMemoryOutputStream.h
+ * @brief this declares and defines the `STTMemoryOutputStream` class
+ */
+
+#include <vector>
+#include "STTOutputStream.h"
+
+namespace stt {
+    class STTMemoryOutputStream;
+}
+
+/**
+ * @brief implements STTOutputStream for a growing buffer in memory
+ *
+ * a tile is encoded field by field; writing the fields to memory and
+ * compressing the whole buffer at once avoids a call into zlib per field. the
+ * stream can be cleared and reused for the next tile without reallocating.
+ */
+class STT_DLL stt::STTMemoryOutputStream: public stt::STTOutputStream
+{
+public:
+    /// writes a sequence of memory pointed by ptr into the stream
+    virtual uint32_t write(const void *ptr, uint32_t size);
+
+    /// discard the data written so far, keeping the memory of the buffer
+    inline void
+    clear() {
+        mbuffer.clear();
+    }
+
+    /// get the data written so far
+    inline std::vector<unsigned char> &
+    buffer() {
+        return mbuffer;
+    }
+
+protected:
+    /// the underlying buffer
+    std::vector<unsigned char> mbuffer;
+};
+
+#endif /* STTMEMORYOUTPUTSTREAM_H_ */
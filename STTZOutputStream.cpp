@@ -23,6 +23,39 @@ stt::STTZOutputStream::write(const void *ptr, uint32_t size)
     }
 }
 
+/**
+* @details
+* the whole buffer is deflated with a single call, with a gzip header and
+* trailer so that the result can be read back with `gzread` or served as
+* `Content-Encoding: gzip`.
+*/
+void
+stt::STTZOutputStream::compress(const void *ptr, size_t size,
+    std::vector<unsigned char> &compressed, int level)
+{
+    z_stream stream = {};
+
+    // 15 window bits plus 16 selects the gzip wrapper
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw STTException("Failed to initialise compression");
+    }
+
+    compressed.resize(deflateBound(&stream, size));
+
+    stream.next_in = (Bytef *)ptr;
+    stream.avail_in = size;
+    stream.next_out = compressed.data();
+    stream.avail_out = compressed.size();
+
+    int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        throw STTException("Failed to compress data");
+    }
+}
+
 stt::STTZFileOutputStream::STTZFileOutputStream(const char *fileName): STTZOutputStream(NULL)
 {
     gzFile file = gzopen(fileName, "wb");
@@ -6,6 +6,8 @@
  * @brief this declares and defines `STTZOutputStream` class
  */
 
+#include <vector>
+
 #include "zlib.h"
 #include "STTOutputStream.h"
 
@@ -23,6 +25,10 @@ public:
     /// writes a sequence of memory pointed by ptr into the stream
     virtual uint32_t write(const void *ptr, uint32_t size);
 
+    /// gzip a buffer in one go, producing the same format as a `gzFile`
+    static void compress(const void *ptr, size_t size, std::vector<unsigned char> &compressed,
+        int level = Z_DEFAULT_COMPRESSION);
+
 protected:
     /// the underlying GZFILE*
     gzFile fp;
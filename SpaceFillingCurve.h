@@ -0,0 +1,242 @@
+#ifndef SPACEFILLINGCURVE_H_
+#define SPACEFILLINGCURVE_H_
+
+/**
+ * @file SpaceFillingCurve.h
+ * @brief this declares and defines functions for walking space filling curves
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * helpers ordering the cells of a grid along a Morton (Z-order) or Hilbert
+ * curve. consecutive cells along these curves are close to each other in
+ * both dimensions, which keeps the source data read for consecutive tiles
+ * close together.
+ *
+ * the curves cover a square of `2^level` cells. the `rank` functions order
+ * only the cells of a rectangle within that square, skipping the cells
+ * outside it: the rank of a cell is the number of rectangle cells that come
+ * before it along the curve. this is calculated by descending the quadrants
+ * of the square and summing the area of the rectangle falling in the
+ * quadrants passed over, so it takes `O(level)` steps.
+ */
+namespace stt {
+    namespace curve {
+        enum Curve {
+            MORTON,     /// the Morton or Z-order curve
+            HILBERT     /// the Hilbert curve
+        };
+
+        struct Rect;
+
+        /// get the position of a cell along a curve covering `2^level` cells
+        inline uint64_t
+        index(Curve curve, unsigned int level, uint64_t x, uint64_t y);
+
+        /// get the cell at a position along a curve covering `2^level` cells
+        inline void
+        point(Curve curve, unsigned int level, uint64_t d, uint64_t &x, uint64_t &y);
+
+        /// get the rank of a cell amongst the cells of a rectangle at the origin
+        inline uint64_t
+        rank(Curve curve, uint64_t width, uint64_t height, uint64_t x, uint64_t y);
+
+        /// get the cell of a rectangle at the origin with a particular rank
+        inline void
+        unrank(Curve curve, uint64_t width, uint64_t height, uint64_t r, uint64_t &x, uint64_t &y);
+
+        /// get the smallest level whose square covers a rectangle
+        inline unsigned int
+        levelFor(uint64_t width, uint64_t height) {
+            unsigned int level = 0;
+            while (((uint64_t) 1 << level) < std::max(width, height)) {
+                ++level;
+            }
+
+            return level;
+        }
+    }
+}
+
+/// an inclusive rectangle of cells, which is empty if `minX > maxX`
+struct stt::curve::Rect {
+    int64_t minX, minY, maxX, maxY;
+
+    /// the number of cells in the rectangle
+    inline uint64_t
+    area() const {
+        if (minX > maxX || minY > maxY)
+            return 0;
+
+        return (uint64_t) (maxX - minX + 1) * (maxY - minY + 1);
+    }
+
+    /// intersect the rectangle with the quadrant `(qx, qy)` of half size `s`
+    inline Rect
+    quadrant(int qx, int qy, int64_t s) const {
+        Rect r = {
+            std::max(minX, qx * s),
+            std::max(minY, qy * s),
+            std::min(maxX, qx * s + s - 1),
+            std::min(maxY, qy * s + s - 1)
+        };
+
+        return r;
+    }
+};
+
+namespace stt {
+    namespace curve {
+        /// get the quadrant visited at a position `q` in `[0, 4)` of a curve
+        inline void
+        quadrantAt(Curve curve, int q, int &qx, int &qy) {
+            if (curve == HILBERT) {
+                qx = q >> 1;
+                qy = (q ^ qx) & 1;
+            } else {
+                qx = q & 1;
+                qy = q >> 1;
+            }
+        }
+
+        /// get the position in `[0, 4)` at which a curve visits a quadrant
+        inline int
+        positionOf(Curve curve, int qx, int qy) {
+            return (curve == HILBERT) ? ((3 * qx) ^ qy) : (qx | (qy << 1));
+        }
+
+        /// move a coordinate into the frame of the quadrant `(qx, qy)`
+        inline void
+        toQuadrant(Curve curve, int qx, int qy, int64_t s, int64_t &x, int64_t &y) {
+            x -= qx * s;
+            y -= qy * s;
+
+            // the hilbert curve is rotated and reflected in the lower quadrants
+            if (curve == HILBERT && qy == 0) {
+                if (qx == 1) {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+
+        /// move a rectangle lying within a quadrant into the quadrant's frame
+        inline Rect
+        toQuadrant(Curve curve, int qx, int qy, int64_t s, const Rect &rect) {
+            Rect r = rect;
+
+            toQuadrant(curve, qx, qy, s, r.minX, r.minY);
+            toQuadrant(curve, qx, qy, s, r.maxX, r.maxY);
+
+            // reflections and rotations can swap the corners
+            if (r.minX > r.maxX) std::swap(r.minX, r.maxX);
+            if (r.minY > r.maxY) std::swap(r.minY, r.maxY);
+
+            return r;
+        }
+    }
+}
+
+inline uint64_t
+stt::curve::index(Curve curve, unsigned int level, uint64_t x, uint64_t y)
+{
+    uint64_t d = 0;
+    int64_t px = x, py = y;
+
+    for (int64_t s = ((int64_t) 1 << level) >> 1; s > 0; s >>= 1) {
+        int qx = (px >= s), qy = (py >= s);
+
+        d += (uint64_t) positionOf(curve, qx, qy) * s * s;
+        toQuadrant(curve, qx, qy, s, px, py);
+    }
+
+    return d;
+}
+
+inline void
+stt::curve::point(Curve curve, unsigned int level, uint64_t d, uint64_t &x, uint64_t &y)
+{
+    int64_t px = 0, py = 0;
+    const int64_t n = (int64_t) 1 << level;
+
+    // build the coordinate up from the smallest quadrant, undoing the
+    // transformation applied when descending into each quadrant
+    for (int64_t s = 1; s < n; s <<= 1) {
+        int qx, qy;
+        quadrantAt(curve, d & 3, qx, qy);
+
+        if (curve == HILBERT && qy == 0) {
+            std::swap(px, py);
+            if (qx == 1) {
+                px = s - 1 - px;
+                py = s - 1 - py;
+            }
+        }
+
+        px += qx * s;
+        py += qy * s;
+        d >>= 2;
+    }
+
+    x = px;
+    y = py;
+}
+
+inline uint64_t
+stt::curve::rank(Curve curve, uint64_t width, uint64_t height, uint64_t x, uint64_t y)
+{
+    Rect rect = { 0, 0, (int64_t) width - 1, (int64_t) height - 1 };
+    uint64_t r = 0;
+    int64_t px = x, py = y;
+
+    for (int64_t s = ((int64_t) 1 << levelFor(width, height)) >> 1; s > 0; s >>= 1) {
+        int qx = (px >= s), qy = (py >= s);
+        int position = positionOf(curve, qx, qy);
+
+        // count the cells in the quadrants visited before this one
+        for (int q = 0; q < position; ++q) {
+            int ox, oy;
+            quadrantAt(curve, q, ox, oy);
+            r += rect.quadrant(ox, oy, s).area();
+        }
+
+        rect = toQuadrant(curve, qx, qy, s, rect.quadrant(qx, qy, s));
+        toQuadrant(curve, qx, qy, s, px, py);
+    }
+
+    return r;
+}
+
+inline void
+stt::curve::unrank(Curve curve, uint64_t width, uint64_t height, uint64_t r, uint64_t &x, uint64_t &y)
+{
+    const unsigned int level = levelFor(width, height);
+    Rect rect = { 0, 0, (int64_t) width - 1, (int64_t) height - 1 };
+    uint64_t d = 0;
+
+    // find the position along the full curve by skipping over the quadrants
+    // holding fewer cells than remain to be counted
+    for (int64_t s = ((int64_t) 1 << level) >> 1; s > 0; s >>= 1) {
+        for (int q = 0; q < 4; ++q) {
+            int qx, qy;
+            quadrantAt(curve, q, qx, qy);
+
+            Rect sub = rect.quadrant(qx, qy, s);
+            uint64_t area = sub.area();
+
+            if (r < area) {
+                d += (uint64_t) q * s * s;
+                rect = toQuadrant(curve, qx, qy, s, sub);
+                break;
+            }
+            r -= area;
+        }
+    }
+
+    point(curve, level, d, x, y);
+}
+
+#endif /* SPACEFILLINGCURVE_H_ */
@@ -0,0 +1,139 @@
+#ifndef TERRAINMETADATA_H_
+#define TERRAINMETADATA_H_
+
+/**
+ * @file TerrainMetadata.h
+ * @brief this declares and defines the `TerrainMetadata` class
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "Grid.h"
+#include "STTException.h"
+#include "TileCoordinate.h"
+
+namespace stt {
+    class TerrainMetadata;
+}
+
+/**
+ * @brief handle the terrain metadata
+ *
+ * the valid tile ranges of every zoom level and the bounds covered by the
+ * tiles of a run. every worker gathers the tiles it creates in its own
+ * instance, which are merged with `TerrainMetadata::add` once the workers are
+ * done.
+ */
+class stt::TerrainMetadata
+{
+public:
+    TerrainMetadata() {}
+
+    // defines the valid tile indices of a level in a Tileset
+    struct LevelInfo {
+    public:
+        LevelInfo() {
+            startX = startY = std::numeric_limits<int>::max();
+            finalX = finalY = std::numeric_limits<int>::min();
+        }
+        int startX, startY;
+        int finalX, finalY;
+
+        inline void add(const TileCoordinate *coordinate) {
+            startX = std::min(startX, (int)coordinate->x);
+            startY = std::min(startY, (int)coordinate->y);
+            finalX = std::max(finalX, (int)coordinate->x);
+            finalY = std::max(finalY, (int)coordinate->y);
+
+        }
+
+        inline void add(const LevelInfo &level) {
+            startX = std::min(startX, level.startX);
+            startY = std::min(startY, level.startY);
+            finalX = std::max(finalX, level.finalX);
+            finalY = std::max(finalY, level.finalY);
+
+        }
+    };
+
+    std::vector<LevelInfo> levels;
+
+    // defines the bounding box covered by the Terrain
+    CRSBounds bounds;
+
+    // add metadata of the specified Coordinate
+    void add(const Grid &grid, const TileCoordinate *coordinate) {
+        CRSBounds tileBounds = grid.tileBounds(*coordinate);
+        i_zoom zoom = coordinate->zoom;
+
+        if ((1 + zoom) > levels.size()) {
+            levels.resize(1 + zoom, LevelInfo());
+        }
+        LevelInfo &level = levels[zoom];
+        level.add(coordinate);
+
+        if (bounds.getMaxX() == bounds.getMinX()) {
+            bounds = tileBounds;
+        } else {
+            bounds.setMinX(std::min(bounds.getMinX(), tileBounds.getMinX()));
+            bounds.setMinY(std::min(bounds.getMinY(), tileBounds.getMinY()));
+            bounds.setMaxX(std::max(bounds.getMaxX(), tileBounds.getMaxX()));
+            bounds.setMaxY(std::max(bounds.getMaxY(), tileBounds.getMaxY()));
+        }
+    }
+
+    // add metadata info
+    void add(const TerrainMetadata &otherMetadata) {
+        if (otherMetadata.levels.size() > 0) {
+            const CRSBounds &otherBounds = otherMetadata.bounds;
+
+            if (otherMetadata.levels.size() > levels.size()) {
+                levels.resize(otherMetadata.levels.size(), LevelInfo());
+            }
+
+            for (size_t i = 0; i < otherMetadata.levels.size(); i++) {
+                levels[i].add(otherMetadata.levels[i]);
+            }
+
+            if (bounds.getMaxX() == bounds.getMinX()) {
+                bounds = otherBounds;
+            } else {
+                bounds.setMinX(std::min(bounds.getMinX(), otherBounds.getMinX()));
+                bounds.setMinY(std::min(bounds.getMinY(), otherBounds.getMinY()));
+                bounds.setMaxX(std::max(bounds.getMaxX(), otherBounds.getMaxX()));
+                bounds.setMaxY(std::max(bounds.getMaxY(), otherBounds.getMaxY()));
+            }
+        }
+    }
+
+    /// output the layer.json metadata file
+    /// https://help.agi.com/TerrainServer/RESTAPIGuide.html
+    /// https://github.com/mapbox/tilejson-spec/tree/master/3.0.0
+    void writeJsonFile(
+        const std::string &filename,
+        const std::string &datasetName,
+        const std::string &outputFormat = "Mesh",
+        const std::string &profile = "geodetic",
+        bool writeVertexNormals = false) const {
+
+        FILE *fp = fopen(filename.c_str(), "w");
+
+        if (fp == NULL) {
+            throw STTException("Failed to open metadata file");
+        }
+
+        fprintf(fp, "{\n");
+        fprintf(fp, "  \"tilejson\": \"3.0.0\",\n");
+        fprintf(fp, "  \"name\": \"%s\"\n", datasetName.c_str());
+
+        fprintf(fp, "}\n");
+        fclose(fp);
+    }
+};
+
+#endif /* TERRAINMETADATA_H_ */
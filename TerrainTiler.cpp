@@ -126,6 +126,70 @@ GDALTile * stt::TerrainTiler::createRasterTile(GDALDataset *dataset,
     return tile;
 }
 
+/**
+* @details neighbouring terrain tiles share their edge rows and columns, so the
+* block is `columns * (tileSize - 1) + 1` pixels wide and each tile starts
+* `tileSize - 1` pixels after its western or northern neighbour. the pixels of
+* every tile are therefore the same as those of the tile on its own.
+*/
+GDALTile * stt::TerrainTiler::createRasterTile(GDALDataset *dataset,
+    const TileCoordinate &coord, i_tile columns, i_tile rows) const
+{
+    // ensure we have some data from which to create a tile
+    if (dataset && dataset->GetRasterCount() < 1) {
+        throw STTException("At least one band must be present in the GDAL dataset");
+    }
+
+    // the block covers the overlapping bounds of its tiles as given by
+    // `rasterGeometry`
+    GDALTile *tile = GDALTiler::createRasterTile(dataset, coord, columns, rows);
+
+    // shift the data to the bounds of the block itself as for a single tile
+    const TileCoordinate northEast(coord.zoom, coord.x + columns - 1, coord.y + rows - 1);
+    const double resolution = mGrid.resolution(coord.zoom);
+    double adfGeoTransform[6];
+    adfGeoTransform[0] = mGrid.tileBounds(coord).getMinX(); // min longitude
+    adfGeoTransform[1] = resolution;
+    adfGeoTransform[2] = 0;
+    adfGeoTransform[3] = mGrid.tileBounds(northEast).getMaxY(); // max latitude
+    adfGeoTransform[4] = 0;
+    adfGeoTransform[5] = -resolution;
+
+    if (GDALSetGeoTransform(tile->dataset, adfGeoTransform) != CE_None) {
+        delete tile;
+        throw STTException("Could not set geo transform on VRT");
+    }
+
+    return tile;
+}
+
+/**
+* @details this is the geometry of the blocks `TerrainTiler::createRasterTile`
+* warps, `columns * (tileSize - 1) + 1` pixels wide.
+*/
+void stt::TerrainTiler::rasterGeometry(const TileCoordinate &coord,
+    i_tile columns, i_tile rows, double (&adfGeoTransform)[6], int &width,
+    int &height) const
+{
+    // the overlapping bounds of the south west and north east tiles
+    double resolution;
+    const TileCoordinate northEast(coord.zoom, coord.x + columns - 1, coord.y + rows - 1);
+    CRSBounds lowerLeft = terrainTileBounds(coord, resolution);
+    CRSBounds upperRight = terrainTileBounds(northEast, resolution);
+
+    // convert the block bounds into a geo transform
+    adfGeoTransform[0] = lowerLeft.getMinX(); // min longitude
+    adfGeoTransform[1] = resolution;
+    adfGeoTransform[2] = 0;
+    adfGeoTransform[3] = upperRight.getMaxY(); // max latitude
+    adfGeoTransform[4] = 0;
+    adfGeoTransform[5] = -resolution;
+
+    const i_tile lTileSize = mGrid.tileSize() - 1;
+    width = lTileSize * columns + 1;
+    height = lTileSize * rows + 1;
+}
+
 TerrainTiler & stt::TerrainTiler::operator=(const TerrainTiler &other)
 {
     GDALTiler::operator=(other);
@@ -52,6 +52,16 @@ protected:
     virtual GDALTile *
     createRasterTile(GDALDataset *dataset, const TileCoordinate &coord) const override;
 
+    /// create a `GDALTile` covering a block of terrain tiles sharing their edges
+    virtual GDALTile *
+    createRasterTile(GDALDataset *dataset, const TileCoordinate &coord,
+        i_tile columns, i_tile rows) const override;
+
+    /// get the geometry of a block of terrain tiles sharing their edges
+    virtual void
+    rasterGeometry(const TileCoordinate &coord, i_tile columns, i_tile rows,
+        double (&adfGeoTransform)[6], int &width, int &height) const override;
+
     /**
      * @brief get terrain bounds shifted to introduce a pixel overlap
      *
@@ -0,0 +1,93 @@
+/**
+ * @file TileArchive.cpp
+ * @brief this defines the `TileArchive` class
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "concat.h"
+#include "STTException.h"
+#include "TileArchive.h"
+
+using namespace stt;
+
+const char stt::TileArchive::magic[8] = { 'S', 'T', 'T', 'A', 'R', 'C', 'H', 'V' };
+
+/**
+* @details the whole file is mapped read only, so the directory and the tiles
+* are read straight from the page cache and only the pages touched by lookups
+* are loaded.
+*/
+stt::TileArchive::TileArchive(const std::string &filename):
+    mFile(NULL),
+    mMapping(NULL),
+    mData(NULL),
+    mHeader(NULL),
+    mEntries(NULL),
+    mCount(0)
+{
+    VSIStatBufL stat;
+    if (VSIStatL(filename.c_str(), &stat) != 0 || (size_t) stat.st_size < sizeof(Header)) {
+        throw STTException(concat("Not a tile archive: ", filename).c_str());
+    }
+
+    if (!CPLIsVirtualMemFileMapAvailable()) {
+        throw STTException("Tile archives need files to be mapped into memory");
+    }
+
+    mFile = VSIFOpenL(filename.c_str(), "rb");
+    if (mFile == NULL) {
+        throw STTException(concat("Could not open the tile archive ", filename).c_str());
+    }
+
+    mMapping = CPLVirtualMemFileMapNew(mFile, 0, stat.st_size, VIRTUALMEM_READONLY, NULL, NULL);
+    if (mMapping == NULL) {
+        VSIFCloseL(mFile);
+        throw STTException(concat("Could not map the tile archive ", filename).c_str());
+    }
+
+    mData = (const unsigned char *) CPLVirtualMemGetAddr(mMapping);
+    mHeader = (const Header *) mData;
+
+    const uint64_t length = stat.st_size;
+    if (memcmp(mHeader->magic, magic, sizeof(magic)) != 0
+            || mHeader->version != version
+            || mHeader->directoryOffset < sizeof(Header)
+            || mHeader->directoryOffset > length
+            || mHeader->tileCount > (length - mHeader->directoryOffset) / sizeof(Entry)) {
+        CPLVirtualMemFree(mMapping);
+        VSIFCloseL(mFile);
+        throw STTException(concat("Not a finished tile archive: ", filename).c_str());
+    }
+
+    mEntries = (const Entry *) (mData + mHeader->directoryOffset);
+    mCount = mHeader->tileCount;
+}
+
+stt::TileArchive::~TileArchive()
+{
+    CPLVirtualMemFree(mMapping);
+    VSIFCloseL(mFile);
+}
+
+const unsigned char *
+stt::TileArchive::tile(const TileCoordinate &coord, size_t &size) const
+{
+    const uint64_t target = key(coord);
+    const Entry *end = mEntries + mCount;
+    const Entry *entry = std::lower_bound(mEntries, end, target,
+        [](const Entry &entry, uint64_t key) { return entry.key < key; });
+
+    if (entry == end || entry->key != target) {
+        size = 0;
+        return NULL;
+    }
+
+    if (entry->offset + entry->size > mHeader->directoryOffset) {
+        throw STTException("Corrupt tile archive");
+    }
+
+    size = entry->size;
+    return mData + entry->offset;
+}
@@ -0,0 +1,131 @@
+#ifndef TILEARCHIVE_H_
+#define TILEARCHIVE_H_
+
+/**
+ * @file TileArchive.h
+ * @brief this declares the `TileArchive` class
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "cpl_vsi.h"
+#include "cpl_virtualmem.h"
+
+#include "config.h"
+#include "TileCoordinate.h"
+#include "SpaceFillingCurve.h"
+
+namespace stt {
+    class TileArchive;
+}
+
+/**
+ * @brief read tiles from a single file archive
+ *
+ * an archive holds the tiles of a tileset in one file, which is written by
+ * `STTArchiveSerializer`. it is laid out as:
+ *
+ * - a `Header`
+ * - the data section: a record for each tile in the order the tiles were
+ *   stored, made of the tile key, the size of the tile and its bytes
+ * - the directory: an `Entry` for each tile pointing at its bytes, sorted by
+ *   key and aligned to 8 bytes
+ *
+ * the key of a tile orders the tiles by zoom level and then along a Hilbert
+ * curve, so tiles close together on the ground are close together in the
+ * directory. the header only points at the directory once the archive is
+ * finished; the records of an unfinished archive still describe its tiles.
+ *
+ * the archive is mapped into memory and a tile is found with a binary search
+ * of the directory, returning a pointer to its bytes in the mapping:
+ *
+ * \code
+ *   TileArchive archive("terrain.stta");
+ *   size_t size;
+ *   const unsigned char *data = archive.tile(TileCoordinate(10, 1700, 800), size);
+ * \endcode
+ *
+ * instances can be shared between threads.
+ */
+class STT_DLL stt::TileArchive
+{
+public:
+    /// the start of an archive
+    struct Header {
+        char magic[8];              /// identifies an archive
+        uint32_t version;           /// the version of the layout
+        uint32_t reserved;
+        uint64_t directoryOffset;   /// the offset of the directory, or `0` until finished
+        uint64_t tileCount;         /// the number of entries in the directory
+        char format[16];            /// the format of the tiles, such as `terrain`
+        char encoding[16];          /// the `Content-Encoding` of the tiles, or empty
+    };
+
+    /// the size of the key and size preceding the bytes of a tile
+    static constexpr size_t recordHeaderSize = sizeof(uint64_t) + sizeof(uint32_t);
+
+    /// the location of a tile in the data section
+    struct Entry {
+        uint64_t key;               /// the key of the tile
+        uint64_t offset;            /// the offset of the bytes of the tile
+        uint32_t size;              /// the number of bytes
+        uint32_t reserved;
+    };
+
+    /// identifies an archive and the version of its layout
+    static const char magic[8];
+    static constexpr uint32_t version = 1;
+
+    /// get the key of a tile: its zoom level and its position along a
+    /// Hilbert curve covering the zoom level
+    static inline uint64_t
+    key(const TileCoordinate &coord) {
+        return ((uint64_t) coord.zoom << 58) |
+            curve::index(curve::HILBERT, coord.zoom + 1, coord.x, coord.y);
+    }
+
+    /// open and map a finished archive, throwing if it is not one
+    TileArchive(const std::string &filename);
+
+    /// the archive owns its mapping so it is not copied
+    TileArchive(const TileArchive &other) = delete;
+    TileArchive &operator=(const TileArchive &other) = delete;
+
+    /// the destructor unmaps the archive
+    ~TileArchive();
+
+    /// get the bytes of a tile and their number, or `NULL` if it is not stored
+    const unsigned char *
+    tile(const TileCoordinate &coord, size_t &size) const;
+
+    /// get the number of tiles stored
+    inline uint64_t
+    size() const {
+        return mCount;
+    }
+
+    /// get the format of the tiles
+    inline std::string
+    format() const {
+        return std::string(mHeader->format, strnlen(mHeader->format, sizeof(mHeader->format)));
+    }
+
+    /// get the `Content-Encoding` of the tiles, which is empty if there is none
+    inline std::string
+    encoding() const {
+        return std::string(mHeader->encoding, strnlen(mHeader->encoding, sizeof(mHeader->encoding)));
+    }
+
+protected:
+    VSILFILE *mFile;                /// the open archive
+    CPLVirtualMem *mMapping;        /// the mapping of the whole archive
+    const unsigned char *mData;     /// the start of the mapping
+    const Header *mHeader;          /// the header in the mapping
+    const Entry *mEntries;          /// the directory in the mapping
+    uint64_t mCount;                /// the number of entries in the directory
+};
+
+#endif /* TILEARCHIVE_H_ */
@@ -0,0 +1,70 @@
+/**
+ * @file TileArena.cpp
+ * @brief this defines the `TileArena` class
+ */
+
+#include "TileArena.h"
+
+using namespace stt;
+
+void
+stt::TileArena::reset()
+{
+    mHeights.used = 0;
+    mLevels.used = 0;
+    mVertexIndices.used = 0;
+}
+
+/**
+* @details the buffers are vectors of vectors: growing the outer vector moves
+* the buffers handed out already without moving their elements.
+*/
+template <typename T>
+T *
+stt::TileArena::next(Buffers<T> &buffers, size_t count)
+{
+    if (buffers.used == buffers.buffers.size()) {
+        buffers.buffers.emplace_back();
+    }
+
+    std::vector<T> &buffer = buffers.buffers[buffers.used++];
+    if (count > buffer.capacity()) {
+        ++mAllocations;
+    }
+    buffer.resize(count);
+
+    return buffer.data();
+}
+
+float *
+stt::TileArena::heights(size_t count)
+{
+    return next(mHeights, count);
+}
+
+uint8_t *
+stt::TileArena::levels(size_t count)
+{
+    return next(mLevels, count);
+}
+
+int *
+stt::TileArena::vertexIndices(size_t count)
+{
+    return next(mVertexIndices, count);
+}
+
+/**
+* @details the mesh is cleared rather than replaced so that its vertices and
+* indices keep their memory.
+*/
+MeshTile &
+stt::TileArena::tile(const TileCoordinate &coord)
+{
+    static_cast<TileCoordinate &>(mTile) = coord;
+    mTile.setAllChildren(false);
+
+    mTile.getMesh().clear();
+
+    return mTile;
+}
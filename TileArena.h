@@ -0,0 +1,95 @@
+#ifndef TILEARENA_H_
+#define TILEARENA_H_
+
+/**
+ * @file TileArena.h
+ * @brief this declares the `TileArena` class
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "config.h"
+#include "MeshTile.h"
+#include "TileCoordinate.h"
+
+namespace stt {
+    class TileArena;
+}
+
+/**
+ * @brief own the scratch buffers of the tiles created by a worker
+ *
+ * creating a mesh tile needs the heights of the tile and its neighbours, a
+ * grid of activation levels for each, the mesh vertex of every grid index and
+ * the mesh itself, all of which are released once the tile is written. an
+ * arena hands out these buffers for one tile at a time and keeps their memory
+ * when it is reset for the next, so once the buffers have grown to the size
+ * of a tile no more are allocated. an arena is used by a single worker.
+ */
+class STT_DLL stt::TileArena
+{
+public:
+    /// create an empty arena
+    TileArena():
+        mAllocations(0)
+    {}
+
+    /// the buffers are handed out by address so the arena is not copied
+    TileArena(const TileArena &other) = delete;
+    TileArena &operator=(const TileArena &other) = delete;
+
+    /// hand every buffer back for the next tile, keeping their memory
+    void
+    reset();
+
+    /// get a buffer of `count` heights, valid until the arena is reset
+    float *
+    heights(size_t count);
+
+    /// get a grid of `count` activation levels, valid until the arena is reset
+    uint8_t *
+    levels(size_t count);
+
+    /// get a buffer for the mesh vertex of `count` grid indices, valid until
+    /// the arena is reset
+    int *
+    vertexIndices(size_t count);
+
+    /// get the empty mesh tile of a coordinate, valid until the arena is reset
+    MeshTile &
+    tile(const TileCoordinate &coord);
+
+    /// get the number of times a buffer had to be allocated or grown
+    inline uint64_t
+    allocations() const {
+        return mAllocations;
+    }
+
+protected:
+    /// buffers of a type handed out in turn
+    template <typename T>
+    struct Buffers {
+        std::vector<std::vector<T>> buffers;    /// the buffers, which keep their memory
+        size_t used = 0;                        /// the number handed out since the reset
+    };
+
+    /// hand out the next buffer of `count` elements, growing it if necessary
+    template <typename T>
+    T *
+    next(Buffers<T> &buffers, size_t count);
+
+    /// the buffers of each type
+    Buffers<float> mHeights;
+    Buffers<uint8_t> mLevels;
+    Buffers<int> mVertexIndices;
+
+    /// the mesh tile, whose mesh keeps its memory
+    MeshTile mTile;
+
+    /// the number of buffers allocated or grown
+    uint64_t mAllocations;
+};
+
+#endif /* TILEARENA_H_ */
@@ -0,0 +1,233 @@
+/**
+ * @file TileCodec.cpp
+ * @brief this defines the `TileCodec` class and its implementations
+ */
+
+#include <cstring>
+
+#include "concat.h"
+#include "STTException.h"
+#include "STTZOutputStream.h"
+#include "TileCodec.h"
+
+#ifdef STT_HAVE_LIBDEFLATE
+#include "libdeflate.h"
+#endif
+#ifdef STT_HAVE_ZSTD
+#include "zstd.h"
+#endif
+#ifdef STT_HAVE_BROTLI
+#include "brotli/encode.h"
+#endif
+
+using namespace stt;
+
+namespace {
+    /// store tiles as they are encoded
+    class IdentityCodec: public TileCodec
+    {
+    public:
+        virtual const char *name() const { return "none"; }
+        virtual const char *extension() const { return ".raw"; }
+        virtual const char *contentEncoding() const { return NULL; }
+
+        virtual void
+        encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const {
+            encoded.resize(size);
+            memcpy(encoded.data(), ptr, size);
+        }
+    };
+
+    /// gzip tiles, which is what clients of quantized mesh tiles expect
+    class GzipCodec: public TileCodec
+    {
+    public:
+        GzipCodec(int level): mLevel(level) {}
+
+        virtual const char *name() const { return "gzip"; }
+        virtual const char *extension() const { return ""; }
+        virtual const char *contentEncoding() const { return "gzip"; }
+
+        virtual void
+        encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const;
+
+    protected:
+        int mLevel;
+    };
+
+    /**
+    * @details libdeflate compresses a whole buffer faster than zlib and offers
+    * higher levels. its compressors hold large tables for their level and are not
+    * thread safe, so each thread keeps one for the last level it used.
+    */
+    void
+    GzipCodec::encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const
+    {
+#ifdef STT_HAVE_LIBDEFLATE
+        struct Compressor {
+            ~Compressor() {
+                if (compressor) libdeflate_free_compressor(compressor);
+            }
+
+            libdeflate_compressor *compressor = NULL;
+            int level = 0;
+        };
+        thread_local Compressor compressor;
+
+        const int level = (mLevel == defaultLevel) ? 6 : mLevel;
+        if (compressor.compressor == NULL || compressor.level != level) {
+            if (compressor.compressor) libdeflate_free_compressor(compressor.compressor);
+            compressor.compressor = libdeflate_alloc_compressor(level);
+            compressor.level = level;
+
+            if (compressor.compressor == NULL) {
+                throw STTException("Failed to initialise compression");
+            }
+        }
+
+        encoded.resize(libdeflate_gzip_compress_bound(compressor.compressor, size));
+        size_t written = libdeflate_gzip_compress(compressor.compressor, ptr, size,
+            encoded.data(), encoded.size());
+
+        if (written == 0) {
+            throw STTException("Failed to compress data");
+        }
+        encoded.resize(written);
+#else
+        STTZOutputStream::compress(ptr, size, encoded,
+            (mLevel == defaultLevel) ? Z_DEFAULT_COMPRESSION : mLevel);
+#endif
+    }
+
+#ifdef STT_HAVE_ZSTD
+    /// compress tiles with Zstandard
+    class ZstdCodec: public TileCodec
+    {
+    public:
+        ZstdCodec(int level): mLevel(level) {}
+
+        virtual const char *name() const { return "zstd"; }
+        virtual const char *extension() const { return ".zst"; }
+        virtual const char *contentEncoding() const { return "zstd"; }
+
+        virtual void
+        encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const;
+
+    protected:
+        int mLevel;
+    };
+
+    /**
+    * @details each thread reuses a compression context rather than creating one
+    * for every tile.
+    */
+    void
+    ZstdCodec::encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const
+    {
+        struct Context {
+            ~Context() {
+                ZSTD_freeCCtx(context);
+            }
+
+            ZSTD_CCtx *context = ZSTD_createCCtx();
+        };
+        thread_local Context context;
+
+        encoded.resize(ZSTD_compressBound(size));
+        size_t written = ZSTD_compressCCtx(context.context, encoded.data(), encoded.size(),
+            ptr, size, (mLevel == defaultLevel) ? ZSTD_CLEVEL_DEFAULT : mLevel);
+
+        if (ZSTD_isError(written)) {
+            throw STTException("Failed to compress data");
+        }
+        encoded.resize(written);
+    }
+#endif
+
+#ifdef STT_HAVE_BROTLI
+    /// compress tiles with Brotli
+    class BrotliCodec: public TileCodec
+    {
+    public:
+        BrotliCodec(int level): mLevel(level) {}
+
+        virtual const char *name() const { return "brotli"; }
+        virtual const char *extension() const { return ".br"; }
+        virtual const char *contentEncoding() const { return "br"; }
+
+        virtual void
+        encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const;
+
+    protected:
+        int mLevel;
+    };
+
+    void
+    BrotliCodec::encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const
+    {
+        size_t written = BrotliEncoderMaxCompressedSize(size);
+        encoded.resize(written);
+
+        if (!BrotliEncoderCompress((mLevel == defaultLevel) ? BROTLI_DEFAULT_QUALITY : mLevel,
+                BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, size, (const uint8_t *)ptr,
+                &written, encoded.data())) {
+            throw STTException("Failed to compress data");
+        }
+        encoded.resize(written);
+    }
+#endif
+
+    /// throw unless a level is the default or within the range of a codec
+    void
+    checkLevel(const std::string &name, int level, int minimum, int maximum)
+    {
+        if (level != TileCodec::defaultLevel && (level < minimum || level > maximum)) {
+            throw STTException(concat("The ", name, " level must be between ",
+                minimum, " and ", maximum).c_str());
+        }
+    }
+}
+
+TileCodec *
+stt::TileCodec::create(const std::string &name, int level)
+{
+    if (name == "gzip") {
+#ifdef STT_HAVE_LIBDEFLATE
+        checkLevel(name, level, 0, 12);
+#else
+        checkLevel(name, level, 0, 9);
+#endif
+        return new GzipCodec(level);
+    }
+
+    if (name == "none") {
+        return new IdentityCodec();
+    }
+
+    if (name == "zstd") {
+#ifdef STT_HAVE_ZSTD
+        checkLevel(name, level, 1, ZSTD_maxCLevel());
+        return new ZstdCodec(level);
+#else
+        throw STTException("Built without zstd compression");
+#endif
+    }
+
+    if (name == "brotli") {
+#ifdef STT_HAVE_BROTLI
+        checkLevel(name, level, BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY);
+        return new BrotliCodec(level);
+#else
+        throw STTException("Built without brotli compression");
+#endif
+    }
+
+    throw STTException(concat("Unknown compression ", name).c_str());
+}
+
+const TileCodec &
+stt::TileCodec::gzip()
+{
+    static const GzipCodec codec(defaultLevel);
+    return codec;
+}
@@ -0,0 +1,68 @@
+#ifndef TILECODEC_H_
+#define TILECODEC_H_
+
+/**
+ * @file TileCodec.h
+ * @brief this declares the `TileCodec` class
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+namespace stt {
+    class TileCodec;
+}
+
+/**
+ * @brief compress encoded tiles in one go
+ *
+ * tiles are served pre-compressed, so the codec decides both the bytes that
+ * are stored and how they are served: a codec names the suffix appended to
+ * the tile files and the `Content-Encoding` they are served with.
+ *
+ * - `gzip`: deflate with a gzip wrapper, levels `0` to `9`, or `0` to `12`
+ *   when built with libdeflate
+ * - `zstd`: Zstandard, levels `1` to `22`, when built with libzstd
+ * - `brotli`: Brotli, levels `0` to `11`, when built with libbrotlienc
+ * - `none`: the tiles are stored as they are encoded, in files with a `.raw`
+ *   suffix so that they are never mistaken for gzipped tiles
+ *
+ * a codec is shared by all threads.
+ */
+class STT_DLL stt::TileCodec
+{
+public:
+    /// the level which selects the default of a codec
+    static const int defaultLevel = -1;
+
+    virtual ~TileCodec() {}
+
+    /// create a codec from its name, throwing if it is unknown or not built
+    static TileCodec *
+    create(const std::string &name, int level = defaultLevel);
+
+    /// get the gzip codec at its default level
+    static const TileCodec &
+    gzip();
+
+    /// get the name of the codec
+    virtual const char *
+    name() const = 0;
+
+    /// get the suffix of the files holding tiles compressed by the codec
+    virtual const char *
+    extension() const = 0;
+
+    /// get the `Content-Encoding` of tiles compressed by the codec, or `NULL`
+    virtual const char *
+    contentEncoding() const = 0;
+
+    /// compress a buffer in one go, replacing the contents of `encoded`
+    virtual void
+    encode(const void *ptr, size_t size, std::vector<unsigned char> &encoded) const = 0;
+};
+
+#endif /* TILECODEC_H_ */
@@ -0,0 +1,257 @@
+/**
+ * @file TileManifest.cpp
+ * @brief this defines the `TileManifest` class
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "concat.h"
+#include "STTException.h"
+#include "TileManifest.h"
+
+using namespace stt;
+
+const char stt::TileManifest::magic[8] = { 'S', 'T', 'T', 'M', 'A', 'N', 'I', 'F' };
+
+/// write the pages of a range of a mapping to its file, returning once they are stored
+static bool
+syncMapping(const void *start, size_t size)
+{
+    const uintptr_t pageSize = CPLGetPageSize();
+    const uintptr_t begin = (uintptr_t) start / pageSize * pageSize;
+    const uintptr_t end = (uintptr_t) start + size;
+
+    return msync((void *) begin, end - begin, MS_SYNC) == 0;
+}
+
+/**
+* @details the levels of a manifest are laid out from the tile bounds of the
+* tiler, so a manifest which is kept has to have exactly the same levels;
+* otherwise its bits would name other tiles. a new manifest is extended to its
+* full length with zeros before it is mapped, which leaves the bitmaps sparse
+* on most file systems until tiles are recorded.
+*/
+stt::TileManifest::TileManifest(const std::string &filename, const GDALTiler &tiler,
+    i_zoom startZoom, i_zoom endZoom, bool resume):
+    mFile(NULL),
+    mMapping(NULL),
+    mHeader(NULL),
+    mLevels(NULL),
+    mBitmap(NULL),
+    mWords(0),
+    mStartZoom(startZoom),
+    mEndZoom(endZoom),
+    mResumed(false)
+{
+    if (startZoom < endZoom) {
+        throw STTException("The manifest starts at a zoom level below its end zoom level");
+    }
+
+    std::vector<Level> levels;
+    const uint64_t bitmapOffset = sizeof(Header) + (uint64_t) (startZoom - endZoom + 1) * sizeof(Level);
+    uint64_t length = bitmapOffset;
+
+    for (i_zoom zoom = startZoom; ; --zoom) {
+        const TileBounds bounds = tiler.tileBoundsForZoom(zoom);
+        const uint64_t tiles = (uint64_t) (bounds.getWidth() + 1) * (bounds.getHeight() + 1);
+
+        Level level;
+        memset(&level, 0, sizeof(level));
+        level.zoom = zoom;
+        level.minX = bounds.getMinX();
+        level.minY = bounds.getMinY();
+        level.maxX = bounds.getMaxX();
+        level.maxY = bounds.getMaxY();
+        level.offset = length;
+        levels.push_back(level);
+
+        length += (tiles + 63) / 64 * sizeof(uint64_t);
+
+        if (zoom == endZoom)
+            break;
+    }
+
+    mWords = (length - bitmapOffset) / sizeof(uint64_t);
+
+    if (!CPLIsVirtualMemFileMapAvailable()) {
+        throw STTException("Tile manifests need files to be mapped into memory");
+    }
+
+    VSIStatBufL stat;
+    mResumed = resume && VSIStatL(filename.c_str(), &stat) == 0;
+
+    if (mResumed) {
+        Header header;
+        std::vector<Level> stored(levels.size());
+
+        mFile = VSIFOpenL(filename.c_str(), "r+b");
+        if (mFile == NULL) {
+            throw STTException(concat("Could not open the tile manifest ", filename).c_str());
+        }
+
+        if ((uint64_t) stat.st_size != length
+                || VSIFReadL(&header, sizeof(header), 1, mFile) != 1
+                || memcmp(header.magic, magic, sizeof(magic)) != 0
+                || header.version != version
+                || header.levelCount != levels.size()
+                || VSIFReadL(stored.data(), sizeof(Level), stored.size(), mFile) != stored.size()
+                || memcmp(stored.data(), levels.data(), levels.size() * sizeof(Level)) != 0) {
+            VSIFCloseL(mFile);
+            throw STTException(concat("The tile manifest ", filename,
+                " was written for other tiles. remove it to start again").c_str());
+        }
+    } else {
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.levelCount = levels.size();
+
+        mFile = VSIFOpenL(filename.c_str(), "w+b");
+        if (mFile == NULL) {
+            throw STTException(concat("Could not create the tile manifest ", filename).c_str());
+        }
+
+        if (VSIFWriteL(&header, sizeof(header), 1, mFile) != 1
+                || VSIFWriteL(levels.data(), sizeof(Level), levels.size(), mFile) != levels.size()
+                || VSIFTruncateL(mFile, length) != 0
+                || VSIFFlushL(mFile) != 0) {
+            VSIFCloseL(mFile);
+            throw STTException(concat("Could not write the tile manifest ", filename).c_str());
+        }
+    }
+
+    mMapping = CPLVirtualMemFileMapNew(mFile, 0, length, VIRTUALMEM_READWRITE, NULL, NULL);
+    if (mMapping == NULL) {
+        VSIFCloseL(mFile);
+        throw STTException(concat("Could not map the tile manifest ", filename).c_str());
+    }
+
+    unsigned char *data = (unsigned char *) CPLVirtualMemGetAddr(mMapping);
+    mHeader = (Header *) data;
+    mLevels = (const Level *) (data + sizeof(Header));
+    mBitmap = (uint64_t *) (data + bitmapOffset);
+
+    mPending.reset(new std::atomic<uint64_t>[mWords]());
+    mDirty.reset(new std::atomic<bool>[(mWords + blockWords - 1) / blockWords]());
+}
+
+stt::TileManifest::~TileManifest()
+{
+    CPLVirtualMemFree(mMapping);
+    VSIFCloseL(mFile);
+}
+
+bool
+stt::TileManifest::locate(const TileCoordinate &coord, size_t &word, uint64_t &mask) const
+{
+    if (coord.zoom > mStartZoom || coord.zoom < mEndZoom)
+        return false;
+
+    const Level &level = mLevels[mStartZoom - coord.zoom];
+    if (coord.x < level.minX || coord.x > level.maxX || coord.y < level.minY || coord.y > level.maxY)
+        return false;
+
+    const uint64_t bit = (uint64_t) (coord.y - level.minY) * (level.maxX - level.minX + 1) + (coord.x - level.minX);
+
+    word = (level.offset - mLevels[0].offset) / sizeof(uint64_t) + bit / 64;
+    mask = (uint64_t) 1 << (bit % 64);
+
+    return true;
+}
+
+bool
+stt::TileManifest::isComplete(const TileCoordinate &coord) const
+{
+    size_t word;
+    uint64_t mask;
+
+    if (!locate(coord, word, mask))
+        return false;
+
+    return std::atomic_ref<uint64_t>(mBitmap[word]).load(std::memory_order_relaxed) & mask;
+}
+
+/**
+* @details the bit is set before the block is marked dirty, so a checkpoint
+* which finds the block clean leaves the bit for the next checkpoint.
+*/
+void
+stt::TileManifest::add(const TileCoordinate &coord)
+{
+    size_t word;
+    uint64_t mask;
+
+    if (!locate(coord, word, mask))
+        return;
+
+    mPending[word].fetch_or(mask, std::memory_order_release);
+    mDirty[word / blockWords].store(true, std::memory_order_release);
+}
+
+/**
+* @details the pending tiles are taken before `flush` is called, so every tile
+* taken was handed to its serializer before the flush started and is stored
+* once it returns. tiles added meanwhile wait for the next checkpoint. if the
+* flush fails the tiles taken are put back and nothing is recorded. only the
+* dirty blocks of the pending bitmap are scanned.
+*
+* the bits are then synced from the mapping to the file, and the header after
+* them, so a checkpoint which returns survives a crash of the machine as well
+* as of the run. only the pages spanning the words taken are synced.
+*/
+uint64_t
+stt::TileManifest::checkpoint(const std::function<void()> &flush)
+{
+    std::lock_guard<std::mutex> lock(mCheckpointMutex);
+
+    std::vector<std::pair<size_t, uint64_t>> taken;
+    const size_t blocks = (mWords + blockWords - 1) / blockWords;
+
+    for (size_t block = 0; block < blocks; ++block) {
+        if (!mDirty[block].exchange(false, std::memory_order_acquire))
+            continue;
+
+        const size_t end = std::min(mWords, (block + 1) * blockWords);
+        for (size_t word = block * blockWords; word < end; ++word) {
+            uint64_t bits = mPending[word].exchange(0, std::memory_order_acquire);
+            if (bits) {
+                taken.push_back(std::make_pair(word, bits));
+            }
+        }
+    }
+
+    try {
+        flush();
+    } catch (...) {
+        for (size_t i = 0; i < taken.size(); ++i) {
+            mPending[taken[i].first].fetch_or(taken[i].second, std::memory_order_relaxed);
+            mDirty[taken[i].first / blockWords].store(true, std::memory_order_relaxed);
+        }
+        throw;
+    }
+
+    uint64_t recorded = 0;
+    for (size_t i = 0; i < taken.size(); ++i) {
+        uint64_t previous = std::atomic_ref<uint64_t>(mBitmap[taken[i].first])
+            .fetch_or(taken[i].second, std::memory_order_relaxed);
+        recorded += std::popcount(taken[i].second & ~previous);
+    }
+
+    mHeader->completed += recorded;
+    ++mHeader->checkpoints;
+
+    if ((!taken.empty() && !syncMapping(mBitmap + taken.front().first,
+                (taken.back().first - taken.front().first + 1) * sizeof(uint64_t)))
+            || !syncMapping(mHeader, sizeof(Header))) {
+        throw STTException("Could not sync the tile manifest");
+    }
+
+    return recorded;
+}
@@ -0,0 +1,157 @@
+#ifndef TILEMANIFEST_H_
+#define TILEMANIFEST_H_
+
+/**
+ * @file TileManifest.h
+ * @brief this declares the `TileManifest` class
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cpl_vsi.h"
+#include "cpl_virtualmem.h"
+
+#include "config.h"
+#include "GDALTiler.h"
+#include "TileCoordinate.h"
+
+namespace stt {
+    class TileManifest;
+}
+
+/**
+ * @brief record the tiles of a run which have been stored
+ *
+ * a manifest holds a bit for every tile of the zoom levels of a run, set once
+ * the tile is safely stored, so that a resumed run can skip the tiles which
+ * are done without looking for them in the output. it is laid out as:
+ *
+ * - a `Header`
+ * - a `Level` for each zoom level from the start zoom down to the end zoom,
+ *   giving the tile bounds of the level and the offset of its bitmap
+ * - the bitmap of each level, a bit for each tile row by row, in 64 bit words
+ *
+ * the file is mapped into memory. tiles are added to a pending bitmap held in
+ * memory as they are stored and only reach the file with a checkpoint, which
+ * first has the tiles pending flushed by their serializer:
+ *
+ * \code
+ *   TileManifest manifest("tiles.manifest", tiler, 14, 0, true);
+ *   if (!manifest.isComplete(coord)) {
+ *     serializer.serializeTile(tile);
+ *     manifest.add(coord);
+ *   }
+ *   manifest.checkpoint([&]() { serializer.flush(); });
+ * \endcode
+ *
+ * so the file only ever lists tiles which are stored, and a run which is
+ * stopped redoes the tiles added since its last checkpoint. instances can be
+ * shared between threads.
+ */
+class STT_DLL stt::TileManifest
+{
+public:
+    /// the start of a manifest
+    struct Header {
+        char magic[8];              /// identifies a manifest
+        uint32_t version;           /// the version of the layout
+        uint32_t levelCount;        /// the number of zoom levels
+        uint64_t completed;         /// the number of tiles recorded
+        uint64_t checkpoints;       /// the number of checkpoints taken
+        uint64_t reserved[4];
+    };
+
+    /// the tiles of a zoom level
+    struct Level {
+        uint32_t zoom;              /// the zoom level
+        uint32_t reserved;
+        uint32_t minX;              /// the tile bounds of the zoom level
+        uint32_t minY;
+        uint32_t maxX;
+        uint32_t maxY;
+        uint64_t offset;            /// the offset of the bitmap of the level
+    };
+
+    /// identifies a manifest and the version of its layout
+    static const char magic[8];
+    static constexpr uint32_t version = 1;
+
+    /// open the manifest of the zoom levels of a tiler from `startZoom` down
+    /// to `endZoom`. when resuming an existing manifest is kept, which has to
+    /// cover the same tiles; otherwise a new manifest is created
+    TileManifest(const std::string &filename, const GDALTiler &tiler,
+        i_zoom startZoom, i_zoom endZoom, bool resume);
+
+    /// the manifest owns its mapping so it is not copied
+    TileManifest(const TileManifest &other) = delete;
+    TileManifest &operator=(const TileManifest &other) = delete;
+
+    /// the destructor unmaps the manifest, dropping the tiles pending
+    ~TileManifest();
+
+    /// get whether a tile was recorded by a checkpoint
+    bool
+    isComplete(const TileCoordinate &coord) const;
+
+    /// add a stored tile, which is recorded by the next checkpoint
+    void
+    add(const TileCoordinate &coord);
+
+    /// record the tiles added so far once `flush` has stored them, syncing
+    /// them to the file before returning the number of tiles recorded
+    uint64_t
+    checkpoint(const std::function<void()> &flush);
+
+    /// get whether the manifest was kept from an earlier run
+    inline bool
+    isResumed() const {
+        return mResumed;
+    }
+
+    /// get the number of tiles recorded
+    inline uint64_t
+    completed() const {
+        return mHeader->completed;
+    }
+
+    /// get the number of checkpoints taken
+    inline uint64_t
+    checkpoints() const {
+        return mHeader->checkpoints;
+    }
+
+protected:
+    /// the number of bitmap words covered by a flag of `mDirty`
+    static constexpr size_t blockWords = 512;
+
+    /// find the word and the bit of a tile, returning `false` if the tile
+    /// is not covered by the manifest
+    bool
+    locate(const TileCoordinate &coord, size_t &word, uint64_t &mask) const;
+
+    VSILFILE *mFile;                /// the open manifest
+    CPLVirtualMem *mMapping;        /// the mapping of the whole manifest
+    Header *mHeader;                /// the header in the mapping
+    const Level *mLevels;           /// the levels in the mapping
+    uint64_t *mBitmap;              /// the bitmaps in the mapping
+    size_t mWords;                  /// the number of words of the bitmaps
+    i_zoom mStartZoom;              /// the zoom levels covered
+    i_zoom mEndZoom;
+    bool mResumed;                  /// whether the manifest was kept
+
+    /// the tiles added since the last checkpoint, laid out as the bitmaps
+    std::unique_ptr<std::atomic<uint64_t>[]> mPending;
+    /// the blocks of `mPending` with tiles added since the last checkpoint
+    std::unique_ptr<std::atomic<bool>[]> mDirty;
+
+    /// one checkpoint is taken at a time
+    std::mutex mCheckpointMutex;
+};
+
+#endif /* TILEMANIFEST_H_ */
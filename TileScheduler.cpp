@@ -0,0 +1,251 @@
+/**
+* @file TileScheduler.cpp
+* @brief this defines the `TileScheduler` class
+*/
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#include "TileScheduler.h"
+
+using namespace stt;
+
+/// ranges are not split below this number of tiles
+static const uint64_t RANGE_GRAIN = 16;
+
+stt::TileScheduler::TileScheduler(unsigned int threadCount):
+    mSize(0),
+    mRemaining(0),
+    mAborted(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        mWorkers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    mStatistics.resize(threadCount);
+}
+
+/**
+* @details the remaining tiles of the iterator are cut into one contiguous
+* range of tile indices per worker.
+*/
+void
+stt::TileScheduler::schedule(const GridIterator &iter)
+{
+    const unsigned int workers = threadCount();
+    const i_tile_index begin = iter.getIndex();
+    const i_tile_index count = iter.getEndIndex() - begin;
+
+    mIterators.push_back(iter);
+
+    for (unsigned int i = 0; i < workers; ++i) {
+        TileRange range = {
+            mIterators.size() - 1,
+            begin + ((count * i) / workers),
+            begin + ((count * (i + 1)) / workers)
+        };
+
+        if (range.size() == 0)
+            continue;
+
+        Worker &worker = *mWorkers[i];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.ranges.push_back(range);
+
+        mSize += range.size();
+        mRemaining += range.size();
+    }
+}
+
+void
+stt::TileScheduler::run(const TileTask &task)
+{
+    mAborted = false;
+    mStatistics.assign(threadCount(), WorkerStatistics());
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < threadCount(); ++i) {
+        threads.push_back(std::thread([this, i, &task]() {
+            try {
+                work(i, task);
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(mErrorMutex);
+                    if (!mError) {
+                        mError = std::current_exception();
+                    }
+                    mAborted = true;
+                }
+                notifyWorkers();
+            }
+        }));
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    mIterators.clear();
+
+    if (mError) {
+        // discard whatever is left so the scheduler can be reused
+        for (size_t i = 0; i < mWorkers.size(); ++i) {
+            mWorkers[i]->ranges.clear();
+        }
+        mRemaining = 0;
+
+        std::exception_ptr error = mError;
+        mError = NULL;
+        std::rethrow_exception(error);
+    }
+}
+
+void
+stt::TileScheduler::printStatistics(std::ostream &stream) const
+{
+    uint64_t totalTiles = 0;
+    double totalSeconds = 0;
+
+    stream << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < mStatistics.size(); ++i) {
+        const WorkerStatistics &stats = mStatistics[i];
+        double rate = (stats.seconds > 0) ? stats.tiles / stats.seconds : 0;
+
+        stream << "thread " << i << ": " << stats.tiles << " tiles in "
+               << stats.seconds << "s (" << rate << " tiles/s), "
+               << stats.steals << " ranges stolen\n";
+
+        totalTiles += stats.tiles;
+        totalSeconds += stats.seconds;
+    }
+
+    double meanRate = (totalSeconds > 0) ? totalTiles / totalSeconds : 0;
+    stream << "total: " << totalTiles << " tiles, " << meanRate
+           << " tiles/s per thread\n";
+}
+
+bool
+stt::TileScheduler::popRange(unsigned int worker, TileRange &range)
+{
+    Worker &owner = *mWorkers[worker];
+    std::lock_guard<std::mutex> lock(owner.mutex);
+
+    if (owner.ranges.empty())
+        return false;
+
+    range = owner.ranges.back();
+    owner.ranges.pop_back();
+
+    return true;
+}
+
+bool
+stt::TileScheduler::stealRange(unsigned int thief, TileRange &range)
+{
+    const unsigned int workers = threadCount();
+
+    for (unsigned int i = 1; i < workers; ++i) {
+        Worker &victim = *mWorkers[(thief + i) % workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.ranges.empty()) {
+            range = victim.ranges.front();
+            victim.ranges.pop_front();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+* @details the second half is pushed onto the back of the worker's deque, so
+* the worker itself carries on in iteration order while the queued halves
+* remain available for stealing.
+*/
+bool
+stt::TileScheduler::splitRange(unsigned int worker, TileRange &range)
+{
+    if (range.size() <= RANGE_GRAIN)
+        return false;
+
+    TileRange rest = range;
+    range.end = rest.begin = range.begin + (range.size() / 2);
+
+    {
+        Worker &owner = *mWorkers[worker];
+        std::lock_guard<std::mutex> lock(owner.mutex);
+        owner.ranges.push_back(rest);
+    }
+    notifyWorkers();
+
+    return true;
+}
+
+/**
+* @details the lock is taken so that a worker which has just failed to steal
+* under it is already waiting, and so is woken.
+*/
+void
+stt::TileScheduler::notifyWorkers()
+{
+    std::lock_guard<std::mutex> lock(mIdleMutex);
+    mWorkAvailable.notify_all();
+}
+
+/**
+* @details a worker's own deque is only filled by the worker itself, so once
+* it is empty an idle worker only looks for ranges to steal. it looks again
+* with the idle lock held before waiting, which a worker splitting off a range
+* or finishing the last one takes to wake it, so no wake up is missed.
+*/
+void
+stt::TileScheduler::work(unsigned int worker, const TileTask &task)
+{
+    WorkerStatistics &stats = mStatistics[worker];
+    TileRange range;
+
+    while (!mAborted) {
+        if (!popRange(worker, range)) {
+            bool stolen = stealRange(worker, range);
+
+            if (!stolen) {
+                // other workers may still split off more work
+                std::unique_lock<std::mutex> lock(mIdleMutex);
+                while (!(stolen = stealRange(worker, range)) && !mAborted && mRemaining > 0) {
+                    mWorkAvailable.wait(lock);
+                }
+            }
+
+            if (!stolen)
+                break;
+
+            ++stats.steals;
+        }
+
+        while (splitRange(worker, range)) {}
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        GridIterator iter(mIterators[range.iterator]);
+
+        for (iter.setRange(range.begin, range.end); !iter.exhausted() && !mAborted; ++iter) {
+            task(worker, **iter);
+            ++stats.tiles;
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        stats.seconds += elapsed.count();
+
+        if ((mRemaining -= range.size()) == 0) {
+            notifyWorkers();
+        }
+    }
+}
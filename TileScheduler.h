@@ -0,0 +1,168 @@
+#ifndef TILESCHEDULER_H_
+#define TILESCHEDULER_H_
+
+/**
+ * @file TileScheduler.h
+ * @brief this declares the `TileScheduler` class
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "config.h"
+#include "types.h"
+#include "TileCoordinate.h"
+#include "GridIterator.h"
+
+namespace stt {
+    struct TileRange;
+    class TileScheduler;
+}
+
+/// a contiguous run of tiles from a scheduled iteration
+struct stt::TileRange {
+    size_t iterator;        /// the scheduled iterator the tiles belong to
+    i_tile_index begin;     /// the index of the first tile in the range
+    i_tile_index end;       /// the index after the last tile in the range
+
+    /// the number of tiles in the range
+    inline uint64_t
+    size() const {
+        return end - begin;
+    }
+};
+
+/**
+ * @brief distribute tiles over a pool of worker threads
+ *
+ * the tiles represented by a `GridIterator` are split into `TileRange`s of
+ * tile indices which are dealt out to a deque owned by each worker. a worker
+ * processes its own deque from the back, splitting large ranges in half and
+ * pushing the remainder back so that it stays available to others. when a
+ * worker runs out of ranges it steals from the front of another worker's
+ * deque, which is where the largest ranges are. the tiles of a range are
+ * visited by seeking a copy of the iterator straight to the start of the
+ * range. this keeps all threads busy without any global lock being taken per
+ * tile. a worker which finds nothing to steal sleeps until another worker
+ * splits off a range or the last range is done:
+ *
+ * \code
+ *   TileScheduler scheduler(threadCount);
+ *   scheduler.schedule(MeshIterator(tiler));
+ *   scheduler.run([&](unsigned int worker, const TileCoordinate &coord) {
+ *     // create the tile for `coord` using resources owned by `worker`
+ *   });
+ * \endcode
+ *
+ * the first exception thrown by a task stops all workers and is rethrown
+ * from `TileScheduler::run`.
+ */
+class STT_DLL stt::TileScheduler
+{
+public:
+    /// the function called for every tile with the index of the worker thread
+    typedef std::function<void(unsigned int, const TileCoordinate &)> TileTask;
+
+    /// what a single worker thread has done during a run
+    struct WorkerStatistics {
+        uint64_t tiles = 0;     /// the number of tiles processed
+        uint64_t steals = 0;    /// the number of ranges stolen from other workers
+        double seconds = 0;     /// the time spent processing tiles
+    };
+
+    /// create a scheduler with a number of threads (`0` uses all cores)
+    TileScheduler(unsigned int threadCount = 0);
+
+    /// queue the tiles represented by an iterator from its current position
+    void
+    schedule(const GridIterator &iter);
+
+    /// process all queued tiles, returning once they are done
+    void
+    run(const TileTask &task);
+
+    /// get the number of worker threads
+    inline unsigned int
+    threadCount() const {
+        return mWorkers.size();
+    }
+
+    /// get the number of tiles queued by `TileScheduler::schedule`
+    inline uint64_t
+    size() const {
+        return mSize;
+    }
+
+    /// get the statistics for each worker from the last run
+    inline const std::vector<WorkerStatistics> &
+    statistics() const {
+        return mStatistics;
+    }
+
+    /// write the tiles per second achieved by each worker
+    void
+    printStatistics(std::ostream &stream) const;
+
+protected:
+    /// the ranges owned by a worker
+    struct Worker {
+        std::mutex mutex;
+        std::deque<TileRange> ranges;
+    };
+
+    /// take a range from the back of a worker's own deque
+    bool
+    popRange(unsigned int worker, TileRange &range);
+
+    /// take a range from the front of another worker's deque
+    bool
+    stealRange(unsigned int thief, TileRange &range);
+
+    /// split a range, leaving the first half in `range` and queuing the rest
+    bool
+    splitRange(unsigned int worker, TileRange &range);
+
+    /// wake the workers waiting for a range to steal
+    void
+    notifyWorkers();
+
+    /// the loop run by each worker thread
+    void
+    work(unsigned int worker, const TileTask &task);
+
+    /// the workers and their deques
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    /// the iterators the queued ranges refer to
+    std::vector<GridIterator> mIterators;
+
+    /// the statistics gathered for each worker
+    std::vector<WorkerStatistics> mStatistics;
+
+    /// the total number of tiles queued
+    uint64_t mSize;
+
+    /// the number of tiles that still have to be processed
+    std::atomic<uint64_t> mRemaining;
+
+    /// set when a task has failed and the workers should stop
+    std::atomic<bool> mAborted;
+
+    /// idle workers wait here for ranges to be split off
+    std::mutex mIdleMutex;
+    std::condition_variable mWorkAvailable;
+
+    /// the first exception thrown by a task
+    std::exception_ptr mError;
+    std::mutex mErrorMutex;
+};
+
+#endif /* TILESCHEDULER_H_ */
@@ -0,0 +1,188 @@
+/**
+ * @file TransformerCache.cpp
+ * @brief this defines the `TransformerCache` class
+ */
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "gdal_alg.h"
+#include "cpl_string.h"
+
+#include "TransformerCache.h"
+
+using namespace stt;
+
+namespace {
+    /// a transformer created by the thread
+    struct Entry {
+        GDALDatasetH source;    /// the dataset the transformer was created for,
+                                /// or `NULL` once it has been closed
+        int overviewLevel;      /// the overview of the dataset, or `-1`
+        std::string options;    /// the transformer options, one per line
+        void *transformer;
+        bool inUse;             /// whether the transformer has been acquired
+    };
+
+    /// the transformers of a thread, destroyed when it exits
+    struct Cache {
+        std::vector<Entry> entries;
+
+        ~Cache() {
+            for (size_t i = 0; i < entries.size(); ++i) {
+                GDALDestroyGenImgProjTransformer(entries[i].transformer);
+            }
+        }
+    };
+
+    /// the most transformers kept by a thread
+    const size_t maxEntries = 16;
+
+    thread_local Cache cache;
+
+    std::atomic<uint64_t> hitCount {0};
+    std::atomic<uint64_t> missCount {0};
+
+    /// take the transformers of a dataset out of the thread's cache,
+    /// destroying those not in use and leaving the rest to `release`
+    void
+    dropDataset(GDALDatasetH hSrcDS) {
+        std::vector<Entry> &entries = cache.entries;
+
+        for (size_t i = 0; i < entries.size();) {
+            if (entries[i].source != hSrcDS) {
+                ++i;
+            } else if (entries[i].inUse) {
+                entries[i].source = NULL;
+                ++i;
+            } else {
+                GDALDestroyGenImgProjTransformer(entries[i].transformer);
+                entries.erase(entries.begin() + i);
+            }
+        }
+    }
+
+    /// join the transformer options into a key
+    std::string
+    joinOptions(char **options) {
+        std::string joined;
+
+        for (char **option = options; option && *option; ++option) {
+            joined += *option;
+            joined += '\n';
+        }
+
+        return joined;
+    }
+}
+
+/**
+* @details the key includes the source dataset handle, which is only unique
+* while the dataset is open: a handle opened later may get the same address.
+* the transformers of a dataset are therefore dropped by `releaseDataset`
+* before it is closed. if the cache is full of transformers in use, a
+* transformer is created that isn't cached; `release` destroys it.
+*/
+void *
+stt::TransformerCache::acquire(GDALDatasetH hSrcDS, GDALDatasetH hWrkSrcDS,
+    int overviewLevel, char **options)
+{
+    const std::string key = joinOptions(options);
+    std::vector<Entry> &entries = cache.entries;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Entry &entry = entries[i];
+
+        if (!entry.inUse && entry.source == hSrcDS &&
+            entry.overviewLevel == overviewLevel && entry.options == key) {
+            entry.inUse = true;
+            ++hitCount;
+            return entry.transformer;
+        }
+    }
+
+    void *transformer = GDALCreateGenImgProjTransformer2(hWrkSrcDS, NULL, options);
+    if (transformer == NULL) {
+        return NULL;
+    }
+    ++missCount;
+
+    // make room by destroying the oldest transformer not in use
+    if (entries.size() >= maxEntries) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!entries[i].inUse) {
+                GDALDestroyGenImgProjTransformer(entries[i].transformer);
+                entries.erase(entries.begin() + i);
+                break;
+            }
+        }
+    }
+
+    if (entries.size() < maxEntries) {
+        Entry entry = { hSrcDS, overviewLevel, key, transformer, true };
+        entries.push_back(entry);
+    }
+
+    return transformer;
+}
+
+void
+stt::TransformerCache::release(void *transformer)
+{
+    std::vector<Entry> &entries = cache.entries;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].transformer == transformer) {
+            if (entries[i].source != NULL) {
+                entries[i].inUse = false;
+                return;
+            }
+
+            // its dataset was released while it was in use
+            entries.erase(entries.begin() + i);
+            break;
+        }
+    }
+
+    GDALDestroyGenImgProjTransformer(transformer);
+}
+
+void
+stt::TransformerCache::discard(void *transformer)
+{
+    std::vector<Entry> &entries = cache.entries;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].transformer == transformer) {
+            entries.erase(entries.begin() + i);
+            break;
+        }
+    }
+
+    GDALDestroyGenImgProjTransformer(transformer);
+}
+
+/**
+* @details a dataset is closed by the thread which warped it or once that
+* thread has exited, as with the overviews of `GDALTiler::releaseOverviews`,
+* so only the calling thread can hold transformers for it: those of a thread
+* which has exited were destroyed with its cache. no lock is taken.
+*/
+void
+stt::TransformerCache::releaseDataset(GDALDatasetH hSrcDS)
+{
+    dropDataset(hSrcDS);
+}
+
+uint64_t
+stt::TransformerCache::hits()
+{
+    return hitCount;
+}
+
+uint64_t
+stt::TransformerCache::misses()
+{
+    return missCount;
+}
@@ -0,0 +1,76 @@
+#ifndef TRANSFORMERCACHE_H_
+#define TRANSFORMERCACHE_H_
+
+/**
+ * @file TransformerCache.h
+ * @brief this declares the `TransformerCache` class
+ */
+
+#include <cstdint>
+
+#include "gdal.h"
+
+#include "config.h"
+
+namespace stt {
+    class TransformerCache;
+}
+
+/**
+ * @brief reuse image to image transformers between the tiles of a thread
+ *
+ * creating a `GDALCreateGenImgProjTransformer2` transformer which reprojects
+ * means PROJ parsing both reference systems and building a pipeline between
+ * them, which costs far more than warping a tile. the transformer only
+ * depends on the source dataset and its overview level though, with the
+ * destination geotransform being set separately for each tile. every thread
+ * therefore keeps the transformers it has created for reuse by its later
+ * tiles:
+ *
+ * \code
+ *   void *transformer = TransformerCache::acquire(hSrcDS, hWrkSrcDS, -1, options);
+ *   GDALSetGenImgProjTransformerDstGeoTransform(transformer, adfGeoTransform);
+ *   // warp with the transformer
+ *   TransformerCache::release(transformer);
+ * \endcode
+ *
+ * a transformer is only handed to one user at a time, so it can only be used
+ * by something whose lifetime the caller controls, such as a VRT wrapping it
+ * in an approximate transformer. transformers released by a thread are
+ * destroyed when the thread exits. a transformer is cached by the handle of
+ * its dataset, so `TransformerCache::releaseDataset` has to be called before
+ * the dataset is closed, which `GDALTiler::releaseOverviews` does. a dataset
+ * is closed by the thread which warped it or once that thread has exited.
+ */
+class STT_DLL stt::TransformerCache
+{
+public:
+    /// get a transformer for a dataset at an overview level (`-1` for none),
+    /// creating it from `hWrkSrcDS` with the transformer options if needed
+    static void *
+    acquire(GDALDatasetH hSrcDS, GDALDatasetH hWrkSrcDS, int overviewLevel,
+        char **options);
+
+    /// hand a transformer back for reuse by the thread
+    static void
+    release(void *transformer);
+
+    /// take a transformer out of the cache, destroying it
+    static void
+    discard(void *transformer);
+
+    /// destroy the transformers of the calling thread for a dataset about to
+    /// be closed
+    static void
+    releaseDataset(GDALDatasetH hSrcDS);
+
+    /// get the number of transformers reused over all threads
+    static uint64_t
+    hits();
+
+    /// get the number of transformers created over all threads
+    static uint64_t
+    misses();
+};
+
+#endif /* TRANSFORMERCACHE_H_ */
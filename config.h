@@ -25,6 +25,11 @@
 #endif // defined(_MSC_VER)
 #endif // STT_DLL
 
+/* the optional libraries compressing tiles */
+/* #undef STT_HAVE_LIBDEFLATE */
+/* #undef STT_HAVE_ZSTD */
+/* #undef STT_HAVE_BROTLI */
+
 #include <string>
 #include <sstream>
 
@@ -5,17 +5,33 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <memory>
 
 #include "boost/program_options.hpp"
 #include "gdal_priv.h"
 
 #include "GDALDatasetReader.h"
+#include "GDALDatasetPool.h"
+#include "HeightFieldStore.h"
+#include "HeightFieldCache.h"
+#include "TransformerCache.h"
+#include "TileArena.h"
+#include "TileCodec.h"
+#include "TileManifest.h"
+#include "TerrainMetadata.h"
+#include "MosaicIndex.h"
 #include "GlobalMercator.h"
 #include "RasterIterator.h"
 // #include "TerrainIterator.h"
 #include "MeshIterator.h"
 // #include "GDALDatasetReader.h"
 #include "STTFileTileSerializer.h"
+#include "STTMBTilesSerializer.h"
+#include "STTArchiveSerializer.h"
+#include "STTManifestSerializer.h"
+#include "TileScheduler.h"
+#include "MeshPipeline.h"
 // #include "RasterTiler.h"
 
 using namespace stt;
@@ -27,6 +43,30 @@ struct paramsStruct {
     fs::path outputDir;
     std::string profile;
     int threadCount;
+    bool pipeline;
+    int readThreads;
+    int encodeThreads;
+    int compressThreads;
+    int writeThreads;
+    int ioThreads;
+    int ioMemory;
+    fs::path mbtiles;
+    fs::path archive;
+    int mbtilesBatchSize;
+    std::string compression;
+    int compressionLevel;
+    int cacheSize;
+    int batchSize;
+    bool directWarp;
+    bool alignedRead;
+    bool mapRaster;
+    bool mosaic;
+    fs::path mosaicIndex;
+    bool bottomUp;
+    int pyramidMemory;
+    int heightFieldCacheSize;
+    std::string tileOrderName;
+    TileOrder tileOrder;
     int tileSize;
     int startZoom;
     int endZoom;
@@ -37,6 +77,8 @@ struct paramsStruct {
     bool quiet;
     bool verbose;
     bool resume;
+    fs::path manifest;
+    int manifestInterval;
     std::string outputFormat;
     bool metadata;
 };
@@ -63,6 +105,141 @@ paramsStruct parseOptions(int argc, char *argv[])
             po::value<std::string>(&params.outputFormat)->default_value("Mesh"),
             "specify the output format for the tiles. this is either `Terrain` (the default), `Mesh` (Chunked LOD mesh), or any format listed by `gdalinfo --formats`"
         )
+        (
+            "threads,t",
+            po::value<int>(&params.threadCount)->default_value(0),
+            "the number of threads used to create tiles. `0` (the default) uses all available cores"
+        )
+        (
+            "pipeline",
+            po::value<bool>(&params.pipeline)->default_value(false),
+            "read, chunk, encode, compress and write tiles in separate stages running concurrently. `--threads` sets the number of chunk threads"
+        )
+        (
+            "read-threads",
+            po::value<int>(&params.readThreads)->default_value(2),
+            "the number of threads reading tile heights in the pipeline"
+        )
+        (
+            "encode-threads",
+            po::value<int>(&params.encodeThreads)->default_value(1),
+            "the number of threads encoding tiles in the pipeline"
+        )
+        (
+            "compress-threads",
+            po::value<int>(&params.compressThreads)->default_value(1),
+            "the number of threads compressing tiles in the pipeline"
+        )
+        (
+            "write-threads",
+            po::value<int>(&params.writeThreads)->default_value(1),
+            "the number of threads writing tiles in the pipeline"
+        )
+        (
+            "io-threads",
+            po::value<int>(&params.ioThreads)->default_value(0),
+            "the number of threads writing tiles to the output directory, so that the threads creating tiles do not wait for the file system. `0` (the default) writes each tile from the thread creating it"
+        )
+        (
+            "io-memory",
+            po::value<int>(&params.ioMemory)->default_value(256),
+            "the memory in MB of tiles waiting for the `--io-threads`. the threads creating tiles wait once this is used"
+        )
+        (
+            "mbtiles",
+            po::value<fs::path>(&params.mbtiles),
+            "store the tiles in this MBTiles file instead of a file per tile in the output directory"
+        )
+        (
+            "mbtiles-batch-size",
+            po::value<int>(&params.mbtilesBatchSize)->default_value(1000),
+            "the number of tiles written to the MBTiles file by each transaction"
+        )
+        (
+            "archive",
+            po::value<fs::path>(&params.archive),
+            "store the tiles in this single file archive instead of a file per tile in the output directory"
+        )
+        (
+            "resume",
+            po::value<bool>(&params.resume)->default_value(false),
+            "skip the tiles stored by an earlier run into the same output"
+        )
+        (
+            "manifest",
+            po::value<fs::path>(&params.manifest),
+            "the file recording the tiles which are stored, which lets `--resume` skip them without looking for them. this defaults to `tiles.manifest` in the output directory, or the `--mbtiles` or `--archive` file with a `.manifest` suffix"
+        )
+        (
+            "manifest-interval",
+            po::value<int>(&params.manifestInterval)->default_value(60),
+            "the seconds between recording the tiles stored in the manifest. a resumed run redoes the tiles of up to this long. `0` disables the manifest"
+        )
+        (
+            "compression",
+            po::value<std::string>(&params.compression)->default_value("gzip"),
+            "specify how tiles are compressed. this is either `gzip` (the default), `zstd`, `brotli` or `none`. tiles compressed with zstd or brotli get a `.zst` or `.br` suffix"
+        )
+        (
+            "compression-level",
+            po::value<int>(&params.compressionLevel)->default_value(TileCodec::defaultLevel),
+            "the compression level, from `0` to `9` for gzip (`12` when built with libdeflate), `1` to `22` for zstd and `0` to `11` for brotli. `-1` (the default) uses the default of the compression"
+        )
+        (
+            "cache-size",
+            po::value<int>(&params.cacheSize)->default_value(0),
+            "the size in MB of the raster block cache shared by all threads. `0` (the default) uses the GDAL default"
+        )
+        (
+            "batch-size",
+            po::value<int>(&params.batchSize)->default_value(1),
+            "warp blocks of up to this many tiles square from the source at once and cut the tiles out of them. `1` (the default) warps every tile on its own. a block is only kept while its neighbours are created, so a size above `1` needs the `morton` or `hilbert` tile order and uses `hilbert` unless another is given"
+        )
+        (
+            "direct-warp",
+            po::value<bool>(&params.directWarp)->default_value(false),
+            "warp the heights of each tile straight into memory instead of reading them from a warped VRT"
+        )
+        (
+            "aligned-read",
+            po::value<bool>(&params.alignedRead)->default_value(true),
+            "read sources in the grid SRS with axis aligned pixels by resampling them with RasterIO rather than warping them"
+        )
+        (
+            "mmap",
+            po::value<bool>(&params.mapRaster)->default_value(false),
+            "sample heights straight from uncompressed sources mapped into memory, bypassing the GDAL block cache"
+        )
+        (
+            "mosaic",
+            po::value<bool>(&params.mosaic)->default_value(false),
+            "treat the input as a mosaic of rasters, either a directory of them or a file listing one per line, warping each tile only from the rasters it intersects"
+        )
+        (
+            "mosaic-index",
+            po::value<fs::path>(&params.mosaicIndex),
+            "the file caching the footprints of the mosaic rasters between runs. this defaults to `mosaic.idx` in the output directory"
+        )
+        (
+            "bottom-up",
+            po::value<bool>(&params.bottomUp)->default_value(false),
+            "only read the start zoom level from the source, deriving the heights of lower zoom levels from their child tiles"
+        )
+        (
+            "pyramid-memory",
+            po::value<int>(&params.pyramidMemory)->default_value(1024),
+            "the memory in MB used to keep child tile heights when building bottom up. the rest are spilled to a temporary file"
+        )
+        (
+            "heightfield-cache",
+            po::value<int>(&params.heightFieldCacheSize)->default_value(1024),
+            "the number of tile heightfields kept for stitching neighbouring tiles together. `0` disables the cache"
+        )
+        (
+            "tile-order",
+            po::value<std::string>(&params.tileOrderName)->default_value("column"),
+            "specify the order tiles are created in within a zoom level. this is either `column` (the default), `row`, `morton` or `hilbert`. a `batch-size` above `1` defaults to `hilbert` and can't be used with `column` or `row`"
+        )
         (
             "verbose,v",
             po::value<bool>(&params.verbose)->default_value(false),
@@ -105,159 +282,44 @@ paramsStruct parseOptions(int argc, char *argv[])
     return params;
 }
 
-/// handle the terrain metadata
-class TerrainMetadata
-{
-public:
-    TerrainMetadata() {}
-
-    // defines the valid tile indices of a level in a Tileset
-    struct LevelInfo {
-    public:
-        LevelInfo() {
-            startX = startY = std::numeric_limits<int>::max();
-            finalX = finalY = std::numeric_limits<int>::min();
-        }
-        int startX, startY;
-        int finalX, finalY;
-
-        inline void add(const TileCoordinate *coordinate) {
-            startX = std::min(startX, (int)coordinate->x);
-            startY = std::min(startY, (int)coordinate->y);
-            finalX = std::max(finalX, (int)coordinate->x);
-            finalY = std::max(finalY, (int)coordinate->y);
-
-        }
-
-        inline void add(const LevelInfo &level) {
-            startX = std::min(startX, level.startX);
-            startY = std::min(startY, level.startY);
-            finalX = std::max(finalX, level.startX);
-            finalY = std::max(finalY, level.startY);
-
-        }
-    };
-
-    std::vector<LevelInfo> levels;
-
-    // defines the bounding box covered by the Terrain
-    CRSBounds bounds;
-
-    // add metadata of the specified Coordinate
-    void add(const Grid &grid, const TileCoordinate *coordinate) {
-        CRSBounds tileBounds = grid.tileBounds(*coordinate);
-        i_zoom zoom = coordinate->zoom;
-
-        if ((1 + zoom) > levels.size()) {
-            levels.resize(1 + zoom, LevelInfo());
-        }
-        LevelInfo &level = levels[zoom];
-        level.add(coordinate);
-
-        if (bounds.getMaxX() == bounds.getMinX()) {
-            bounds = tileBounds;
-        } else {
-            bounds.setMinX(std::min(bounds.getMinX(), tileBounds.getMinX()));
-            bounds.setMinY(std::min(bounds.getMinY(), tileBounds.getMinY()));
-            bounds.setMaxX(std::max(bounds.getMaxX(), tileBounds.getMaxX()));
-            bounds.setMaxY(std::max(bounds.getMaxY(), tileBounds.getMaxY()));
-        }
-    }
-
-    // add metadata info
-    void add(const TerrainMetadata &otherMetadata) {
-        if (otherMetadata.levels.size() > 0) {
-            const CRSBounds &otherBounds = otherMetadata.bounds;
-
-            if (otherMetadata.levels.size() > levels.size()) {
-                levels.resize(otherMetadata.levels.size(), LevelInfo());
-            }
-
-            for (size_t i = 0; i < otherMetadata.levels.size(); i++) {
-                levels[i].add(otherMetadata.levels[i]);
-            }
-
-            bounds.setMinX(std::min(bounds.getMinX(), otherBounds.getMinX()));
-            bounds.setMinY(std::min(bounds.getMinY(), otherBounds.getMinY()));
-            bounds.setMaxX(std::max(bounds.getMaxX(), otherBounds.getMaxX()));
-            bounds.setMaxY(std::max(bounds.getMaxY(), otherBounds.getMaxY()));
-        }
-    }
-
-    /// output the layer.json metadata file
-    /// https://help.agi.com/TerrainServer/RESTAPIGuide.html
-    /// https://github.com/mapbox/tilejson-spec/tree/master/3.0.0
-    void writeJsonFile(
-        const std::string &filename,
-        const std::string &datasetName,
-        const std::string &outputFormat = "Mesh",
-        const std::string &profile = "geodetic",
-        bool writeVertexNormals = false) const {
-
-        FILE *fp = fopen(filename.c_str(), "w");
-
-        if (fp == NULL) {
-            throw STTException("Failed to open metadata file");
-        }
-
-        fprintf(fp, "{\n");
-        fprintf(fp, "  \"tilejson\": \"3.0.0\",\n");
-        fprintf(fp, "  \"name\": \"%s\"\n", datasetName.c_str());
-
-        fprintf(fp, "}\n");
-        fclose(fp);
-    }
-};
-
-/*
-* increment a TilerIterator whilst cooperating between threads
-*
-* this function maintains a global index on an iterator and when called
-* ensures the iterator is incremented to point to the next global index. this
-* can therefore be called with different tiler iterators by different threads
-* to ensure all tiles are iterated over consecutively. it assumes individual
-* tile iterators point to the same source GDAL dataset.
-*/
-static int globalIteratorIndex {0}; // keep track of where we are globally
-template<typename T> int incrementIterator(T &iter, int currentIndex)
+/// convert the name of a tile order to a `TileOrder`
+static bool
+parseTileOrder(const std::string &name, TileOrder &order)
 {
-    static std::mutex mutex; // ensure iterations occure serially between threads
-    std::lock_guard<std::mutex> lock(mutex);
-
-    while (currentIndex < globalIteratorIndex) {
-        ++iter;
-        ++currentIndex;
+    if (name == "column") {
+        order = TILE_ORDER_COLUMN;
+    } else if (name == "row") {
+        order = TILE_ORDER_ROW;
+    } else if (name == "morton") {
+        order = TILE_ORDER_MORTON;
+    } else if (name == "hilbert") {
+        order = TILE_ORDER_HILBERT;
+    } else {
+        return false;
     }
-    ++globalIteratorIndex;
 
-    return currentIndex;
+    return true;
 }
 
-/// get a handle on the total number of tiles to be created
-static int iteratorSize = 0; // the total number of tiles
-template<typename T> void setIteratorSize(T &iter)
-{
-    static std::mutex mutex;
-    std::lock_guard<std::mutex> lock(mutex);
-
-    if (iteratorSize == 0) {
-        iteratorSize = iter.getSize();
-    }
-}
+/// the total number of tiles to be created
+static uint64_t iteratorSize = 0;
 
 /// a thread safe wrapper around `GDALTermProgress`
 static int CPL_STDCALL termProgress(double dfComplete, const char *pszMessage,
                                     void *pProgressArg)
 {
     static std::mutex mutex;
-    int status;
+    std::lock_guard<std::mutex> lock(mutex);
+    int status = GDALTermProgress(dfComplete, pszMessage, pProgressArg);
+
+    return status;
 }
 
 // default to outputting using the GDAL progress meter
 static GDALProgressFunc progressFunc = termProgress;
 
 /// output the progress of the tiling operation
-int showProgress(int currentIndex, std::string filename)
+int showProgress(uint64_t currentIndex, std::string filename)
 {
     std::stringstream stream;
     stream << "created " << filename << " in thread " << std::this_thread::get_id();
@@ -266,15 +328,16 @@ int showProgress(int currentIndex, std::string filename)
     return progressFunc(currentIndex / (double) iteratorSize, message.c_str(), NULL);
 }
 
-int showProgress(int currentIndex)
+int showProgress(uint64_t currentIndex)
 {
     return progressFunc(currentIndex / (double) iteratorSize, NULL, NULL);
 }
 
 /// output mesh tiles represented by a tiler to a directory
-static void buildMesh(MeshSerializer &serializer, const MeshTiler &tiler,
+static void buildMesh(MeshSerializer &tileSerializer, const MeshTiler &tiler,
     paramsStruct &params, TerrainMetadata *metadata,
-    bool writeVertexNormals = false)
+    bool writeVertexNormals = false, const MosaicIndex *mosaic = NULL,
+    const TileCodec *codec = NULL)
 {
 
     i_zoom startZoom = (params.startZoom < 0) ? tiler.maxZoomLevel() : params.startZoom;
@@ -304,31 +367,209 @@ static void buildMesh(MeshSerializer &serializer, const MeshTiler &tiler,
     std::cout << "startZoom: " << startZoom << "\n";
     std::cout << "endZoom: " << endZoom << "\n";
 
-    MeshIterator iter(tiler, startZoom, endZoom);
-    int currentIndex = incrementIterator(iter, 0);
-    setIteratorSize(iter);
-    GDALDatasetReaderWithOverviews reader(tiler);
+    MeshIterator iter(tiler, startZoom, endZoom, params.tileOrder);
+    TileScheduler scheduler(std::max(params.threadCount, 0));
+    iteratorSize = iter.getSize();
+
+    // the manifest records the tiles as they are stored, so that a resumed
+    // run skips the tiles it has done before reading anything for them
+    std::unique_ptr<TileManifest> manifest;
+    std::unique_ptr<STTManifestSerializer> manifestSerializer;
+    if (params.manifestInterval > 0) {
+        manifest.reset(new TileManifest(params.manifest.string(), tiler, startZoom, endZoom, params.resume));
+        manifestSerializer.reset(new STTManifestSerializer(tileSerializer, *manifest, params.manifestInterval));
+        manifestSerializer->startSerialization();
+
+        if (!params.quiet && manifest->isResumed()) {
+            std::cout << "manifest: " << manifest->completed() << " tiles already stored\n";
+        }
+    }
+    MeshSerializer &serializer = manifestSerializer ? *manifestSerializer : tileSerializer;
+
+    // when building bottom up the heights of every tile are kept until the
+    // tiles of the zoom level above have been derived from them.
+    std::unique_ptr<HeightFieldStore> store;
+    if (params.bottomUp) {
+        store.reset(new HeightFieldStore(
+            tiler.grid().tileSize() * tiler.grid().tileSize(),
+            (uint64_t) std::max(params.pyramidMemory, 0) * 1024 * 1024,
+            CPLGenerateTempFilename("stt-pyramid")
+        ));
+    }
 
-    std::cout << "before while\n";
-    while (!iter.exhausted()) {
-        const TileCoordinate *coordinate = iter.GridIterator::operator*();
-        if (metadata) {
-            metadata->add(tiler.grid(), coordinate);
+    // GDAL dataset handles are not thread safe so every worker reads from its
+    // own handle in the pool with its own reader and gathers its own metadata.
+    // the handles are kept by worker index so every zoom level reuses them.
+    GDALDatasetPool pool(params.inputFile.string(), (GIntBig) std::max(params.cacheSize, 0) * 1024 * 1024);
+
+    // the pipeline needs a reader for each of its read and chunk threads
+    std::unique_ptr<MeshPipeline> pipeline;
+    if (params.pipeline) {
+        MeshPipeline::Options options;
+        options.threads[MeshPipeline::READ] = std::max(params.readThreads, 1);
+        options.threads[MeshPipeline::CHUNK] = std::max(params.threadCount, 0);
+        options.threads[MeshPipeline::ENCODE] = std::max(params.encodeThreads, 1);
+        options.threads[MeshPipeline::COMPRESS] = std::max(params.compressThreads, 1);
+        options.threads[MeshPipeline::WRITE] = std::max(params.writeThreads, 1);
+        options.writeVertexNormals = writeVertexNormals;
+        options.codec = codec;
+
+        pipeline.reset(new MeshPipeline(tiler, pool, serializer, options));
+    }
+
+    const unsigned int readerCount = pipeline ? pipeline->readerCount() : scheduler.threadCount();
+    pool.resize(readerCount);
+    std::vector<std::unique_ptr<GDALDatasetReaderWithOverviews>> readers;
+    std::vector<std::unique_ptr<GDALDatasetReaderWithMosaic>> mosaicReaders;
+    std::vector<std::unique_ptr<GDALDatasetReaderWithDirectWarp>> directReaders;
+    std::vector<std::unique_ptr<GDALDatasetReaderWithMapping>> mappedReaders;
+    std::vector<std::unique_ptr<GDALDatasetReaderWithSuperTiles>> superTileReaders;
+    std::vector<std::unique_ptr<GDALDatasetReaderWithPyramid>> pyramidReaders;
+    std::vector<GDALDatasetReader *> workerReaders;
+    std::vector<TerrainMetadata> threadMetadata(readerCount);
+
+    for (unsigned int i = 0; i < readerCount; ++i) {
+        GDALDatasetReader *reader;
+
+        // the readers in between read the pooled dataset, which only describes
+        // the extent of a mosaic, so they're skipped
+        if (mosaic) {
+            mosaicReaders.emplace_back(new GDALDatasetReaderWithMosaic(tiler, *mosaic));
+            reader = mosaicReaders.back().get();
+        } else {
+            readers.emplace_back(new GDALDatasetReaderWithOverviews(tiler));
+            reader = readers.back().get();
+        }
+
+        if (params.directWarp && !mosaic) {
+            directReaders.emplace_back(new GDALDatasetReaderWithDirectWarp(tiler, *reader));
+            reader = directReaders.back().get();
         }
 
-        // std::cout << "coordinate x: " << coordinate->x << "\n";
-        // std::cout << "coordinate y: " << coordinate->y << "\n";
-        // std::cout << "currentIndex: " << currentIndex << "\n";
+        if (params.mapRaster && !mosaic) {
+            mappedReaders.emplace_back(new GDALDatasetReaderWithMapping(tiler, *reader, params.tileOrder));
+            reader = mappedReaders.back().get();
+        }
+
+        if (params.batchSize > 1 && !mosaic) {
+            superTileReaders.emplace_back(new GDALDatasetReaderWithSuperTiles(tiler, *reader, params.batchSize));
+            reader = superTileReaders.back().get();
+        }
+
+        if (store) {
+            pyramidReaders.emplace_back(new GDALDatasetReaderWithPyramid(tiler, *store, *reader, startZoom));
+            reader = pyramidReaders.back().get();
+        }
+
+        workerReaders.push_back(reader);
+    }
+
+    // every worker reuses the scratch buffers and mesh of its previous tile
+    std::vector<TileArena> arenas(pipeline ? 0 : readerCount);
 
-        if (serializer.mustSerializeCoordinate(coordinate)) {
-            MeshTile *tile = iter.operator*(&reader);
+    std::atomic<uint64_t> currentIndex {0};
+    TileScheduler::TileTask task = [&](unsigned int worker, const TileCoordinate &coordinate) {
+        if (metadata) {
+            threadMetadata[worker].add(tiler.grid(), &coordinate);
+        }
+
+        if (serializer.mustSerializeCoordinate(&coordinate)) {
+            MeshTile *tile = tiler.createMesh(pool.dataset(worker), coordinate, workerReaders[worker], arenas[worker]);
             serializer.serializeTile(tile, writeVertexNormals);
-            delete tile;
         }
-        std::cout << "currentIndex: " << currentIndex << "\n";
 
-        currentIndex = incrementIterator(iter, currentIndex);
-        showProgress(currentIndex);
+        showProgress(++currentIndex);
+    };
+
+    // the pipeline only hands on the tiles which need to be serialized
+    MeshPipeline::TileFilter filter = [&](unsigned int thread, const TileCoordinate &coordinate) {
+        if (metadata) {
+            threadMetadata[thread].add(tiler.grid(), &coordinate);
+        }
+
+        showProgress(++currentIndex);
+
+        return serializer.mustSerializeCoordinate(&coordinate);
+    };
+
+    auto build = [&](const GridIterator &tiles) {
+        if (pipeline) {
+            pipeline->run(tiles, workerReaders, filter);
+
+            if (!params.quiet) {
+                pipeline->printStatistics(std::cout);
+            }
+        } else {
+            scheduler.schedule(tiles);
+            scheduler.run(task);
+
+            if (!params.quiet) {
+                scheduler.printStatistics(std::cout);
+            }
+        }
+    };
+
+    if (store) {
+        // a zoom level is finished before the next is started so that every
+        // parent tile finds the heights of its children
+        for (i_zoom zoom = startZoom; ; --zoom) {
+            if (!params.quiet) {
+                std::cout << "zoom " << zoom << ":\n";
+            }
+
+            build(MeshIterator(tiler, zoom, zoom, params.tileOrder));
+
+            if (zoom < startZoom) {
+                store->erase(zoom + 1);
+            }
+
+            if (zoom == endZoom)
+                break;
+        }
+    } else {
+        build(iter);
+    }
+
+    if (manifestSerializer) {
+        manifestSerializer->endSerialization();
+
+        if (!params.quiet) {
+            std::cout << "manifest: " << manifest->completed() << " tiles stored after "
+                      << manifest->checkpoints() << " checkpoints\n";
+        }
+    }
+
+    // the readers hold overviews of the pooled datasets so they are released first
+    pyramidReaders.clear();
+    superTileReaders.clear();
+    mappedReaders.clear();
+    directReaders.clear();
+    mosaicReaders.clear();
+    readers.clear();
+
+    if (!params.quiet && tiler.heightFieldCache()) {
+        const HeightFieldCache *cache = tiler.heightFieldCache();
+        std::cout << "heightfield cache: " << cache->hits() << " hits, "
+                  << cache->misses() << " misses\n";
+    }
+
+    if (!params.quiet) {
+        std::cout << "transformers: " << TransformerCache::hits() << " reused, "
+                  << TransformerCache::misses() << " created\n";
+    }
+
+    if (!params.quiet && !arenas.empty()) {
+        uint64_t allocations = 0;
+        for (size_t i = 0; i < arenas.size(); ++i) {
+            allocations += arenas[i].allocations();
+        }
+        std::cout << "tile arenas: " << allocations << " buffers allocated\n";
+    }
+
+    if (metadata) {
+        for (size_t i = 0; i < threadMetadata.size(); ++i) {
+            metadata->add(threadMetadata[i]);
+        }
     }
 }
 
@@ -344,7 +585,8 @@ int main(int argc, char *argv[])
     paramsStruct params = parseOptions(argc, argv);
 
     if (params.varMap.count("input-file")) {
-        if (fs::is_regular_file(params.inputFile)) {
+        if (fs::is_regular_file(params.inputFile) ||
+            (params.mosaic && fs::is_directory(params.inputFile))) {
             std::cout << "input file: " << params.inputFile << "\n";
         } else {
             std::cerr << "input file " << params.inputFile << " not found\n";
@@ -352,6 +594,22 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (!parseTileOrder(params.tileOrderName, params.tileOrder)) {
+        std::cerr << "unknown tile order " << params.tileOrderName << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // the super-tile reader only keeps a few blocks, which a column or a row
+    // of tiles crosses many more of before it comes back to them
+    if (params.batchSize > 1 && (params.tileOrder == TILE_ORDER_COLUMN || params.tileOrder == TILE_ORDER_ROW)) {
+        if (!params.varMap["tile-order"].defaulted()) {
+            std::cerr << "a batch size above 1 needs the morton or hilbert tile order\n";
+            return EXIT_FAILURE;
+        }
+
+        params.tileOrder = TILE_ORDER_HILBERT;
+    }
+
     if (params.varMap.count("output-directory")) {
         if (fs::is_directory(params.outputDir)) {
             std::cout << "output directory: " << params.outputDir << "\n";
@@ -384,6 +642,30 @@ int main(int argc, char *argv[])
     std::cout << grid.tileSize() << "\n";
     std::cout << grid.getSRS().exportToWkt() << "\n";
 
+    // a mosaic is tiled through a dataset covering its sources, written next
+    // to the index
+    std::unique_ptr<MosaicIndex> mosaic;
+    if (params.mosaic) {
+        if (params.mosaicIndex.empty()) {
+            params.mosaicIndex = params.outputDir / "mosaic.idx";
+        }
+
+        try {
+            mosaic.reset(new MosaicIndex(MosaicIndex::listSources(params.inputFile.string()),
+                grid.getSRS(), params.mosaicIndex.string()));
+
+            params.inputFile = params.mosaicIndex.string() + ".vrt";
+            mosaic->writeDataset(params.inputFile.string());
+        } catch (const STTException &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "mosaic: " << mosaic->sources().size() << " sources"
+                  << (mosaic->isCached() ? " from " : " indexed to ")
+                  << params.mosaicIndex << "\n";
+    }
+
     const char *charInputFile = params.inputFile.c_str();
 
     GDALDataset *poDataset;
@@ -407,8 +689,56 @@ int main(int argc, char *argv[])
     options.resampleAlg = GRA_Average;
     options.errorThreshold = 0.125;
     options.warpMemoryLimit = 0.0;
+    options.alignedRead = params.alignedRead;
+
+    std::unique_ptr<TileCodec> codec;
+    try {
+        codec.reset(TileCodec::create(params.compression, params.compressionLevel));
+    } catch (const STTException &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
 
-    STTFileTileSerializer serializer(params.outputDir, params.resume);
+    std::cout << "compression: " << codec->name() << "\n";
+
+    // the manifest lives next to the tiles unless it is named
+    if (params.manifest.empty()) {
+        if (!params.archive.empty()) {
+            params.manifest = params.archive.string() + ".manifest";
+        } else if (!params.mbtiles.empty()) {
+            params.manifest = params.mbtiles.string() + ".manifest";
+        } else {
+            params.manifest = params.outputDir / "tiles.manifest";
+        }
+    }
+
+    // tiles go to a file each in the output directory, to an MBTiles file or
+    // to an archive
+    std::unique_ptr<MeshSerializer> serializer;
+    if (!params.archive.empty()) {
+        serializer.reset(new STTArchiveSerializer(params.archive.string(), params.resume, codec.get()));
+        std::cout << "archive: " << params.archive << "\n";
+    } else if (params.mbtiles.empty()) {
+        STTFileTileSerializer *fileSerializer = new STTFileTileSerializer(params.outputDir, params.resume, codec.get());
+        fileSerializer->setWriteThreads(std::max(params.ioThreads, 0),
+            (uint64_t) std::max(params.ioMemory, 1) * 1024 * 1024);
+        serializer.reset(fileSerializer);
+    } else {
+        STTMBTilesSerializer::Options mbtilesOptions;
+        mbtilesOptions.batchSize = std::max(params.mbtilesBatchSize, 1);
+        mbtilesOptions.name = params.inputFile.stem().string();
+
+        serializer.reset(new STTMBTilesSerializer(params.mbtiles.string(), mbtilesOptions,
+            params.resume, codec.get()));
+        std::cout << "mbtiles: " << params.mbtiles << "\n";
+    }
+
+    try {
+        serializer->startSerialization();
+    } catch (const STTException &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
 
     // Height Map Option
     // const TerrainTiler tiler2(poDataset, grid);
@@ -418,7 +748,12 @@ int main(int argc, char *argv[])
 
     // Quantized Mesh Option
     if (params.outputFormat.compare("Mesh") == 0) {
-        const MeshTiler mtiler(poDataset, grid, options, params.meshQualityFactor);
+        MeshTiler mtiler(poDataset, grid, options, params.meshQualityFactor);
+        HeightFieldCache heightFieldCache(std::max(params.heightFieldCacheSize, 0));
+        if (params.heightFieldCacheSize > 0) {
+            mtiler.setHeightFieldCache(&heightFieldCache);
+        }
+
         const RasterTiler rtiler(poDataset, grid, options);
         TerrainMetadata *metadata = params.metadata ? new TerrainMetadata() : NULL;
         TerrainMetadata *threadMetadata = metadata ? new TerrainMetadata() : NULL;
@@ -426,7 +761,19 @@ int main(int argc, char *argv[])
         std::cout << "rtiler->maxZoomLevel: " << rtiler.maxZoomLevel() << "\n";
         std::cout << "mtiler->maxZoomLevel: " << mtiler.maxZoomLevel() << "\n";
         buildMetadata(rtiler, params, threadMetadata);
-        buildMesh(serializer, mtiler, params, threadMetadata, params.vertexNormals);
+        try {
+            buildMesh(*serializer, mtiler, params, threadMetadata, params.vertexNormals, mosaic.get(), codec.get());
+        } catch (const STTException &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        serializer->endSerialization();
+    } catch (const STTException &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return EXIT_FAILURE;
     }
 
     std::cout << "compare -- " << params.outputFormat.compare("Mesh") << "\n";
@@ -0,0 +1,167 @@
+/**
+ * @file ArenaAllocationTest.cpp
+ * @brief check that creating mesh tiles in a warm `TileArena` doesn't allocate
+ *
+ * every allocation of the process is counted by replacing `operator new` and,
+ * with glibc, `malloc`. the tiles of a zoom level are created twice with an
+ * arena to warm it and the heightfield cache up, with the cache much smaller
+ * than the zoom level so that its entries are evicted, and then created again
+ * while counting. the heights come from a reader computing them, so only the
+ * tiler, the chunker, the cache and the arena are measured.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "GDALDatasetReader.h"
+#include "GlobalGeodetic.h"
+#include "GridIterator.h"
+#include "HeightFieldCache.h"
+#include "MeshTiler.h"
+#include "TileArena.h"
+
+#include "TestRaster.h"
+
+using namespace stt;
+
+static bool counting = false;
+static uint64_t allocations = 0;
+
+#if defined(__GLIBC__)
+extern "C" {
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+
+    void *malloc(size_t size) {
+        if (counting) ++allocations;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size) {
+        if (counting) ++allocations;
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, size_t size) {
+        if (counting) ++allocations;
+        return __libc_realloc(pointer, size);
+    }
+}
+#endif
+
+/// allocate for `operator new`, counting the allocation once
+static void *
+allocate(size_t size) {
+#if !defined(__GLIBC__)
+    if (counting) ++allocations;
+#endif
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new(size_t size) {
+    void *pointer = allocate(size);
+    if (pointer == NULL) throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { std::free(pointer); }
+
+/// compute hills for the heights of a tile instead of reading them
+class ComputedReader: public GDALDatasetReader
+{
+public:
+    using GDALDatasetReader::readRasterHeights;
+
+    virtual void
+    readRasterHeights(GDALDataset *, const TileCoordinate &coord,
+        i_tile tileSizeX, i_tile tileSizeY, float *heights) override {
+        for (i_tile y = 0; y < tileSizeY; ++y) {
+            for (i_tile x = 0; x < tileSizeX; ++x) {
+                const double gx = coord.x * (tileSizeX - 1) + x;
+                const double gy = coord.y * (tileSizeY - 1) - y;
+
+                heights[y * tileSizeX + x] = 1000.0f
+                    + 300.0f * std::sin(gx * 0.05) * std::cos(gy * 0.04)
+                    + 40.0f * std::sin(gx * 0.37 + gy * 0.23);
+            }
+        }
+    }
+};
+
+/// create every tile in the arena, returning the number of allocations made
+static uint64_t
+createTiles(const MeshTiler &tiler, GDALDataset *dataset, const std::vector<TileCoordinate> &tiles,
+    GDALDatasetReader &reader, TileArena &arena, bool count) {
+    allocations = 0;
+    counting = count;
+
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        tiler.createMesh(dataset, tiles[i], &reader, arena);
+    }
+
+    counting = false;
+    return allocations;
+}
+
+int
+main() {
+    test::TestRaster raster(512, 512, 256);
+
+    MeshTiler tiler(raster.open(), GlobalGeodetic(65), TilerOptions());
+    GDALDataset *dataset = raster.open();
+    const i_zoom zoom = tiler.maxZoomLevel();
+
+    std::vector<TileCoordinate> tiles;
+    for (GridIterator iter(tiler.grid(), tiler.bounds(), zoom, zoom); !iter.exhausted(); ++iter) {
+        tiles.push_back(**iter);
+    }
+
+    ComputedReader reader;
+    HeightFieldCache cache(tiles.size() / 4 + 1);
+    int failures = 0;
+
+    for (bool cached : { true, false }) {
+        tiler.setHeightFieldCache(cached ? &cache : NULL);
+        TileArena arena;
+
+        createTiles(tiler, dataset, tiles, reader, arena, false);
+        createTiles(tiler, dataset, tiles, reader, arena, false);
+        const uint64_t made = createTiles(tiler, dataset, tiles, reader, arena, true);
+
+        std::cout << tiles.size() << " tiles at zoom " << zoom
+                  << (cached ? " with" : " without") << " the heightfield cache: "
+                  << made << " allocations\n";
+
+        if (made != 0) {
+            ++failures;
+        }
+    }
+
+    std::cout << "heightfield cache: " << cache.hits() << " hits, " << cache.misses() << " misses\n";
+
+    GDALClose(dataset);
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#ifndef CHUNKERTESTMESHES_H_
+#define CHUNKERTESTMESHES_H_
+
+/**
+ * @file ChunkerTestMeshes.h
+ * @brief this declares and defines the heights and meshes of the chunker tests and benchmarks
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "STTException.h"
+#include "TileCoordinate.h"
+#include "Grid.h"
+#include "HeightFieldChunker.h"
+
+namespace stt {
+namespace test {
+    struct StripMesh;
+    struct CompactStripMesh;
+
+    /// create the heights of a square tile of hills with some noise
+    inline std::vector<float>
+    tileHeights(int tileSize, uint32_t seed) {
+        std::vector<float> heights((size_t) tileSize * tileSize);
+        uint32_t noise = seed | 1;
+
+        for (int y = 0; y < tileSize; ++y) {
+            for (int x = 0; x < tileSize; ++x) {
+                noise ^= noise << 13;
+                noise ^= noise >> 17;
+                noise ^= noise << 5;
+
+                heights[(size_t) y * tileSize + x] = 1000.0f
+                    + 400.0f * std::sin((x + seed) * 0.05) * std::cos(y * 0.07)
+                    + 80.0f * std::sin(x * 0.31 + y * 0.17)
+                    + (noise % 1000) * 0.02f;
+            }
+        }
+
+        return heights;
+    }
+}
+}
+
+/// record the vertices of the strips a `heightfield` emits
+struct stt::test::StripMesh: public stt::chunk::mesh
+{
+    std::vector<std::pair<int, int>> vertices;
+
+    virtual void clear() override {
+        vertices.clear();
+    }
+
+    virtual void emit_vertex(const stt::chunk::heightfield &, int x, int y) override {
+        vertices.emplace_back(x, y);
+    }
+};
+
+/// record the vertices of the strips a `compact_heightfield` emits
+struct stt::test::CompactStripMesh
+{
+    std::vector<std::pair<int, int>> vertices;
+
+    void clear() {
+        vertices.clear();
+    }
+
+    template <class Heightfield>
+    void emit_vertex(const Heightfield &, int x, int y) {
+        vertices.emplace_back(x, y);
+    }
+};
+
+#endif /* CHUNKERTESTMESHES_H_ */
@@ -0,0 +1,227 @@
+/**
+ * @file GenerateMeshBenchmark.cpp
+ * @brief compare the vertex lookups of the mesh filled by `generateMesh`
+ *
+ * the strips of a chunked tile of 65, 129 and 257 heights are turned into a
+ * mesh as the `MeshTiler` does, finding the mesh vertex of every corner of
+ * their triangles in a `std::map`, in a flat array refilled for every tile as
+ * the tiler does, and in an array whose entries are stamped with the tile
+ * they were set for, which saves the refill:
+ *
+ *   GenerateMeshBenchmark [iterations] [geometric error]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "Mesh.h"
+
+#include "ChunkerTestMeshes.h"
+
+using namespace stt;
+
+/// the chunker of the mesh tiler
+typedef chunk::compact_heightfield<chunk::row_heights> HeightField;
+
+/// the value of grid indices without a mesh vertex yet
+static const int noVertex = -1;
+
+/// the mesh vertices of the grid indices in a `std::map`
+class MapLookup
+{
+public:
+    void reset(size_t) {
+        mVertices.clear();
+    }
+
+    int find(int index) const {
+        std::map<int, int>::const_iterator it = mVertices.find(index);
+        return it == mVertices.end() ? noVertex : it->second;
+    }
+
+    void insert(int index, int vertex) {
+        mVertices.insert(std::make_pair(index, vertex));
+    }
+
+private:
+    std::map<int, int> mVertices;
+};
+
+/// the mesh vertices of the grid indices in a flat array, refilled per tile
+class FlatLookup
+{
+public:
+    void reset(size_t count) {
+        mVertices.assign(count, noVertex);
+    }
+
+    int find(int index) const {
+        return mVertices[index];
+    }
+
+    void insert(int index, int vertex) {
+        mVertices[index] = vertex;
+    }
+
+private:
+    std::vector<int> mVertices;
+};
+
+/// the mesh vertices of the grid indices in a flat array whose entries are
+/// only valid when stamped with the current tile
+class StampedLookup
+{
+public:
+    StampedLookup():
+        mStamp(0)
+    {}
+
+    void reset(size_t count) {
+        if (mStamps.size() != count || ++mStamp == 0) {
+            mStamps.assign(count, 0);
+            mVertices.resize(count);
+            mStamp = 1;
+        }
+    }
+
+    int find(int index) const {
+        return mStamps[index] == mStamp ? mVertices[index] : noVertex;
+    }
+
+    void insert(int index, int vertex) {
+        mStamps[index] = mStamp;
+        mVertices[index] = vertex;
+    }
+
+private:
+    std::vector<uint32_t> mStamps;
+    std::vector<int> mVertices;
+    uint32_t mStamp;
+};
+
+/// receives the triangle strip of a `HeightField` to fill a mesh as the
+/// `MeshTiler` does, looking its vertices up in a `Lookup`
+template <class Lookup>
+class LookupMesh
+{
+public:
+    LookupMesh(Mesh &mesh, int tileSize):
+        mMesh(mesh),
+        mIndexCount((size_t) tileSize * tileSize),
+        mCellSize(1.0 / (tileSize - 1)),
+        mTriOddOrder(false),
+        mTriIndex(0)
+    {}
+
+    void clear() {
+        mMesh.clear();
+        mLookup.reset(mIndexCount);
+        mTriOddOrder = false;
+        mTriIndex = 0;
+    }
+
+    void emit_vertex(const HeightField &heightfield, int x, int y) {
+        mTriangles[mTriIndex].x = x;
+        mTriangles[mTriIndex].y = y;
+        mTriIndex++;
+
+        if (mTriIndex == 3) {
+            mTriOddOrder = !mTriOddOrder;
+
+            if (mTriOddOrder) {
+                appendVertex(heightfield, mTriangles[0].x, mTriangles[0].y);
+                appendVertex(heightfield, mTriangles[1].x, mTriangles[1].y);
+                appendVertex(heightfield, mTriangles[2].x, mTriangles[2].y);
+            } else {
+                appendVertex(heightfield, mTriangles[1].x, mTriangles[1].y);
+                appendVertex(heightfield, mTriangles[0].x, mTriangles[0].y);
+                appendVertex(heightfield, mTriangles[2].x, mTriangles[2].y);
+            }
+            mTriangles[0] = mTriangles[1];
+            mTriangles[1] = mTriangles[2];
+            mTriIndex--;
+        }
+    }
+
+private:
+    void appendVertex(const HeightField &heightfield, int x, int y) {
+        int index = heightfield.indexOfGridCoordinate(x, y);
+        int iv = mLookup.find(index);
+
+        if (iv == noVertex) {
+            iv = mMesh.vertices.size();
+            mMesh.vertices.push_back(CRSVertex(x * mCellSize, 1.0 - y * mCellSize, heightfield.height(x, y)));
+            mLookup.insert(index, iv);
+        }
+        mMesh.indices.push_back(iv);
+    }
+
+    Mesh &mMesh;
+    Lookup mLookup;
+    size_t mIndexCount;
+    double mCellSize;
+    Coordinate<int> mTriangles[3];
+    bool mTriOddOrder;
+    int mTriIndex;
+};
+
+/// get the microseconds `generateMesh` takes per tile with a lookup
+template <class Lookup>
+static double
+generateMeshMicroseconds(HeightField &heightfield, int tileSize, int iterations, size_t &vertices) {
+    Mesh mesh;
+    LookupMesh<Lookup> wrapper(mesh, tileSize);
+
+    // the first tile sizes the buffers of the mesh and the lookup
+    heightfield.generateMesh(wrapper, 0);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        heightfield.generateMesh(wrapper, 0);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    vertices = mesh.vertices.size();
+    return 1e6 * seconds / iterations;
+}
+
+int
+main(int argc, char *argv[]) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    const double error = argc > 2 ? std::atof(argv[2]) : 2.0;
+    const int tileSizes[] = { 65, 129, 257 };
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "grid  map        flat array  stamped\n";
+
+    for (int tileSize : tileSizes) {
+        const std::vector<float> heights = test::tileHeights(tileSize, 1);
+        std::vector<uint8_t> levels((size_t) tileSize * tileSize);
+
+        HeightField heightfield(chunk::row_heights(heights.data(), tileSize), tileSize, levels.data());
+        heightfield.applyGeometricError(error);
+
+        size_t mapVertices, flatVertices, stampedVertices;
+        const double map = generateMeshMicroseconds<MapLookup>(heightfield, tileSize, iterations, mapVertices);
+        const double flat = generateMeshMicroseconds<FlatLookup>(heightfield, tileSize, iterations, flatVertices);
+        const double stamped = generateMeshMicroseconds<StampedLookup>(heightfield, tileSize, iterations, stampedVertices);
+
+        std::cout << std::setw(4) << tileSize
+                  << std::setw(9) << map << " us"
+                  << std::setw(9) << flat << " us"
+                  << std::setw(9) << stamped << " us";
+
+        if (mapVertices != flatVertices || mapVertices != stampedVertices) {
+            std::cout << "  vertex counts differ: " << mapVertices << ", "
+                      << flatVertices << ", " << stampedVertices;
+        }
+        std::cout << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file GridIteratorTest.cpp
+ * @brief check that every tile order maps tiles to indices and back
+ *
+ * for every `TileOrder`, and over extents whose zoom levels are square, wider
+ * than they are high, higher than they are wide or a single tile across, the
+ * index of every tile of the iteration must give the tile back and the tile at
+ * every index must give the index back. iterating must then visit the tile at
+ * each index once, in index order.
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "GlobalGeodetic.h"
+#include "GridIterator.h"
+#include "STTException.h"
+
+using namespace stt;
+
+/// an extent to iterate over and the zoom levels to iterate over it
+struct Extent {
+    const char *name;
+    CRSBounds bounds;
+    i_zoom startZoom;
+    i_zoom endZoom;
+};
+
+/// check the tiles of an iteration in an order, returning the number of failures
+static int
+checkOrder(const Grid &grid, const Extent &extent, TileOrder order, const char *orderName) {
+    GridIterator iter(grid, extent.bounds, extent.startZoom, extent.endZoom);
+    iter.setOrder(order);
+    int failures = 0;
+
+    // every tile of every zoom level maps to an index and back
+    for (i_zoom zoom = extent.startZoom; ; --zoom) {
+        const TileBounds bounds = iter.tileBoundsForZoom(zoom);
+
+        for (i_tile x = bounds.getMinX(); x <= bounds.getMaxX(); ++x) {
+            for (i_tile y = bounds.getMinY(); y <= bounds.getMaxY(); ++y) {
+                const TileCoordinate coord(zoom, x, y);
+                const i_tile_index index = iter.indexOf(coord);
+
+                if (index >= iter.getSize() || !(iter.coordinateAt(index) == coord)) {
+                    std::cout << orderName << " " << extent.name << ": tile " << zoom << "/" << x
+                              << "/" << y << " does not map back from index " << index << "\n";
+                    ++failures;
+                }
+            }
+        }
+
+        if (zoom == extent.endZoom)
+            break;
+    }
+
+    // every index maps to a tile and back
+    for (i_tile_index index = 0; index < iter.getSize(); ++index) {
+        const TileCoordinate coord = iter.coordinateAt(index);
+
+        if (iter.indexOf(coord) != index) {
+            std::cout << orderName << " " << extent.name << ": index " << index
+                      << " does not map back from tile " << coord.zoom << "/" << coord.x
+                      << "/" << coord.y << "\n";
+            ++failures;
+        }
+    }
+
+    // iterating visits the tile at each index in turn
+    i_tile_index visited = 0;
+    for (; !iter.exhausted(); ++iter, ++visited) {
+        if (iter.getIndex() != visited || !(**iter == iter.coordinateAt(visited))) {
+            std::cout << orderName << " " << extent.name << ": iteration differs at index "
+                      << visited << "\n";
+            ++failures;
+            break;
+        }
+    }
+
+    if (failures == 0 && visited != iter.getSize()) {
+        std::cout << orderName << " " << extent.name << ": iterated over " << visited
+                  << " tiles instead of " << iter.getSize() << "\n";
+        ++failures;
+    }
+
+    return failures;
+}
+
+int
+main() {
+    const GlobalGeodetic grid(65);
+    int failures = 0;
+    i_tile_index tiles = 0;
+
+    const Extent extents[] = {
+        { "world", CRSBounds(-180, -90, 180, 90), 5, 0 },
+        { "switzerland", CRSBounds(5.9, 45.8, 10.5, 47.8), 11, 3 },
+        { "wide strip", CRSBounds(-170, 10, 170, 10.3), 8, 2 },
+        { "tall strip", CRSBounds(8, -60, 8.3, 70), 8, 2 },
+        { "odd block", CRSBounds(-31.3, -17.9, 2.2, 4.4), 7, 4 }
+    };
+
+    const TileOrder orders[] = { TILE_ORDER_COLUMN, TILE_ORDER_ROW, TILE_ORDER_MORTON, TILE_ORDER_HILBERT };
+    const char *orderNames[] = { "column", "row", "morton", "hilbert" };
+
+    for (const Extent &extent : extents) {
+        for (size_t i = 0; i < sizeof(orders) / sizeof(orders[0]); ++i) {
+            try {
+                failures += checkOrder(grid, extent, orders[i], orderNames[i]);
+            } catch (STTException &e) {
+                std::cout << orderNames[i] << " " << extent.name << ": " << e.what() << "\n";
+                ++failures;
+            }
+        }
+
+        tiles += GridIterator(grid, extent.bounds, extent.startZoom, extent.endZoom).getSize();
+    }
+
+    std::cout << tiles << " tiles mapped in every order: " << failures << " failures\n";
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file HeightFieldChunkerBenchmark.cpp
+ * @brief compare the time `heightfield` and `compact_heightfield` take per tile
+ *
+ * every iteration chunks a tile of 65, 129 and 257 heights with each class,
+ * applying the geometric error and generating the mesh of level 0, as the
+ * mesh tiler does for every tile:
+ *
+ *   HeightFieldChunkerBenchmark [iterations] [geometric error]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "ChunkerTestMeshes.h"
+
+using namespace stt;
+
+int
+main(int argc, char *argv[]) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    const double error = argc > 2 ? std::atof(argv[2]) : 2.0;
+    const int tileSizes[] = { 65, 129, 257 };
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (int tileSize : tileSizes) {
+        const std::vector<float> heights = test::tileHeights(tileSize, 1);
+        size_t vertices = 0;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            test::StripMesh mesh;
+            chunk::heightfield hf(heights.data(), tileSize);
+            hf.applyGeometricError(error);
+            hf.generateMesh(mesh, 0);
+            vertices = mesh.vertices.size();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<uint8_t> levels((size_t) tileSize * tileSize);
+        size_t compactVertices = 0;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            test::CompactStripMesh mesh;
+            chunk::compact_heightfield<chunk::row_heights> hf(
+                chunk::row_heights(heights.data(), tileSize), tileSize, levels.data());
+            hf.applyGeometricError(error);
+            hf.generateMesh(mesh, 0);
+            compactVertices = mesh.vertices.size();
+        }
+        const double compactSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << tileSize << "x" << tileSize << ": heightfield "
+                  << 1e6 * seconds / iterations << " us, compact "
+                  << 1e6 * compactSeconds / iterations << " us per tile ("
+                  << seconds / compactSeconds << "x), " << vertices << " and "
+                  << compactVertices << " strip vertices\n";
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file HeightFieldChunkerTest.cpp
+ * @brief check that `compact_heightfield` emits the same strips as `heightfield`
+ *
+ * tiles of 65, 129 and 257 heights are chunked by both classes with a range
+ * of geometric errors, with and without the smoothing of small zooms, and
+ * with the border of a neighbour applied. the vertices of the strips of every
+ * level must be the same.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "ChunkerTestMeshes.h"
+
+using namespace stt;
+
+static int failures = 0;
+
+/// compare the strips of both heightfields at every level
+template <class Compact>
+static void
+compareStrips(chunk::heightfield &hf, Compact &compact, int tileSize, const char *what) {
+    const int levels = (int) (log2((float) tileSize - 1) + 0.5);
+
+    for (int level = 0; level < levels; ++level) {
+        test::StripMesh strips;
+        test::CompactStripMesh compactStrips;
+
+        hf.generateMesh(strips, level);
+        compact.generateMesh(compactStrips, level);
+
+        if (strips.vertices != compactStrips.vertices) {
+            std::cerr << "tile size " << tileSize << ", " << what << ", level " << level
+                      << ": " << strips.vertices.size() << " vertices against "
+                      << compactStrips.vertices.size() << " compact vertices\n";
+            ++failures;
+        }
+    }
+}
+
+int
+main() {
+    const int tileSizes[] = { 65, 129, 257 };
+    const double errors[] = { 0.5, 2, 8, 32 };
+
+    for (int tileSize : tileSizes) {
+        const std::vector<float> heights = test::tileHeights(tileSize, 1);
+        const std::vector<float> neighbourHeights = test::tileHeights(tileSize, 2);
+
+        for (double error : errors) {
+            for (bool smooth : { false, true }) {
+                chunk::heightfield hf(heights.data(), tileSize);
+                chunk::compact_heightfield<chunk::row_heights> compact(
+                    chunk::row_heights(heights.data(), tileSize), tileSize);
+
+                hf.applyGeometricError(error, smooth);
+                compact.applyGeometricError(error, smooth);
+                compareStrips(hf, compact, tileSize, smooth ? "smoothed" : "not smoothed");
+
+                // the eastern neighbour shares the right border
+                chunk::heightfield neighbour(neighbourHeights.data(), tileSize);
+                chunk::compact_heightfield<chunk::row_heights> compactNeighbour(
+                    chunk::row_heights(neighbourHeights.data(), tileSize), tileSize);
+
+                neighbour.applyGeometricError(error / 2, smooth);
+                compactNeighbour.applyGeometricError(error / 2, smooth);
+
+                hf.applyBorderActivationState(neighbour, 2);
+                compact.applyBorderActivationState(compactNeighbour, 2);
+                compareStrips(hf, compact, tileSize, "with a neighbour");
+            }
+        }
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " meshes differ\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "the compact heightfield emits the same strips\n";
+    return EXIT_SUCCESS;
+}
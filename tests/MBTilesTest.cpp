@@ -0,0 +1,228 @@
+/**
+ * @file MBTilesTest.cpp
+ * @brief check that an MBTiles store is resumed and reads back with SQLite
+ *
+ * the tiles of the first zoom levels are stored in an MBTiles file by a run
+ * which flushes half of them and is abandoned after storing some more, as by
+ * a run which is stopped. the file is resumed, which must skip exactly the
+ * tiles flushed, and finished. every tile and the metadata are then read back
+ * with SQLite. a file whose metadata cannot be written must fail to finish
+ * rather than be left without its metadata.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "sqlite3.h"
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include "STTException.h"
+#include "STTMBTilesSerializer.h"
+
+using namespace stt;
+
+/// get the bytes stored for a tile, whose size and contents depend on it
+static std::vector<unsigned char>
+tileData(const TileCoordinate &coord) {
+    const uint32_t seed = (coord.zoom << 20) ^ (coord.x << 10) ^ coord.y;
+    std::vector<unsigned char> data(16 + seed % 97);
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (unsigned char) (seed * 31 + i * 7 + coord.zoom);
+    }
+
+    return data;
+}
+
+/// store a tile unless the serializer already has it, returning whether it was stored
+static bool
+storeTile(STTMBTilesSerializer &serializer, const TileCoordinate &coord) {
+    if (!serializer.mustSerializeCoordinate(&coord)) {
+        return false;
+    }
+
+    const std::vector<unsigned char> data = tileData(coord);
+    serializer.serializeTileData(&coord, data.data(), data.size());
+    return true;
+}
+
+/// run a statement on a database, throwing if it fails
+static void
+execute(sqlite3 *db, const char *sql) {
+    if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+        throw STTException(sqlite3_errmsg(db));
+    }
+}
+
+/// remove a database and its write ahead log
+static void
+removeDatabase(const std::string &filename) {
+    VSIUnlink(filename.c_str());
+    VSIUnlink((filename + "-wal").c_str());
+    VSIUnlink((filename + "-shm").c_str());
+}
+
+int
+main() {
+    const std::string filename = std::string(CPLGenerateTempFilename("stt-mbtiles")) + ".mbtiles";
+    int failures = 0;
+
+    STTMBTilesSerializer::Options options;
+    options.batchSize = 7;
+    options.name = "test";
+
+    // every tile of the geodetic zoom levels 0 to 4
+    std::vector<TileCoordinate> tiles;
+    for (i_zoom zoom = 0; zoom <= 4; ++zoom) {
+        for (i_tile y = 0; y < (1 << zoom); ++y) {
+            for (i_tile x = 0; x < (2 << zoom); ++x) {
+                tiles.push_back(TileCoordinate(zoom, x, y));
+            }
+        }
+    }
+    const size_t flushed = tiles.size() / 2;
+    const size_t abandoned = flushed + 3;
+
+    // a run which flushes half of the tiles and is abandoned after a few more
+    {
+        STTMBTilesSerializer serializer(filename, options, false);
+        serializer.startSerialization();
+
+        for (size_t i = 0; i < flushed; ++i) {
+            storeTile(serializer, tiles[i]);
+        }
+        serializer.flush();
+
+        for (size_t i = flushed; i < abandoned; ++i) {
+            storeTile(serializer, tiles[i]);
+        }
+    }
+
+    // the resumed run stores the tiles which were not flushed
+    {
+        STTMBTilesSerializer serializer(filename, options, true);
+        serializer.startSerialization();
+
+        size_t stored = 0;
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            if (storeTile(serializer, tiles[i])) {
+                ++stored;
+
+                if (i < flushed) {
+                    std::cout << "tile " << i << " stored again when resuming\n";
+                    ++failures;
+                }
+            }
+        }
+        serializer.endSerialization();
+
+        if (stored != tiles.size() - flushed) {
+            std::cout << "resuming stored " << stored << " tiles instead of "
+                      << tiles.size() - flushed << "\n";
+            ++failures;
+        }
+    }
+
+    {
+        sqlite3 *db = NULL;
+        sqlite3_stmt *select = NULL;
+        std::map<std::string, std::string> metadata;
+        size_t count = 0;
+
+        if (sqlite3_open_v2(filename.c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK
+                || sqlite3_prepare_v2(db, "SELECT tile_data FROM tiles "
+                    "WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?", -1, &select, NULL) != SQLITE_OK) {
+            std::cout << "the MBTiles file does not open: " << sqlite3_errmsg(db) << "\n";
+            sqlite3_close(db);
+            return EXIT_FAILURE;
+        }
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            const std::vector<unsigned char> expected = tileData(tiles[i]);
+
+            sqlite3_bind_int(select, 1, tiles[i].zoom);
+            sqlite3_bind_int(select, 2, tiles[i].x);
+            sqlite3_bind_int(select, 3, tiles[i].y);
+
+            if (sqlite3_step(select) != SQLITE_ROW
+                    || (size_t) sqlite3_column_bytes(select, 0) != expected.size()
+                    || memcmp(sqlite3_column_blob(select, 0), expected.data(), expected.size()) != 0) {
+                std::cout << "tile " << tiles[i].zoom << "/" << tiles[i].x << "/" << tiles[i].y
+                          << " does not read back\n";
+                ++failures;
+            }
+            sqlite3_reset(select);
+        }
+        sqlite3_finalize(select);
+
+        if (sqlite3_prepare_v2(db, "SELECT count(*) FROM tiles", -1, &select, NULL) == SQLITE_OK
+                && sqlite3_step(select) == SQLITE_ROW) {
+            count = sqlite3_column_int64(select, 0);
+        }
+        sqlite3_finalize(select);
+
+        if (count != tiles.size()) {
+            std::cout << "the MBTiles file holds " << count << " tiles instead of "
+                      << tiles.size() << "\n";
+            ++failures;
+        }
+
+        if (sqlite3_prepare_v2(db, "SELECT name, value FROM metadata", -1, &select, NULL) == SQLITE_OK) {
+            while (sqlite3_step(select) == SQLITE_ROW) {
+                metadata[(const char *) sqlite3_column_text(select, 0)] =
+                    (const char *) sqlite3_column_text(select, 1);
+            }
+        }
+        sqlite3_finalize(select);
+        sqlite3_close(db);
+
+        const std::map<std::string, std::string> expected = {
+            { "name", "test" }, { "scheme", "tms" }, { "format", "terrain" },
+            { "minzoom", "0" }, { "maxzoom", "4" }, { "encoding", "gzip" }
+        };
+        if (metadata != expected) {
+            std::cout << "the metadata does not read back:";
+            for (const auto &entry : metadata) {
+                std::cout << " " << entry.first << "=" << entry.second;
+            }
+            std::cout << "\n";
+            ++failures;
+        }
+    }
+
+    // metadata which cannot be written fails the serialization
+    {
+        sqlite3 *db = NULL;
+        if (sqlite3_open(filename.c_str(), &db) != SQLITE_OK) {
+            std::cout << "the MBTiles file does not open: " << sqlite3_errmsg(db) << "\n";
+            sqlite3_close(db);
+            return EXIT_FAILURE;
+        }
+        execute(db, "CREATE TRIGGER read_only BEFORE INSERT ON metadata "
+            "BEGIN SELECT RAISE(ABORT, 'the metadata is read only'); END");
+        sqlite3_close(db);
+
+        STTMBTilesSerializer serializer(filename, options, true);
+        serializer.startSerialization();
+
+        try {
+            serializer.endSerialization();
+            std::cout << "metadata which could not be written was not reported\n";
+            ++failures;
+        } catch (STTException &) {
+        }
+    }
+
+    removeDatabase(filename);
+
+    std::cout << tiles.size() << " tiles written, resumed after " << flushed
+              << " and read back: " << failures << " failures\n";
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file MeshEncodeBenchmark.cpp
+ * @brief compare the time to encode, compress and write a mesh tile per field and in one go
+ *
+ * the mesh tiles of the maximum zoom level of a synthetic raster are built
+ * once and then written the way the directory serializer did, with a
+ * `gzwrite` per field of the tile, and the way it does now, encoded into a
+ * reused buffer which is gzipped and written in one go. the encoded tiles are
+ * then compressed by every codec built in:
+ *
+ *   MeshEncodeBenchmark [tiles] [repetitions]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zlib.h"
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include "GDALDatasetReader.h"
+#include "GlobalGeodetic.h"
+#include "GridIterator.h"
+#include "MeshTiler.h"
+#include "STTException.h"
+#include "STTMemoryOutputStream.h"
+#include "STTZOutputStream.h"
+#include "TileCodec.h"
+
+#include "TestRaster.h"
+
+using namespace stt;
+
+/// get the seconds since a time
+static double
+secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// write a buffer to a file with a single write
+static void
+writeFile(const std::string &filename, const std::vector<unsigned char> &data) {
+    VSILFILE *fp = VSIFOpenL(filename.c_str(), "wb");
+    if (fp == NULL) {
+        throw STTException("Failed to open file");
+    }
+
+    size_t written = VSIFWriteL(data.data(), 1, data.size(), fp);
+
+    if (VSIFCloseL(fp) != 0 || written != data.size()) {
+        throw STTException("Failed to write file");
+    }
+}
+
+/// read back the uncompressed contents of a gzipped file
+static std::vector<unsigned char>
+readGzipFile(const std::string &filename) {
+    std::vector<unsigned char> data;
+    gzFile file = gzopen(filename.c_str(), "rb");
+    if (file == NULL) {
+        throw STTException("Failed to open file");
+    }
+
+    unsigned char chunk[16384];
+    int read;
+    while ((read = gzread(file, chunk, sizeof(chunk))) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    gzclose(file);
+
+    return data;
+}
+
+int
+main(int argc, char *argv[]) {
+    const int maxTiles = argc > 1 ? std::atoi(argv[1]) : 50;
+    const int repetitions = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    test::TestRaster raster(1024, 1024, 256);
+
+    MeshTiler tiler(raster.open(), GlobalGeodetic(65), TilerOptions());
+    const i_zoom zoom = tiler.maxZoomLevel();
+
+    GDALDataset *dataset = raster.open();
+    GDALDatasetReaderWithOverviews reader(tiler);
+
+    std::vector<std::unique_ptr<MeshTile>> tiles;
+    for (GridIterator iter(tiler.grid(), tiler.bounds(), zoom, zoom);
+            !iter.exhausted() && (int) tiles.size() < maxTiles; ++iter) {
+        tiles.emplace_back(tiler.createMesh(dataset, **iter, &reader));
+    }
+
+    reader.reset();
+    GDALTiler::releaseOverviews(dataset);
+    GDALClose(dataset);
+
+    const std::string perFieldFilename = std::string(CPLGenerateTempFilename("stt-field")) + ".terrain";
+    const std::string bufferedFilename = std::string(CPLGenerateTempFilename("stt-buffer")) + ".terrain";
+
+    // a gzwrite for every field of the tile
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            STTZFileOutputStream ostream(perFieldFilename.c_str());
+            tiles[i]->writeFile(ostream);
+            ostream.close();
+        }
+    }
+    const double perFieldSeconds = secondsSince(start);
+
+    // encoded into a reused buffer, gzipped and written in one go
+    STTMemoryOutputStream ostream;
+    std::vector<unsigned char> compressed;
+    double encodeSeconds = 0, compressSeconds = 0, writeSeconds = 0;
+    size_t encodedBytes = 0;
+
+    for (int r = 0; r < repetitions; ++r) {
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            start = std::chrono::steady_clock::now();
+            ostream.clear();
+            tiles[i]->writeFile(ostream);
+            encodeSeconds += secondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            TileCodec::gzip().encode(ostream.buffer().data(), ostream.buffer().size(), compressed);
+            compressSeconds += secondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            writeFile(bufferedFilename, compressed);
+            writeSeconds += secondsSince(start);
+
+            encodedBytes += ostream.buffer().size();
+        }
+    }
+
+    // both files hold the last tile, which must decode to the same bytes
+    const bool identical = readGzipFile(perFieldFilename) == readGzipFile(bufferedFilename);
+    VSIUnlink(perFieldFilename.c_str());
+    VSIUnlink(bufferedFilename.c_str());
+
+    const double perTile = 1e6 / ((double) tiles.size() * repetitions);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << tiles.size() << " tiles at zoom " << zoom << ", "
+              << encodedBytes / ((size_t) tiles.size() * repetitions) << " bytes encoded per tile\n";
+    std::cout << "gzwrite per field: " << perFieldSeconds * perTile << " us per tile\n";
+    std::cout << "buffered:          " << (encodeSeconds + compressSeconds + writeSeconds) * perTile
+              << " us per tile (encode " << encodeSeconds * perTile
+              << " us, compress " << compressSeconds * perTile
+              << " us, write " << writeSeconds * perTile << " us)\n";
+    std::cout << "encoded output " << (identical ? "identical" : "DIFFERS") << "\n";
+
+    // every codec built in, on the encoded tiles
+    std::vector<std::vector<unsigned char>> encoded(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        STTMemoryOutputStream tileStream;
+        tiles[i]->writeFile(tileStream);
+        encoded[i] = tileStream.buffer();
+    }
+
+    const char *codecs[] = { "none", "gzip", "zstd", "brotli" };
+    for (const char *name : codecs) {
+        std::unique_ptr<TileCodec> codec;
+        try {
+            codec.reset(TileCodec::create(name));
+        } catch (STTException &) {
+            std::cout << std::setw(8) << name << ": not built\n";
+            continue;
+        }
+
+        size_t inBytes = 0, outBytes = 0;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; ++r) {
+            for (size_t i = 0; i < encoded.size(); ++i) {
+                codec->encode(encoded[i].data(), encoded[i].size(), compressed);
+                inBytes += encoded[i].size();
+                outBytes += compressed.size();
+            }
+        }
+        const double seconds = secondsSince(start);
+
+        std::cout << std::setw(8) << name << ": " << seconds * perTile << " us per tile, ratio "
+                  << std::setprecision(3) << (double) inBytes / outBytes << std::setprecision(1) << "\n";
+    }
+
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
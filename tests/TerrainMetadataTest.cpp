@@ -0,0 +1,94 @@
+/**
+ * @file TerrainMetadataTest.cpp
+ * @brief check that merging per-thread metadata gives that of a single thread
+ *
+ * the tiles of a few zoom levels over an extent away from the origin are
+ * added to one `TerrainMetadata`, as a single thread does, and spread over
+ * the metadata of several threads which are then merged into an empty one,
+ * as `buildMesh` does. both ways must give the same tile ranges and bounds,
+ * whether the threads take the tiles in turn or in contiguous runs, and with
+ * a thread which got no tile at all.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "GlobalGeodetic.h"
+#include "GridIterator.h"
+#include "TerrainMetadata.h"
+
+using namespace stt;
+
+/// compare two metadata, printing what differs
+static bool
+sameMetadata(const TerrainMetadata &expected, const TerrainMetadata &merged, const char *name) {
+    bool same = expected.levels.size() == merged.levels.size();
+
+    for (size_t i = 0; same && i < expected.levels.size(); ++i) {
+        const TerrainMetadata::LevelInfo &a = expected.levels[i];
+        const TerrainMetadata::LevelInfo &b = merged.levels[i];
+
+        if (a.startX != b.startX || a.startY != b.startY || a.finalX != b.finalX || a.finalY != b.finalY) {
+            std::cout << name << ": zoom " << i << " spans " << b.startX << "," << b.startY
+                      << " to " << b.finalX << "," << b.finalY << " instead of " << a.startX
+                      << "," << a.startY << " to " << a.finalX << "," << a.finalY << "\n";
+            same = false;
+        }
+    }
+
+    if (expected.bounds.getMinX() != merged.bounds.getMinX()
+            || expected.bounds.getMinY() != merged.bounds.getMinY()
+            || expected.bounds.getMaxX() != merged.bounds.getMaxX()
+            || expected.bounds.getMaxY() != merged.bounds.getMaxY()) {
+        std::cout << name << ": bounds " << merged.bounds.getMinX() << "," << merged.bounds.getMinY()
+                  << " to " << merged.bounds.getMaxX() << "," << merged.bounds.getMaxY()
+                  << " instead of " << expected.bounds.getMinX() << "," << expected.bounds.getMinY()
+                  << " to " << expected.bounds.getMaxX() << "," << expected.bounds.getMaxY() << "\n";
+        same = false;
+    }
+
+    return same;
+}
+
+int
+main() {
+    const GlobalGeodetic grid(65);
+    const CRSBounds extent(5.9, 45.8, 10.5, 47.8);
+    const size_t threads = 4;
+    int failures = 0;
+
+    std::vector<TileCoordinate> tiles;
+    for (GridIterator iter(grid, extent, 10, 4); !iter.exhausted(); ++iter) {
+        tiles.push_back(**iter);
+    }
+
+    TerrainMetadata single;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        single.add(grid, &tiles[i]);
+    }
+
+    // the tiles in turn, and in contiguous runs as the scheduler hands them out
+    for (bool contiguous : { false, true }) {
+        std::vector<TerrainMetadata> threadMetadata(threads + 1);
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            const size_t thread = contiguous ? i * threads / tiles.size() : i % threads;
+            threadMetadata[thread].add(grid, &tiles[i]);
+        }
+
+        TerrainMetadata merged;
+        for (size_t i = 0; i < threadMetadata.size(); ++i) {
+            merged.add(threadMetadata[i]);
+        }
+
+        if (!sameMetadata(single, merged, contiguous ? "contiguous" : "in turn")) {
+            ++failures;
+        }
+    }
+
+    std::cout << tiles.size() << " tiles merged from " << threads << " threads: "
+              << failures << " failures\n";
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
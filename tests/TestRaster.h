@@ -0,0 +1,137 @@
+#ifndef TESTRASTER_H_
+#define TESTRASTER_H_
+
+/**
+ * @file TestRaster.h
+ * @brief this declares and defines the synthetic rasters of the tests and benchmarks
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gdal_priv.h"
+#include "cpl_conv.h"
+#include "ogr_spatialref.h"
+
+#include "STTException.h"
+
+namespace stt {
+namespace test {
+    struct TestRaster;
+}
+}
+
+/**
+ * @brief a synthetic elevation raster
+ *
+ * the raster is written as a GeoTIFF in the temporary directory, tiled or in
+ * strips and uncompressed, so that every block GDAL loads is read from the
+ * file. the heights are smooth hills with some noise, which gives meshes of a
+ * realistic size. the file is removed when the raster is destroyed:
+ *
+ * \code
+ *   TestRaster raster(4096, 2048, 256);
+ *   GDALDataset *dataset = raster.open();
+ * \endcode
+ */
+struct stt::test::TestRaster
+{
+    /// write a raster of `width` by `height` pixels of `resolution` with the
+    /// north west corner at `west`, `north` in the reference system `epsg`. a
+    /// `blockSize` of `0` writes the raster in single row strips
+    TestRaster(int width, int height, int blockSize,
+        double west = 8.0, double north = 47.0, double resolution = 1.0 / 1024,
+        int epsg = 4326):
+        filename(std::string(CPLGenerateTempFilename("stt-test")) + ".tif"),
+        width(width),
+        height(height),
+        blockSize(blockSize)
+    {
+        GDALAllRegister();
+
+        GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+        if (driver == NULL) {
+            throw STTException("The GTiff driver is not available");
+        }
+
+        CPLStringList createOptions;
+        if (blockSize > 0) {
+            createOptions.SetNameValue("TILED", "YES");
+            createOptions.SetNameValue("BLOCKXSIZE", std::to_string(blockSize).c_str());
+            createOptions.SetNameValue("BLOCKYSIZE", std::to_string(blockSize).c_str());
+        } else {
+            createOptions.SetNameValue("BLOCKYSIZE", "1");
+        }
+
+        GDALDataset *dataset = driver->Create(filename.c_str(), width, height, 1,
+            GDT_Float32, createOptions.List());
+        if (dataset == NULL) {
+            throw STTException("Could not create the test raster");
+        }
+
+        double adfGeoTransform[6] = { west, resolution, 0, north, 0, -resolution };
+        dataset->SetGeoTransform(adfGeoTransform);
+
+        OGRSpatialReference srs;
+        srs.importFromEPSG(epsg);
+        srs.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+        dataset->SetSpatialRef(&srs);
+
+        std::vector<float> row(width);
+        uint32_t noise = 2463534242u;
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                noise ^= noise << 13;
+                noise ^= noise >> 17;
+                noise ^= noise << 5;
+
+                row[x] = 1000.0f
+                    + 600.0f * std::sin(x * 0.004) * std::cos(y * 0.005)
+                    + 150.0f * std::sin(x * 0.031 + y * 0.017)
+                    + (noise % 1000) * 0.01f;
+            }
+
+            if (dataset->GetRasterBand(1)->RasterIO(GF_Write, 0, y, width, 1,
+                    row.data(), width, 1, GDT_Float32, 0, 0) != CE_None) {
+                GDALClose(dataset);
+                throw STTException("Could not write the test raster");
+            }
+        }
+
+        GDALClose(dataset);
+    }
+
+    TestRaster(const TestRaster &other) = delete;
+    TestRaster &operator=(const TestRaster &other) = delete;
+
+    /// the destructor removes the raster
+    ~TestRaster() {
+        VSIUnlink(filename.c_str());
+    }
+
+    /// open a new read only handle on the raster
+    GDALDataset *
+    open() const {
+        GDALDataset *dataset = GDALDataset::FromHandle(GDALOpen(filename.c_str(), GA_ReadOnly));
+        if (dataset == NULL) {
+            throw STTException("Could not open the test raster");
+        }
+        return dataset;
+    }
+
+    /// get the number of bytes of a block of the raster
+    inline uint64_t
+    blockBytes() const {
+        return (uint64_t) (blockSize > 0 ? blockSize * blockSize : width) * sizeof(float);
+    }
+
+    std::string filename;       /// the GeoTIFF
+    int width;                  /// the size of the raster in pixels
+    int height;
+    int blockSize;              /// the size of its square blocks, or `0` for strips
+};
+
+#endif /* TESTRASTER_H_ */
@@ -0,0 +1,108 @@
+/**
+ * @file TileArchiveBenchmark.cpp
+ * @brief measure the random tile lookups per second of a tile archive
+ *
+ * an archive of small tiles filling the geodetic zoom levels from 0 is
+ * written and finished, and tiles are then looked up in a random order, half
+ * of them stored and half of them from the zoom level after the last one
+ * stored, reading the first byte of the tiles found:
+ *
+ *   TileArchiveBenchmark [tiles] [lookups]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include "STTArchiveSerializer.h"
+#include "TileArchive.h"
+
+using namespace stt;
+
+/// get the seconds since a time
+static double
+secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int
+main(int argc, char *argv[]) {
+    const size_t tileCount = argc > 1 ? std::strtoull(argv[1], NULL, 10) : 1000000;
+    const size_t lookups = argc > 2 ? std::strtoull(argv[2], NULL, 10) : 10000000;
+
+    const std::string filename = std::string(CPLGenerateTempFilename("stt-archive")) + ".stta";
+
+    // the tiles of the zoom levels from 0 until there are enough, in row order
+    std::vector<TileCoordinate> tiles;
+    tiles.reserve(tileCount);
+    for (i_zoom zoom = 0; tiles.size() < tileCount; ++zoom) {
+        for (i_tile y = 0; y < (1 << zoom) && tiles.size() < tileCount; ++y) {
+            for (i_tile x = 0; x < (2 << zoom) && tiles.size() < tileCount; ++x) {
+                tiles.push_back(TileCoordinate(zoom, x, y));
+            }
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        STTArchiveSerializer serializer(filename, false);
+        serializer.startSerialization();
+
+        unsigned char data[64];
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            data[0] = (unsigned char) i;
+            serializer.serializeTileData(&tiles[i], data, 16 + i % 48);
+        }
+        serializer.endSerialization();
+    }
+    const double writeSeconds = secondsSince(start);
+
+    // every other lookup is for a tile of the zoom level after the archive's
+    const i_zoom missingZoom = tiles.back().zoom + 1;
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<size_t> pick(0, tiles.size() - 1);
+    std::vector<TileCoordinate> targets(std::min<size_t>(lookups, 1 << 20));
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const TileCoordinate &tile = tiles[pick(random)];
+        targets[i] = i % 2 ? tile : TileCoordinate(missingZoom, tile.x, tile.y);
+    }
+
+    TileArchive archive(filename);
+    size_t found = 0;
+    uint64_t checksum = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        size_t size;
+        const unsigned char *data = archive.tile(targets[i % targets.size()], size);
+
+        if (data != NULL) {
+            checksum += data[0] + size;
+            ++found;
+        }
+    }
+    const double lookupSeconds = secondsSince(start);
+
+    VSIStatBufL stat;
+    const double megabytes = VSIStatL(filename.c_str(), &stat) == 0 ? stat.st_size / 1048576.0 : 0;
+    VSIUnlink(filename.c_str());
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << archive.size() << " tiles written in " << writeSeconds << " s, "
+              << megabytes << " MB\n";
+    std::cout << lookups << " random lookups, " << found << " found: "
+              << lookups / lookupSeconds / 1e6 << " million lookups per second, "
+              << 1e9 * lookupSeconds / lookups << " ns per lookup (checksum "
+              << checksum << ")\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file TileArchiveTest.cpp
+ * @brief check that a tile archive is resumed after a truncated record
+ *
+ * the tiles of the first zoom levels are stored in an archive which is left
+ * unfinished, as by a run which is stopped, and its last record is then cut
+ * short as if the run had stopped while writing it. the archive is resumed,
+ * which must keep every complete record and ask for the tile of the cut
+ * record again, and is finished. every tile is then read back from the
+ * `TileArchive` and compared to the bytes stored.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include "STTArchiveSerializer.h"
+#include "TileArchive.h"
+
+using namespace stt;
+
+/// get the bytes stored for a tile, whose size and contents depend on it
+static std::vector<unsigned char>
+tileData(const TileCoordinate &coord) {
+    const uint64_t key = TileArchive::key(coord);
+    std::vector<unsigned char> data(16 + key % 97);
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (unsigned char) (key * 31 + i * 7 + coord.zoom);
+    }
+
+    return data;
+}
+
+/// store a tile unless the serializer already has it, returning whether it was stored
+static bool
+storeTile(STTArchiveSerializer &serializer, const TileCoordinate &coord) {
+    if (!serializer.mustSerializeCoordinate(&coord)) {
+        return false;
+    }
+
+    const std::vector<unsigned char> data = tileData(coord);
+    serializer.serializeTileData(&coord, data.data(), data.size());
+    return true;
+}
+
+/// cut the last `bytes` bytes off a file
+static void
+truncateFile(const std::string &filename, vsi_l_offset bytes) {
+    VSIStatBufL stat;
+    VSILFILE *fp = VSIFOpenL(filename.c_str(), "r+b");
+
+    if (fp == NULL || VSIStatL(filename.c_str(), &stat) != 0
+            || VSIFTruncateL(fp, stat.st_size - bytes) != 0) {
+        throw STTException("Could not truncate the archive");
+    }
+    VSIFCloseL(fp);
+}
+
+int
+main() {
+    const std::string filename = std::string(CPLGenerateTempFilename("stt-archive")) + ".stta";
+    int failures = 0;
+
+    // every tile of the geodetic zoom levels 0 to 5
+    std::vector<TileCoordinate> tiles;
+    for (i_zoom zoom = 0; zoom <= 5; ++zoom) {
+        for (i_tile y = 0; y < (1 << zoom); ++y) {
+            for (i_tile x = 0; x < (2 << zoom); ++x) {
+                tiles.push_back(TileCoordinate(zoom, x, y));
+            }
+        }
+    }
+    const size_t stopped = tiles.size() / 2;
+
+    // a run which stops after half of the tiles, in the middle of its last record
+    {
+        STTArchiveSerializer serializer(filename, false);
+        serializer.startSerialization();
+
+        for (size_t i = 0; i < stopped; ++i) {
+            storeTile(serializer, tiles[i]);
+        }
+        serializer.flush();
+    }
+    truncateFile(filename, 5);
+
+    // the resumed run stores the cut tile and the tiles not reached
+    {
+        STTArchiveSerializer serializer(filename, true);
+        serializer.startSerialization();
+
+        size_t stored = 0;
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            if (storeTile(serializer, tiles[i])) {
+                ++stored;
+
+                if (i + 1 < stopped) {
+                    std::cout << "tile " << i << " stored again when resuming\n";
+                    ++failures;
+                }
+            }
+        }
+        serializer.endSerialization();
+
+        if (stored != tiles.size() - stopped + 1) {
+            std::cout << "resuming stored " << stored << " tiles instead of "
+                      << tiles.size() - stopped + 1 << "\n";
+            ++failures;
+        }
+    }
+
+    {
+        TileArchive archive(filename);
+
+        if (archive.size() != tiles.size()) {
+            std::cout << "the archive holds " << archive.size() << " tiles instead of "
+                      << tiles.size() << "\n";
+            ++failures;
+        }
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            const std::vector<unsigned char> expected = tileData(tiles[i]);
+            size_t size;
+            const unsigned char *data = archive.tile(tiles[i], size);
+
+            if (data == NULL || size != expected.size()
+                    || memcmp(data, expected.data(), size) != 0) {
+                std::cout << "tile " << tiles[i].zoom << "/" << tiles[i].x << "/" << tiles[i].y
+                          << " does not read back\n";
+                ++failures;
+            }
+        }
+
+        size_t size;
+        if (archive.tile(TileCoordinate(6, 0, 0), size) != NULL) {
+            std::cout << "a tile not stored was found\n";
+            ++failures;
+        }
+    }
+
+    VSIUnlink(filename.c_str());
+
+    std::cout << tiles.size() << " tiles written, resumed after " << stopped
+              << " and read back: " << failures << " failures\n";
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file TileCodecTest.cpp
+ * @brief check that tiles compressed by a codec read back and resume apart
+ *
+ * a buffer is compressed by the gzip codec and inflated again by zlib, and
+ * stored unchanged by the `none` codec. the codecs built in must all store
+ * their tiles under a distinct suffix, so that a directory store written with
+ * one codec and resumed with another asks for every tile again rather than
+ * keeping tiles compressed the other way. unknown codecs and levels out of
+ * range must be refused.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "zlib.h"
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include "STTException.h"
+#include "STTFileTileSerializer.h"
+#include "TileCodec.h"
+
+using namespace stt;
+
+/// inflate a gzipped buffer, returning false if it is not valid gzip
+static bool
+gunzip(const std::vector<unsigned char> &compressed, std::vector<unsigned char> &data) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+
+    stream.next_in = const_cast<unsigned char *>(compressed.data());
+    stream.avail_in = compressed.size();
+
+    unsigned char chunk[16384];
+    int status;
+    do {
+        stream.next_out = chunk;
+        stream.avail_out = sizeof(chunk);
+        status = inflate(&stream, Z_NO_FLUSH);
+        data.insert(data.end(), chunk, chunk + sizeof(chunk) - stream.avail_out);
+    } while (status == Z_OK);
+    inflateEnd(&stream);
+
+    return status == Z_STREAM_END;
+}
+
+/// store a tile with a codec unless the store already has it, returning whether it was stored
+static bool
+storeTile(const std::string &dirname, const TileCodec &codec, bool resume,
+          const TileCoordinate &coord, const std::vector<unsigned char> &data) {
+    STTFileTileSerializer serializer(dirname, resume, &codec);
+    serializer.startSerialization();
+
+    const bool stored = serializer.mustSerializeCoordinate(&coord);
+    if (stored) {
+        std::vector<unsigned char> encoded;
+        codec.encode(data.data(), data.size(), encoded);
+        serializer.serializeTileData(&coord, encoded.data(), encoded.size());
+    }
+    serializer.endSerialization();
+
+    return stored;
+}
+
+/// check whether creating a codec throws
+static bool
+refused(const char *name, int level) {
+    try {
+        std::unique_ptr<TileCodec> codec(TileCodec::create(name, level));
+    } catch (STTException &) {
+        return true;
+    }
+    return false;
+}
+
+int
+main() {
+    int failures = 0;
+
+    std::vector<unsigned char> data(100000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (unsigned char) ((i * 7) % 251 + (i / 1000));
+    }
+
+    // gzip must read back with zlib
+    {
+        std::vector<unsigned char> encoded, decoded;
+        TileCodec::gzip().encode(data.data(), data.size(), encoded);
+
+        if (!gunzip(encoded, decoded) || decoded != data) {
+            std::cout << "gzipped tile does not inflate back\n";
+            ++failures;
+        }
+    }
+
+    std::unique_ptr<TileCodec> none(TileCodec::create("none"));
+    {
+        std::vector<unsigned char> encoded;
+        none->encode(data.data(), data.size(), encoded);
+
+        if (encoded != data) {
+            std::cout << "uncompressed tile differs from its encoding\n";
+            ++failures;
+        }
+    }
+
+    // every codec built in must store its tiles under a suffix of its own
+    std::set<std::string> suffixes;
+    size_t built = 0;
+    for (const char *name : { "none", "gzip", "zstd", "brotli" }) {
+        std::unique_ptr<TileCodec> codec;
+        try {
+            codec.reset(TileCodec::create(name));
+        } catch (STTException &) {
+            continue;
+        }
+
+        ++built;
+        if (!suffixes.insert(codec->extension()).second) {
+            std::cout << name << " tiles share the suffix \"" << codec->extension()
+                      << "\" of another codec\n";
+            ++failures;
+        }
+    }
+
+    // a store written with gzip and resumed without compression
+    const std::string dirname = std::string(CPLGenerateTempFilename("stt-codec")) + "/";
+    VSIMkdir(dirname.c_str(), 0755);
+    {
+        const TileCoordinate coord(3, 5, 2);
+
+        storeTile(dirname, TileCodec::gzip(), false, coord, data);
+
+        if (storeTile(dirname, TileCodec::gzip(), true, coord, data)) {
+            std::cout << "gzipped tile stored again when resuming with gzip\n";
+            ++failures;
+        }
+        if (!storeTile(dirname, *none, true, coord, data)) {
+            std::cout << "gzipped tile kept when resuming without compression\n";
+            ++failures;
+        }
+        if (storeTile(dirname, *none, true, coord, data)) {
+            std::cout << "uncompressed tile stored again when resuming without compression\n";
+            ++failures;
+        }
+    }
+    std::filesystem::remove_all(dirname);
+
+    if (!refused("lzma", TileCodec::defaultLevel)) {
+        std::cout << "an unknown codec was created\n";
+        ++failures;
+    }
+    if (!refused("gzip", 99)) {
+        std::cout << "gzip was created at level 99\n";
+        ++failures;
+    }
+
+    std::cout << built << " codecs built in, encoded and resumed: "
+              << failures << " failures\n";
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file TileManifestTest.cpp
+ * @brief check that a tile manifest resumes with the tiles of its checkpoints
+ *
+ * the tiles of a few zoom levels of a raster are added to a new manifest, half
+ * of them before a checkpoint, some after a checkpoint whose flush fails and
+ * the rest after the last checkpoint, as by a run which is stopped. the
+ * manifest is then resumed, which must find exactly the tiles recorded by the
+ * checkpoints which succeeded, and must be refused for other zoom levels.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include "GlobalGeodetic.h"
+#include "GridIterator.h"
+#include "MeshTiler.h"
+#include "STTException.h"
+#include "TileManifest.h"
+
+#include "TestRaster.h"
+
+using namespace stt;
+
+int
+main() {
+    const std::string filename = std::string(CPLGenerateTempFilename("stt-manifest")) + ".manifest";
+    int failures = 0;
+
+    test::TestRaster raster(1024, 512, 256);
+    MeshTiler tiler(raster.open(), GlobalGeodetic(65), TilerOptions());
+    const i_zoom startZoom = tiler.maxZoomLevel();
+    const i_zoom endZoom = startZoom > 4 ? startZoom - 4 : 0;
+
+    std::vector<TileCoordinate> tiles;
+    for (GridIterator iter(tiler.grid(), tiler.bounds(), startZoom, endZoom); !iter.exhausted(); ++iter) {
+        tiles.push_back(**iter);
+    }
+    const size_t checkpointed = tiles.size() / 2;
+    const size_t failed = checkpointed + tiles.size() / 4;
+
+    // a run which records half of the tiles and stops after a failed flush
+    {
+        TileManifest manifest(filename, tiler, startZoom, endZoom, false);
+
+        for (size_t i = 0; i < checkpointed; ++i) {
+            manifest.add(tiles[i]);
+        }
+
+        size_t flushes = 0;
+        const uint64_t recorded = manifest.checkpoint([&]() { ++flushes; });
+        if (flushes != 1 || recorded != checkpointed) {
+            std::cout << "the checkpoint recorded " << recorded << " tiles instead of "
+                      << checkpointed << "\n";
+            ++failures;
+        }
+
+        for (size_t i = checkpointed; i < failed; ++i) {
+            manifest.add(tiles[i]);
+        }
+
+        try {
+            manifest.checkpoint([]() { throw STTException("Could not flush the tiles"); });
+            std::cout << "a failed flush was not reported\n";
+            ++failures;
+        } catch (STTException &) {
+        }
+
+        for (size_t i = failed; i < tiles.size(); ++i) {
+            manifest.add(tiles[i]);
+        }
+    }
+
+    // the resumed run finds the tiles recorded and nothing else
+    {
+        TileManifest manifest(filename, tiler, startZoom, endZoom, true);
+
+        if (!manifest.isResumed() || manifest.completed() != checkpointed
+                || manifest.checkpoints() != 1) {
+            std::cout << "the resumed manifest holds " << manifest.completed() << " tiles from "
+                      << manifest.checkpoints() << " checkpoints instead of " << checkpointed
+                      << " from 1\n";
+            ++failures;
+        }
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            if (manifest.isComplete(tiles[i]) != (i < checkpointed)) {
+                std::cout << "tile " << tiles[i].zoom << "/" << tiles[i].x << "/" << tiles[i].y
+                          << (i < checkpointed ? " was lost" : " was recorded without a checkpoint") << "\n";
+                ++failures;
+            }
+        }
+    }
+
+    // a manifest written for other zoom levels is refused
+    try {
+        TileManifest manifest(filename, tiler, startZoom, endZoom + 1, true);
+        std::cout << "a manifest of other zoom levels was resumed\n";
+        ++failures;
+    } catch (STTException &) {
+    }
+
+    VSIUnlink(filename.c_str());
+
+    std::cout << tiles.size() << " tiles added, " << checkpointed << " checkpointed and resumed: "
+              << failures << " failures\n";
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
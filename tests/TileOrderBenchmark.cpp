@@ -0,0 +1,158 @@
+/**
+ * @file TileOrderBenchmark.cpp
+ * @brief compare the GDAL block cache hit rate and wall time of the tile orders
+ *
+ * the mesh tiles of a zoom level of a synthetic tiled GeoTIFF are built in
+ * every `TileOrder` with a block cache much smaller than the raster. the
+ * blocks asked for are counted from the footprint of every tile read, and the
+ * blocks loaded from the bytes the process reads from the file, which gives
+ * the share of the blocks served by the cache:
+ *
+ *   TileOrderBenchmark [cache MB] [block size] [zoom]
+ *
+ * the zoom level defaults to the maximum zoom level of the raster.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "GDALDatasetPool.h"
+#include "GDALDatasetReader.h"
+#include "GlobalGeodetic.h"
+#include "GridIterator.h"
+#include "MeshTiler.h"
+#include "TileArena.h"
+
+#include "TestRaster.h"
+
+using namespace stt;
+
+/// get the number of bytes the process has read, or `0` if it isn't known
+static uint64_t
+bytesRead() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    uint64_t value;
+
+    while (io >> key >> value) {
+        if (key == "rchar:")
+            return value;
+    }
+    return 0;
+}
+
+/// count the raster blocks under the tiles read by another reader
+class BlockCountingReader: public GDALDatasetReader
+{
+public:
+    BlockCountingReader(const GDALTiler &tiler, const test::TestRaster &raster,
+        GDALDatasetReader &reader):
+        mTiler(tiler),
+        mRaster(raster),
+        mReader(reader),
+        mBlocks(0)
+    {}
+
+    using GDALDatasetReader::readRasterHeights;
+
+    virtual void
+    readRasterHeights(GDALDataset *dataset, const TileCoordinate &coord,
+        i_tile tileSizeX, i_tile tileSizeY, float *heights) override {
+        double adfGeoTransform[6];
+        dataset->GetGeoTransform(adfGeoTransform);
+
+        const CRSBounds bounds = mTiler.grid().tileBounds(coord);
+        const int blockSize = mRaster.blockSize > 0 ? mRaster.blockSize : 1;
+        const int blockWidth = mRaster.blockSize > 0 ? mRaster.blockSize : mRaster.width;
+
+        int minX = std::max(0, (int) std::floor((bounds.getMinX() - adfGeoTransform[0]) / adfGeoTransform[1]));
+        int maxX = std::min(mRaster.width - 1, (int) std::floor((bounds.getMaxX() - adfGeoTransform[0]) / adfGeoTransform[1]));
+        int minY = std::max(0, (int) std::floor((bounds.getMaxY() - adfGeoTransform[3]) / adfGeoTransform[5]));
+        int maxY = std::min(mRaster.height - 1, (int) std::floor((bounds.getMinY() - adfGeoTransform[3]) / adfGeoTransform[5]));
+
+        if (minX <= maxX && minY <= maxY) {
+            mBlocks += (uint64_t) (maxX / blockWidth - minX / blockWidth + 1)
+                * (maxY / blockSize - minY / blockSize + 1);
+        }
+
+        mReader.readRasterHeights(dataset, coord, tileSizeX, tileSizeY, heights);
+    }
+
+    /// get the number of blocks asked for so far
+    inline uint64_t
+    blocks() const {
+        return mBlocks;
+    }
+
+protected:
+    const GDALTiler &mTiler;
+    const test::TestRaster &mRaster;
+    GDALDatasetReader &mReader;
+    uint64_t mBlocks;
+};
+
+int
+main(int argc, char *argv[]) {
+    const int cacheMegabytes = argc > 1 ? std::atoi(argv[1]) : 4;
+    const int blockSize = argc > 2 ? std::atoi(argv[2]) : 256;
+
+    test::TestRaster raster(4096, 2048, blockSize);
+
+    GDALSetCacheMax64((GIntBig) cacheMegabytes * 1024 * 1024);
+
+    MeshTiler tiler(raster.open(), GlobalGeodetic(65), TilerOptions());
+    const i_zoom zoom = argc > 3 ? std::atoi(argv[3]) : tiler.maxZoomLevel();
+
+    const struct {
+        TileOrder order;
+        const char *name;
+    } orders[] = {
+        { TILE_ORDER_COLUMN, "column" },
+        { TILE_ORDER_ROW, "row" },
+        { TILE_ORDER_MORTON, "morton" },
+        { TILE_ORDER_HILBERT, "hilbert" }
+    };
+
+    std::cout << "raster " << raster.width << "x" << raster.height << ", blocks "
+              << (blockSize > 0 ? std::to_string(blockSize) : std::string("strip"))
+              << ", cache " << cacheMegabytes << " MB, zoom " << zoom << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+
+    for (const auto &order : orders) {
+        // a new pool for every order starts with none of the raster cached
+        GDALDatasetPool pool(raster.filename);
+        pool.resize(1);
+
+        GDALDatasetReaderWithOverviews overviews(tiler);
+        BlockCountingReader reader(tiler, raster, overviews);
+        TileArena arena;
+
+        uint64_t tiles = 0;
+        const uint64_t startBytes = bytesRead();
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        GridIterator iter(tiler.grid(), tiler.bounds(), zoom, zoom);
+        iter.setOrder(order.order);
+
+        for (; !iter.exhausted(); ++iter) {
+            tiler.createMesh(pool.dataset(0), **iter, &reader, arena);
+            ++tiles;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double loaded = (double) (bytesRead() - startBytes) / raster.blockBytes();
+        const double hitRate = reader.blocks() > 0 ? std::max(0.0, 1.0 - loaded / reader.blocks()) : 0;
+
+        std::cout << std::setw(8) << order.name << ": " << tiles << " tiles in "
+                  << seconds << "s, " << reader.blocks() << " blocks asked for, "
+                  << (uint64_t) loaded << " loaded, hit rate " << hitRate << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
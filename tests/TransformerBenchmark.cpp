@@ -0,0 +1,131 @@
+/**
+ * @file TransformerBenchmark.cpp
+ * @brief measure the time the transformer cache saves per tile when reprojecting
+ *
+ * a synthetic UTM raster is tiled in the geodetic grid. the image to image
+ * transformer every warped tile needs is first created and destroyed for each
+ * tile, as it was before the `TransformerCache`, and then acquired from the
+ * cache with only the destination geotransform set for the tile. the mesh
+ * tiles of the maximum zoom level are then built to put the time saved next
+ * to the time a tile takes:
+ *
+ *   TransformerBenchmark [tiles]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "gdal_alg.h"
+#include "cpl_string.h"
+
+#include "GDALDatasetReader.h"
+#include "GlobalGeodetic.h"
+#include "GridIterator.h"
+#include "MeshTiler.h"
+#include "TileArena.h"
+#include "TransformerCache.h"
+
+#include "TestRaster.h"
+
+using namespace stt;
+
+/// get the seconds since a time
+static double
+secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int
+main(int argc, char *argv[]) {
+    const int maxTiles = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+    // 60 km square of UTM zone 32N at 30 m
+    test::TestRaster raster(2048, 2048, 256, 400000, 5300000, 30, 32632);
+
+    MeshTiler tiler(raster.open(), GlobalGeodetic(65), TilerOptions());
+    const i_zoom zoom = tiler.maxZoomLevel();
+
+    GDALDataset *dataset = raster.open();
+    GDALDatasetH hSrcDS = GDALDataset::ToHandle(dataset);
+
+    char *gridWKT = NULL;
+    tiler.grid().getSRS().exportToWkt(&gridWKT);
+
+    CPLStringList transformOptions;
+    transformOptions.SetNameValue("SRC_SRS", dataset->GetProjectionRef());
+    transformOptions.SetNameValue("DST_SRS", gridWKT);
+
+    std::vector<TileCoordinate> tiles;
+    for (GridIterator iter(tiler.grid(), tiler.bounds(), zoom, zoom);
+            !iter.exhausted() && (int) tiles.size() < maxTiles; ++iter) {
+        tiles.push_back(**iter);
+    }
+
+    auto tileGeoTransform = [&](const TileCoordinate &coord, double (&adfGeoTransform)[6]) {
+        const CRSBounds bounds = tiler.grid().tileBounds(coord);
+        const double resolution = tiler.grid().resolution(coord.zoom);
+
+        adfGeoTransform[0] = bounds.getMinX();
+        adfGeoTransform[1] = resolution;
+        adfGeoTransform[2] = 0;
+        adfGeoTransform[3] = bounds.getMaxY();
+        adfGeoTransform[4] = 0;
+        adfGeoTransform[5] = -resolution;
+    };
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        double adfGeoTransform[6];
+        tileGeoTransform(tiles[i], adfGeoTransform);
+
+        void *transformer = GDALCreateGenImgProjTransformer2(hSrcDS, NULL, transformOptions.List());
+        GDALSetGenImgProjTransformerDstGeoTransform(transformer, adfGeoTransform);
+        GDALDestroyGenImgProjTransformer(transformer);
+    }
+    const double createSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        double adfGeoTransform[6];
+        tileGeoTransform(tiles[i], adfGeoTransform);
+
+        void *transformer = TransformerCache::acquire(hSrcDS, hSrcDS, -1, transformOptions.List());
+        GDALSetGenImgProjTransformerDstGeoTransform(transformer, adfGeoTransform);
+        TransformerCache::release(transformer);
+    }
+    const double cachedSeconds = secondsSince(start);
+
+    GDALTiler::releaseOverviews(dataset);
+    GDALClose(dataset);
+    CPLFree(gridWKT);
+
+    // the time of a whole tile, with the cache
+    GDALDatasetReaderWithOverviews reader(tiler);
+    TileArena arena;
+    dataset = raster.open();
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        tiler.createMesh(dataset, tiles[i], &reader, arena);
+    }
+    const double tileSeconds = secondsSince(start);
+
+    reader.reset();
+    GDALTiler::releaseOverviews(dataset);
+    GDALClose(dataset);
+
+    const double perTile = 1e6 / tiles.size();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << tiles.size() << " tiles at zoom " << zoom << " from UTM 32N\n";
+    std::cout << "transformer created per tile: " << createSeconds * perTile << " us per tile\n";
+    std::cout << "transformer from the cache:   " << cachedSeconds * perTile << " us per tile\n";
+    std::cout << "mesh tile with the cache:     " << tileSeconds * perTile << " us per tile\n";
+    std::cout << "saved per tile: " << (createSeconds - cachedSeconds) * perTile << " us, "
+              << 100 * (createSeconds - cachedSeconds) / (tileSeconds + createSeconds - cachedSeconds)
+              << "% of a tile without the cache\n";
+
+    return EXIT_SUCCESS;
+}
@@ -17,6 +17,7 @@ namespace stt {
     typedef unsigned int i_tile;       /// a tile coordinate
     typedef unsigned short int i_zoom; /// a zoom level
     typedef uint16_t i_terrain_height; /// a terrain tile height
+    typedef uint64_t i_tile_index;     /// the position of a tile in an iteration
 
     // complex types
     typedef Bounds<i_tile> TileBounds;      /// tile extents in tile coordinates